@@ -29,6 +29,11 @@
 #include <libracore/DataBase.h>
 #include <libracore/MakeComponents.h>
 #include <synthesis/TransformMachines2/CFCacheHelper.h>
+#include <synthesis/TransformMachines2/CFCPack.h>
+#include <synthesis/TransformMachines2/CFCacheIndex.h>
+#include <casacore/casa/OS/DirectoryIterator.h>
+#include <casacore/casa/OS/RegularFile.h>
+#include <casacore/casa/OS/Path.h>
 #include <coyote.h>
 //
 //--------------------------------------------------------------------------
@@ -73,6 +78,132 @@ std::vector<std::string> fileList(const std::string& cfCacheName,
 }
 //
 //--------------------------------------------------------------------------
+// Pack all the CFs (CFS* and WTCFS*) in the CFC into the packed CFC
+// format (see refim::CFCPack), with the pixels stored as pixelType.
+//
+void packCFC(const std::string& cfCacheName, const std::string& pixelType)
+{
+  LogIO log_l(LogOrigin("coyote", "packCFC"));
+
+  Directory dirObj(cfCacheName);
+  std::vector<casacore::String> cfNames;
+  for (auto pattern : {"CFS*", "WTCFS*"})
+    {
+      Regex regex(Regex::fromPattern(pattern));
+      Vector<String> tmp = dirObj.find(regex,false,false);
+      for (auto y : tmp) cfNames.push_back(y);
+    }
+  if (cfNames.size() == 0)
+    throw(CFCIsEmpty(String("packCFC: No CFs found in ")+cfCacheName));
+
+  refim::CFCPack::PixelType type = refim::CFCPack::pixelType(pixelType);
+  log_l << "Packing " << cfNames.size() << " CFs in " << cfCacheName
+	<< " as " << refim::CFCPack::pixelTypeName(type) << " pixels" << LogIO::POST;
+  double bytes = refim::CFCPack::pack(cfCacheName, cfNames, type);
+  log_l << "Wrote " << (int)(bytes/(1024*1024)+0.5) << " MB of CF pixels to "
+	<< cfCacheName << "/" << refim::CFCPack::pixelFileName << LogIO::POST;
+}
+//
+//--------------------------------------------------------------------------
+// Copy the CFs in cfNames (and their WTCFs) from the CFC to a new
+// CFC, with all the CFC-level meta information.
+//
+void makeSubCFC(const std::string& cfCacheName,
+		const std::string& subCFCacheName,
+		const std::vector<std::string>& cfNames)
+{
+  LogIO log_l(LogOrigin("coyote", "makeSubCFC"));
+
+  if (Path(subCFCacheName).absoluteName() == Path(cfCacheName).absoluteName())
+    throw(AipsError("makeSubCFC: The sub-CFC cannot be the CFC itself"));
+
+  Directory subDir(subCFCacheName);
+  if (!subDir.exists()) subDir.create();
+
+  auto copy = [&](const String& name)
+    {
+      String from=cfCacheName+"/"+name, to=subCFCacheName+"/"+name;
+      File f(from);
+      if (f.isDirectory()) Directory(from).copy(to);
+      else if (f.isRegular()) RegularFile(from).copy(to);
+    };
+  //
+  // The CFC-level meta information.  The CFs, the packed CFC and the
+  // meta information index are not copied (pack the sub-CFC with
+  // mode=packcf if needed).
+  //
+  Regex cfRegex(Regex::fromPattern("CFS*")), wtcfRegex(Regex::fromPattern("WTCFS*")),
+    packRegex(Regex::fromPattern("CFCPack.*")), indexRegex(Regex::fromPattern(refim::CFCacheIndex::fileName+"*"));
+  for (DirectoryIterator itr(cfCacheName); !itr.pastEnd(); itr++)
+    {
+      String name=itr.name();
+      if (name.matches(cfRegex) || name.matches(wtcfRegex) ||
+	  name.matches(packRegex) || name.matches(indexRegex))
+	continue;
+      copy(name);
+    }
+
+  for (auto& cf : cfNames)
+    for (String name : {String(cf), String("WT")+cf})
+      {
+	if (!File(cfCacheName+"/"+name).exists())
+	  throw(AipsError("makeSubCFC: "+name+" not found in "+cfCacheName));
+	copy(name);
+      }
+  log_l << "Copied " << cfNames.size() << " CFs and their WTCFs to "
+	<< subCFCacheName << LogIO::POST;
+}
+//
+//--------------------------------------------------------------------------
+// List the CFs of the CFC needed to image the selected data (see
+// SynthesisUtils::listCFs()), and copy them to a sub-CFC if
+// subCFCacheName is not empty.
+//
+std::vector<std::string> listCFC(const std::string& MSNBuf,
+				 const std::string& cfCacheName,
+				 const std::string& fieldStr, const std::string& spwStr,
+				 const std::string& refFreqStr,
+				 const bool& WBAwp, const int& nW,
+				 const bool& conjBeams, const float& dpa,
+				 const std::string& subCFCacheName)
+{
+  LogIO log_l(LogOrigin("coyote", "listCFC"));
+  //
+  // Only the meta information of the CFs is loaded.
+  //
+  CountedPtr<refim::CFCache> cfCacheObj_l = new refim::CFCache(cfCacheName.c_str());
+  CountedPtr<casa::refim::CFStore2> cfs2_l, cfswt2_l;
+  {
+    std::vector<std::string> blank={""};
+    std::exception_ptr excpt;
+    std::tie(cfs2_l, cfswt2_l, excpt) =
+      casa::refim::SynthesisUtils::constructCFS(cfCacheObj_l.get(), blank, blank,
+						"dryrun", 360.0, 400.0,
+						casa::refim::SynthesisUtils::MAKE_CFCFS);
+    if (excpt != nullptr) std::rethrow_exception(excpt);
+  }
+
+  double imRefFreq=0.0;
+  if (conjBeams)
+    imRefFreq = casa::refim::SynthesisUtils::makeFreqQuantity(refFreqStr,"Hz").getValue("Hz");
+
+  string uvDistStr;
+  bool doSPWDataIter = false;
+  DataBase db(MSNBuf, fieldStr, spwStr, uvDistStr, WBAwp, nW, doSPWDataIter);
+
+  std::vector<std::string> cfNames =
+    casa::refim::SynthesisUtils::listCFs(db, *cfs2_l, dpa, imRefFreq, conjBeams);
+
+  log_l << cfNames.size() << " of the CFs in " << cfCacheName
+	<< " are needed for the selected data:" << LogIO::POST;
+  for (auto& name : cfNames) log_l << name << LogIO::POST;
+
+  if (!subCFCacheName.empty()) makeSubCFC(cfCacheName, subCFCacheName, cfNames);
+
+  return cfNames;
+}
+//
+//--------------------------------------------------------------------------
 //
 void Coyote(//bool &restartUI, int &argc, char **argv,
 	    string &MSNBuf,
@@ -86,7 +217,8 @@ void Coyote(//bool &restartUI, int &argc, char **argv,
 	    bool &conjBeams,
 	    int &cfBufferSize, int &cfOversampling,
 	    std::vector<std::string>& cfList,
-	    string& mode)
+	    string& mode, int& nThreads,
+	    string& subCFCacheName, string& pixelType)
 {
   LogFilter filter(LogMessage::NORMAL);
   LogSink::globalSink().filter(filter);
@@ -94,6 +226,31 @@ void Coyote(//bool &restartUI, int &argc, char **argv,
 
   try
     {
+      //
+      // mode="packcf" needs only the CFC.
+      //
+      if (mode=="packcf")
+	{
+	  packCFC(cfCacheName, pixelType);
+	  return;
+	}
+      //
+      // mode="listcf" only reads the CFC (and the MS).  The list of
+      // CFs is returned in cfList.
+      //
+      if (mode=="listcf")
+	{
+	  cfList = listCFC(MSNBuf, cfCacheName, fieldStr, spwStr, refFreqStr,
+			   WBAwp, nW, conjBeams, dpa, subCFCacheName);
+	  return;
+	}
+      //
+      // The CFs in the directory layout will change.  A packed CFC
+      // made from them earlier is therefore out of date.
+      //
+      if (refim::CFCPack::remove(cfCacheName))
+	log_l << "Removed the (now out of date) packed CFC in " << cfCacheName << LogIO::POST;
+
       std::vector<std::string> wtCFList;
       if (mode=="fillcf")
 	{
@@ -198,7 +355,7 @@ void Coyote(//bool &restartUI, int &argc, char **argv,
 	  casa::refim::SynthesisUtils::fillCFS_inmemory(cfCacheName,
 							cfs2_l, cfswt2_l, uvOffset,
 							psTerm, aTerm, conjBeams,
-							imInfo);
+							imInfo, nThreads);
 	}
       //
       // Save the contents of the in-memory CFStore on the disk.
@@ -100,6 +100,39 @@ PagedImage<Complex> makeEmptySkyImage4CF(VisibilityIterator2& vi2,
 std::vector<std::string> fileList(const std::string& cfCacheName,
 				  const std::vector<std::string>& regexList);
 
+/// @brief Pack all the CFs in a CFCache into the packed (memory-mapped) CFCache format.
+/// @param cfCacheName is the name of the CF cache.
+/// @param pixelType is the type to store the pixels as (complex, half or quant8).
+void packCFC(const std::string& cfCacheName, const std::string& pixelType="complex");
+
+/// @brief Copy a list of CFs (and their WTCFs) from a CF cache to a new CF cache.
+/// @param cfCacheName is the name of the CF cache.
+/// @param subCFCacheName is the name of the new CF cache.
+/// @param cfNames is the list of CFs to copy.
+void makeSubCFC(const std::string& cfCacheName,
+		const std::string& subCFCacheName,
+		const std::vector<std::string>& cfNames);
+
+/// @brief List the CFs in a CF cache needed to image the selected data.
+/// @param MSNBuf is the name of the MeasurementSet.
+/// @param cfCacheName is the name of the CF cache.
+/// @param fieldStr is the field selection string.
+/// @param spwStr is the spectral window selection string.
+/// @param refFreqStr is the reference frequency of the image (used with conjBeams).
+/// @param WBAwp is the flag for WBAwp.
+/// @param nW is the number of W-terms.
+/// @param conjBeams is the flag for conjBeams.
+/// @param dpa is the parallactic angle tolerance (deg) to look up the CFs with.
+/// @param subCFCacheName is the name of a new CF cache to copy the listed CFs to (none if empty).
+/// @return The names of the CFs.
+std::vector<std::string> listCFC(const std::string& MSNBuf,
+				 const std::string& cfCacheName,
+				 const std::string& fieldStr, const std::string& spwStr,
+				 const std::string& refFreqStr,
+				 const bool& WBAwp, const int& nW,
+				 const bool& conjBeams, const float& dpa,
+				 const std::string& subCFCacheName);
+
 
 /// @brief Is a Function to generate a list of CFs which can be filled usinga  different mode
 /// @param MSNBuf is the name of the MeasurementSet.
@@ -123,7 +156,10 @@ std::vector<std::string> fileList(const std::string& cfCacheName,
 /// @param cfBufferSize is the CF buffer size.
 /// @param cfOversampling is the CF oversampling.
 /// @param cfList is the list of CFs.
-/// @param mode is the mode which can be either dryrun or fillcf.
+/// @param mode is the mode which can be dryrun, fillcf, packcf or listcf.
+/// @param nThreads is the number of threads to fill the CFs with in mode=fillcf (0 for all the cores).
+/// @param subCFCacheName is the name of the CF cache to copy the listed CFs to in mode=listcf.
+/// @param pixelType is the type of the packed CF pixels in mode=packcf (complex, half or quant8).
 void Coyote(//bool &restartUI, int &argc, char **argv,
 	    string &MSNBuf, 
 	    string &telescopeName,
@@ -136,7 +172,8 @@ void Coyote(//bool &restartUI, int &argc, char **argv,
 	    bool &conjBeams,  
 	    int &cfBufferSize, int &cfOversampling,
 	    std::vector<std::string>& cfList,
-	    string& mode);
+	    string& mode, int& nThreads,
+	    string& subCFCacheName, string& pixelType);
 
 // UI Funtions 
  
@@ -169,6 +206,9 @@ void Coyote(//bool &restartUI, int &argc, char **argv,
  * @param cfOversampling The convolution function oversampling factor.
  * @param cfList The list of convolution functions.
  * @param mode The mode of operation.
+ * @param nThreads The number of threads for mode=fillcf.
+ * @param subCFCacheName The CF cache to copy the listed CFs to for mode=listcf.
+ * @param pixelType The type of the packed CF pixels for mode=packcf.
  */
 void UI(bool restart, int argc, char **argv, bool interactive, 
 	string& MSNBuf,
@@ -184,7 +224,8 @@ void UI(bool restart, int argc, char **argv, bool interactive,
         int& cfOversampling,
         std::vector<std::string>& cfList,
         //      std::vector<std::string>& wtCFList,
-	string& mode);
+	string& mode, int& nThreads,
+	string& subCFCacheName, string& pixelType);
 
 
 #endif
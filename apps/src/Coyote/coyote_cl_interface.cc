@@ -53,7 +53,8 @@ void UI(bool restart, int argc, char **argv, bool interactive,
 	int& cfOversampling,
 	std::vector<std::string>& cfList,
 	//	std::vector<std::string>& wtCFList,
-	string& mode)
+	string& mode, int& nThreads,
+	string& subCFCacheName, string& pixelType)
 {
   clSetPrompt(interactive);
   
@@ -102,11 +103,24 @@ void UI(bool restart, int argc, char **argv, bool interactive,
       i=1;clgetValp("oversampling", cfOversampling,i);
 
       InitMap(watchPoints,exposedKeys);
-      // Expose cflist for mode=fillcf. 
+      // Expose cflist and nthreads for mode=fillcf. 
       exposedKeys.resize(0);
       exposedKeys.push_back("cflist");
+      exposedKeys.push_back("nthreads");
       watchPoints["fillcf"]=exposedKeys;
 
+      // Keywords used to list the CFs needed for an MS in mode=listcf.
+      exposedKeys=
+	{
+	  "vis","reffreq","wbawp","wplanes","conjbeams","dpa",
+	  "field","spw","subcfcache"
+	};
+      watchPoints["listcf"]=exposedKeys;
+
+      // Expose pixeltype for mode=packcf.
+      exposedKeys={"pixeltype"};
+      watchPoints["packcf"]=exposedKeys;
+
       //----------------------------------------------
       // None of the following keyword values are used in
       // mode=fillcf.  So, hide them.
@@ -122,8 +136,11 @@ void UI(bool restart, int argc, char **argv, bool interactive,
       }
       //----------------------------------------------
 
-      i=1;clgetValp("mode", mode,i,watchPoints);clSetOptions("mode",{"dryrun","fillcf"});
+      i=1;clgetValp("mode", mode,i,watchPoints);clSetOptions("mode",{"dryrun","fillcf","packcf","listcf"});
       i=0;clgetValp("cflist", cfList,i);
+      i=1;clgetValp("nthreads", nThreads,i);
+      i=1;clgetValp("subcfcache", subCFCacheName,i);
+      i=1;clgetValp("pixeltype", pixelType,i);clSetOptions("pixeltype",{"complex","half","quant8"});
       
       EndCL();
       
@@ -132,7 +149,7 @@ void UI(bool restart, int argc, char **argv, bool interactive,
       if (CFCache == "")
 	mesgs += "The cfcache parameter needs to be set.\n ";
       
-      if (mode != "fillcf")
+      if (mode == "dryrun")
 	{
 	  if (refFreqStr == "")
 	    mesgs += "The reffreq parameter needs to be set.\n ";
@@ -143,6 +160,18 @@ void UI(bool restart, int argc, char **argv, bool interactive,
 	  if (cellSize <= 0)
 	    mesgs += "The cell parameter needs to be set to a positive finite value.\n ";
 	}
+      if (mode == "listcf")
+	{
+	  if (MSNBuf == "")
+	    mesgs += "The vis parameter needs to be set.\n ";
+
+	  if (conjBeams && (refFreqStr == ""))
+	    mesgs += "The reffreq parameter needs to be set for conjbeams=1.\n ";
+	}
+      if (nThreads < 0)
+	mesgs += "The nthreads parameter needs to be 0 (all cores) or positive.\n ";
+      if ((pixelType != "complex") && (pixelType != "half") && (pixelType != "quant8"))
+	mesgs += "The pixeltype parameter needs to be complex, half or quant8.\n ";
       if (mesgs != "")
 	clThrowUp(mesgs,"###Fatal", CL_FATAL);
     }
@@ -165,12 +194,12 @@ int main(int argc, char **argv)
   string MSNBuf="", cfCache="", fieldStr="", spwStr="*",
     imageName,cmplxGridName="",phaseCenter, stokes="I",
     refFreqStr, telescopeName="EVLA", mType="diagonal",
-    mode="dryrun";
+    mode="dryrun", subCFCache="", pixelType="complex";
   std::vector<std::string> cfList={"CFS*"};
   //  std::vector<std::string> wtCFList;
   
   float cellSize=0;//refFreq=3e09, freqBW=3e9;
-  int NX=0, nW=1, cfBufferSize=0, cfOversampling=20;
+  int NX=0, nW=1, cfBufferSize=0, cfOversampling=20, nThreads=1;
   bool WBAwp=true;
   bool restartUI=false;
   bool conjBeams= true;
@@ -194,7 +223,7 @@ int main(int argc, char **argv)
 	 conjBeams,
 	 cfBufferSize, cfOversampling,
 	 cfList,
-	 mode);
+	 mode, nThreads, subCFCache, pixelType);
   
       set_terminate(NULL);
       Coyote(MSNBuf,
@@ -207,7 +236,7 @@ int main(int argc, char **argv)
 	     conjBeams,
 	     cfBufferSize, cfOversampling,
 	     cfList,
-	     mode);
+	     mode, nThreads, subCFCache, pixelType);
       
     }
   catch(clError& er)
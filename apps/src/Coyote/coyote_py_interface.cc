@@ -58,6 +58,9 @@ using namespace py::literals;  // to bring in the "_a" literal
  * @param cfOversampling An integer parameter.
  * @param cfList A vector of strings parameter.
  * @param mode A string parameter.
+ * @param nThreads An integer parameter.
+ * @param subCFCacheName A string parameter.
+ * @param pixelType A string parameter.
  */
 PYBIND11_MODULE(coyote2py, m) {
     m.doc() = "pybind11-based roadrunner python plugin"; // optional module docstring
@@ -84,6 +87,9 @@ PYBIND11_MODULE(coyote2py, m) {
         "cfBufferSize"_a,  // int
         "cfOversampling"_a,  // int
         "cfList"_a=cfList ,  // std::vector<std::string>
-        "mode"_a=""  // std::string
+        "mode"_a="",  // std::string
+        "nThreads"_a=1,  // int
+        "subCFCacheName"_a="",  // std::string
+        "pixelType"_a="complex"  // std::string
         );
 }
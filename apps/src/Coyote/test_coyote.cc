@@ -38,7 +38,18 @@
 #include <msvis/MSVis/ViFrequencySelection.h>
 #include <casacore/ms/MeasurementSets/MeasurementSet.h>
 #include <synthesis/TransformMachines2/Utils.h>
+#include <synthesis/TransformMachines2/CFCPack.h>
+#include <synthesis/TransformMachines2/CFCacheIndex.h>
+#include <synthesis/TransformMachines2/CFResidency.h>
+#include <synthesis/TransformMachines2/CFRotationCache.h>
+#include <casacore/coordinates/Coordinates/CoordinateUtil.h>
+#include <casacore/casa/Arrays/ArrayMath.h>
+#include <casacore/casa/BasicSL/Constants.h>
 #include <experimental/filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
 namespace fs = std::experimental::filesystem;
 using namespace std::filesystem;
 
@@ -62,7 +73,8 @@ TEST(CoyoteTest, UIFactory) {
     mode="dryrun";
   std::vector<std::string> cfList;
   float cellSize=0.025;
-  int NX=1400, nW=1, cfBufferSize=1, cfOversampling=20;
+  int NX=1400, nW=1, cfBufferSize=1, cfOversampling=20, nThreads=1;
+  string subCFCache="", pixelType="complex";
   bool WBAwp=true;
   bool restartUI=false;
   bool conjBeams=true;
@@ -81,7 +93,7 @@ TEST(CoyoteTest, UIFactory) {
      fieldStr, spwStr, phaseCenter, conjBeams,
      cfBufferSize, cfOversampling,
      cfList,
-     mode);
+     mode, nThreads, subCFCache, pixelType);
 
   EXPECT_EQ(telescopeName, "EVLA");
   EXPECT_EQ(cfCache, "test");
@@ -103,7 +115,8 @@ TEST(CoyoteTest, UIThrow) {
     mode="dryrun";
   std::vector<std::string> cfList;
   float cellSize=0.025;
-  int NX=1400, nW=1, cfBufferSize=1, cfOversampling=20;
+  int NX=1400, nW=1, cfBufferSize=1, cfOversampling=20, nThreads=1;
+  string subCFCache="", pixelType="complex";
   bool WBAwp=true;
   bool restartUI=false;
   bool conjBeams=true;
@@ -123,7 +136,7 @@ TEST(CoyoteTest, UIThrow) {
        fieldStr, spwStr, phaseCenter, conjBeams,
        cfBufferSize, cfOversampling,
        cfList,
-       mode);
+       mode, nThreads, subCFCache, pixelType);
     FAIL() << "Expected an exception to be thrown";
   }
   catch (const std::exception& e) {
@@ -164,6 +177,9 @@ TEST(CoyoteTest, UIThrow) {
     int cfOversampling = 20;
     std::vector<std::string> cfList;
     string mode = "dryrun";
+    int nThreads = 1;
+    string subCFCacheName = "";
+    string pixelType = "complex";
   //
   //-----------------------------------------------------------------------------------------
   //
@@ -194,7 +210,7 @@ TEST(CoyoteTest, UIThrow) {
 
     Coyote(msName, telescopeName, NX, cellSize, stokes, refFreqStr, nW, cfCacheName,
            WBAwp, aTerm, psTerm, mType, pa, dpa, fieldStr, spwStr, phaseCenter,
-           conjBeams, cfBufferSize, cfOversampling, cfList, mode);
+           conjBeams, cfBufferSize, cfOversampling, cfList, mode, nThreads, subCFCacheName, pixelType);
 
     // Add assertions here to verify the behavior of the Coyote function in dryrun mode produces the required images.
     for (int j = 0; j < 16; j++) {
@@ -279,6 +295,32 @@ TEST(CoyoteTest, UIThrow) {
     // cgrid_csys.rec and iminfo.rec.
   }
 
+  TEST(CoyoteTest, CoyoteListCF) {
+    fs::current_path(test::testDir);
+
+    string mode_l="listcf", subCFCacheName_l="sub_awp.cf";
+    std::vector<std::string> cfList_l;
+    Coyote(msName, telescopeName, NX, cellSize, stokes, refFreqStr, nW, cfCacheName,
+	   WBAwp, aTerm, psTerm, mType, pa, dpa, fieldStr, spwStr, phaseCenter,
+	   conjBeams, cfBufferSize, cfOversampling, cfList_l, mode_l, nThreads, subCFCacheName_l, pixelType);
+
+    // The W-planes needed are listed from the first one, with both
+    // the Mueller elements.
+    ASSERT_FALSE(cfList_l.empty());
+    EXPECT_EQ(cfList_l[0], "CFS_0_0_CF_0_0_0.im");
+    EXPECT_EQ(cfList_l.size() % 2, 0u);
+    for (auto cf : cfList_l)
+      {
+	EXPECT_TRUE(fs::exists(subCFCacheName_l+"/"+cf)) << cf << " not in the sub-CFC";
+	EXPECT_TRUE(fs::exists(subCFCacheName_l+"/WT"+cf)) << "WT" << cf << " not in the sub-CFC";
+      }
+    // The CFC-level meta information is copied too.
+    for (auto rec : {"cgrid_csys.rec", "iminfo.rec"})
+      EXPECT_EQ(fs::exists(cfCacheName+"/"+rec), fs::exists(subCFCacheName_l+"/"+rec));
+
+    fs::remove_all(subCFCacheName_l);
+  }
+
   TEST(CoyoteTest, CoyoteFillCF) {
 
       {
@@ -319,9 +361,16 @@ TEST(CoyoteTest, UIThrow) {
 	    //
 	    std::vector<std::string> cfList_l={"CFS_0_0_CF_0_0_0.im","CFS_0_0_CF_0_0_1.im"};
 	    cerr << cfList_l.size() << endl;
+	    // A copy of the CFC with the blank CFs, to fill them on
+	    // one thread below.
+	    string serialCFCacheName_l=cfCacheName+".serial";
+	    fs::remove_all(serialCFCacheName_l);
+	    fs::copy(cfCacheName, serialCFCacheName_l, fs::copy_options::recursive);
+	    // Fill the two CFs on two threads.
+	    int nThreads_l=2;
 	    Coyote(msName, telescopeName, NX, cellSize, stokes, refFreqStr, nW, cfCacheName,
 		   WBAwp, aTerm, psTerm, mType, pa, dpa, fieldStr, spwStr, phaseCenter,
-		   conjBeams, cfBufferSize, cfOversampling, cfList_l, mode_l);
+		   conjBeams, cfBufferSize, cfOversampling, cfList_l, mode_l, nThreads_l, subCFCacheName, pixelType);
 
 	    // Add assertions here to verify the behavior of the Coyote function in fillcf mode
 	    for(auto cf : cfList_l)
@@ -342,6 +391,58 @@ TEST(CoyoteTest, UIThrow) {
 		  EXPECT_EQ(support, 15);
 		}
 	      }	
+
+	    //
+	    // The CFs filled on one thread must be bit-identical to
+	    // those filled on two.
+	    //
+	    {
+	      int nThreadsSerial_l=1;
+	      Coyote(msName, telescopeName, NX, cellSize, stokes, refFreqStr, nW, serialCFCacheName_l,
+		     WBAwp, aTerm, psTerm, mType, pa, dpa, fieldStr, spwStr, phaseCenter,
+		     conjBeams, cfBufferSize, cfOversampling, cfList_l, mode_l, nThreadsSerial_l,
+		     subCFCacheName, pixelType);
+	      for (auto cf : cfList_l)
+		for (string prefix : {"", "WT"})
+		  {
+		    casacore::Array<casacore::Complex>
+		      threaded_l=casacore::PagedImage<casacore::Complex>(cfCacheName+"/"+prefix+cf).get(),
+		      serial_l=casacore::PagedImage<casacore::Complex>(serialCFCacheName_l+"/"+prefix+cf).get();
+		    ASSERT_EQ(threaded_l.shape(), serial_l.shape()) << prefix << cf;
+		    EXPECT_TRUE(casacore::allEQ(threaded_l, serial_l)) << prefix << cf;
+		  }
+	      fs::remove_all(serialCFCacheName_l);
+	    }
+
+	    //
+	    // Pack the CFs with half-precision pixels.  The pixels
+	    // from the packed CFC must be within the precision of
+	    // the half floats of those of the CFs.
+	    //
+	    {
+	      std::vector<casacore::Array<casacore::Complex> > pix_l;
+	      for(auto cf : cfList_l)
+		pix_l.push_back(casacore::PagedImage<casacore::Complex>(cfCacheName+"/"+cf).get());
+
+	      string packMode_l="packcf", pixelType_l="half";
+	      Coyote(msName, telescopeName, NX, cellSize, stokes, refFreqStr, nW, cfCacheName,
+		     WBAwp, aTerm, psTerm, mType, pa, dpa, fieldStr, spwStr, phaseCenter,
+		     conjBeams, cfBufferSize, cfOversampling, cfList_l, packMode_l, nThreads,
+		     subCFCacheName, pixelType_l);
+
+	      std::shared_ptr<refim::CFCPack> pack_l=refim::CFCPack::open(cfCacheName);
+	      ASSERT_TRUE(pack_l != nullptr);
+	      EXPECT_EQ(pack_l->getPixelType(), refim::CFCPack::HALF);
+	      for (unsigned int i=0; i<cfList_l.size(); i++)
+		{
+		  casacore::Array<casacore::Complex> packed_l=
+		    SynthesisUtils::getCFPixels(cfCacheName, cfList_l[i]);
+		  ASSERT_EQ(packed_l.shape(), pix_l[i].shape());
+		  float peak_l=casacore::max(casacore::amplitude(pix_l[i]));
+		  EXPECT_LE(casacore::max(casacore::amplitude(packed_l-pix_l[i])), 1e-3*peak_l) << cfList_l[i];
+		}
+	      refim::CFCPack::remove(cfCacheName);
+	    }
 	  }
 	// Set the current working directory back to the parent dir
         current_path("..");
@@ -349,5 +450,402 @@ TEST(CoyoteTest, UIThrow) {
 	fs::remove_all(test::testDir);
       }
   }
+  //
+  //-----------------------------------------------------------------------------------------
+  // The unit tests of the CFC classes.  Each test uses synthetic CFs
+  // in a CFCache directory of its own.
+  //
+  class CFCUnitTest : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      cfcDir=string(fs::current_path())+"/"+::testing::UnitTest::GetInstance()->current_test_info()->name()+".cf";
+      fs::remove_all(cfcDir);
+      fs::create_directory(cfcDir);
+    }
+    void TearDown() override {fs::remove_all(cfcDir);}
+    //
+    // Make the CF name (n x n pixels, with its meta information
+    // Records) for the PA pa (deg.), and return its pixels.  The CF
+    // is an off-center Gaussian with a phase gradient, so that it is
+    // not rotationally symmetric.
+    //
+    casacore::Array<casacore::Complex> makeCF(const string& name, const int n, const double pa)
+    {
+      casacore::IPosition shape(4, n, n, 1, 1);
+      casacore::CoordinateSystem cs=casacore::CoordinateUtil::defaultCoords4D();
+      casacore::PagedImage<casacore::Complex> cf(shape, cs, cfcDir+"/"+name);
+      casacore::Array<casacore::Complex> pix(shape);
+      for (int y=0; y<n; y++)
+	for (int x=0; x<n; x++)
+	  {
+	    double r2=((x-0.4*n)*(x-0.4*n) + (y-0.55*n)*(y-0.55*n))/(0.01*n*n);
+	    pix(casacore::IPosition(4,x,y,0,0))=std::polar((float)exp(-r2), (float)(0.3*(x-y)));
+	  }
+      cf.put(pix);
+      casacore::TableRecord miscInfo;
+      miscInfo.define("ParallacticAngle", pa);
+      miscInfo.define("Name", casacore::String(name));
+      miscInfo.define("Sampling", (float)20.0);
+      cf.setMiscInfo(miscInfo);
+      SynthesisUtils::ImageInformation<casacore::Complex> imInfo(cf, cfcDir+"/"+name);
+      imInfo.save();
+      return pix;
+    }
+
+    string cfcDir;
+  };
+
+  TEST_F(CFCUnitTest, CFCPackRoundTrip) {
+    // The pixels and the meta information of the CFs from the packed
+    // CFC (with COMPLEX pixels) must be those of the CFs.
+    std::vector<casacore::String> names={"CFS_0_0_CF_0_0_0.im", "CFS_0_0_CF_0_1_0.im"};
+    std::vector<casacore::Array<casacore::Complex> > pix;
+    pix.push_back(makeCF(names[0], 32, 0.0));
+    pix.push_back(makeCF(names[1], 48, 10.0));
+
+    casacore::Int64 bytes=refim::CFCPack::pack(cfcDir, names, refim::CFCPack::COMPLEX);
+    EXPECT_GE(bytes, (casacore::Int64)((32*32+48*48)*sizeof(casacore::Complex)));
+
+    std::shared_ptr<refim::CFCPack> pack=refim::CFCPack::open(cfcDir);
+    ASSERT_TRUE(pack != nullptr);
+    EXPECT_EQ(pack->getPixelType(), refim::CFCPack::COMPLEX);
+    ASSERT_EQ(pack->entries().size(), names.size());
+    for (unsigned int i=0; i<names.size(); i++)
+      {
+	const refim::CFCPack::Entry* e=pack->find(names[i]);
+	ASSERT_TRUE(e != NULL) << names[i];
+	EXPECT_EQ(e->offset % refim::CFCPack::alignment, 0);
+	EXPECT_EQ(e->shape, pix[i].shape());
+	double pa;
+	e->miscInfo.get("ParallacticAngle", pa);
+	EXPECT_DOUBLE_EQ(pa, 10.0*i);
+	EXPECT_TRUE(casacore::allEQ(pack->pixels(*e), pix[i])) << names[i];
+	// The lazy-fill path reads the packed CFC too.
+	EXPECT_TRUE(casacore::allEQ(SynthesisUtils::getCFPixels(cfcDir, names[i]), pix[i])) << names[i];
+      }
+    EXPECT_TRUE(pack->find("CFS_0_0_CF_0_2_0.im") == NULL);
+
+    EXPECT_TRUE(refim::CFCPack::remove(cfcDir));
+    EXPECT_TRUE(refim::CFCPack::open(cfcDir) == nullptr);
+  }
+
+  TEST_F(CFCUnitTest, CFResidencyBudget) {
+    // With a budget of two CFs, admitting a third (in a new epoch)
+    // must release the least recently used one.  The released CFCell
+    // must then be loaded again (as in AWVisResampler) with its
+    // pixels and the PA from the disk.
+    std::vector<casacore::String> names={"CFS_0_0_CF_0_0_0.im", "CFS_0_0_CF_0_1_0.im", "CFS_0_0_CF_0_2_0.im"};
+    std::vector<casacore::Array<casacore::Complex> > pix;
+    for (unsigned int i=0; i<names.size(); i++) pix.push_back(makeCF(names[i], 32, 10.0*i));
+    const casacore::Int64 cfBytes=32*32*sizeof(casacore::Complex);
+
+    refim::CFResidency& residency=refim::CFResidency::instance();
+    residency.clear();
+    residency.setBudget(2*cfBytes);
+    residency.resetStats();
+
+    casacore::CoordinateSystem cs=casacore::CoordinateUtil::defaultCoords4D();
+    casacore::Float samp=20.0;
+    std::vector<casacore::CountedPtr<CFCell> > cells;
+    for (unsigned int i=0; i<names.size(); i++)
+      {
+	casacore::Array<casacore::Complex> tt=SynthesisUtils::getCFPixels(cfcDir, names[i]);
+	cells.push_back(new CFCell(tt, cs, samp));
+	cells[i]->fileName_p=names[i];
+	cells[i]->pa_p=casacore::Quantity(10.0*i, "deg");
+
+	residency.newEpoch();
+	residency.admit(cells[i], cells[i]->pa_p);
+	// As if rotated for the PA of the data.
+	cells[i]->pa_p=casacore::Quantity(45.0, "deg");
+	EXPECT_LE(residency.getStats().residentBytes, 2*cfBytes);
+      }
+
+    refim::CFResidency::Stats stats=residency.getStats();
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.nResident, 2);
+    EXPECT_EQ(stats.residentBytes, 2*cfBytes);
+    EXPECT_EQ(cells[0]->getStorage()->nelements(), 0u);
+    EXPECT_DOUBLE_EQ(cells[0]->pa_p.getValue("deg"), 0.0);
+    for (unsigned int i=1; i<names.size(); i++)
+      EXPECT_TRUE(casacore::allEQ(*(cells[i]->getStorage()), pix[i]));
+
+    // Load the released CFCell again.  This releases the next least
+    // recently used one.
+    residency.newEpoch();
+    casacore::Array<casacore::Complex> tt=SynthesisUtils::getCFPixels(cfcDir, cells[0]->fileName_p);
+    cells[0]->referenceStorage(tt);
+    residency.admit(cells[0], cells[0]->pa_p);
+    EXPECT_TRUE(casacore::allEQ(*(cells[0]->getStorage()), pix[0]));
+    EXPECT_DOUBLE_EQ(cells[0]->pa_p.getValue("deg"), 0.0);
+    EXPECT_EQ(cells[1]->getStorage()->nelements(), 0u);
+    EXPECT_DOUBLE_EQ(cells[1]->pa_p.getValue("deg"), 10.0);
+
+    stats=residency.getStats();
+    EXPECT_EQ(stats.evictions, 2);
+    EXPECT_LE(stats.residentBytes, 2*cfBytes);
+    EXPECT_LE(stats.peakBytes, 3*cfBytes);
+
+    // In the same epoch, the CFs in use are kept even beyond the
+    // budget.
+    residency.touch(cells[2]);
+    tt=SynthesisUtils::getCFPixels(cfcDir, cells[1]->fileName_p);
+    cells[1]->referenceStorage(tt);
+    residency.admit(cells[1], cells[1]->pa_p);
+    for (unsigned int i=0; i<names.size(); i++)
+      EXPECT_GT(cells[i]->getStorage()->nelements(), 0u) << names[i];
+
+    residency.clear();
+    residency.setBudget(0);
+  }
+
+  TEST_F(CFCUnitTest, CFCacheIndex) {
+    // The meta information from the index must be that from the
+    // Records of the CF, and an entry must not be used once the
+    // Records are modified.
+    std::vector<casacore::String> names={"CFS_0_0_CF_0_0_0.im", "CFS_0_0_CF_0_1_0.im"};
+    for (unsigned int i=0; i<names.size(); i++) makeCF(names[i], 32+16*i, 10.0*i);
+
+    {
+      refim::CFCacheIndex index(cfcDir);
+      SynthesisUtils::ImageInformation<casacore::Complex> imInfo;
+      EXPECT_FALSE(index.get(names[0], imInfo));
+      for (auto name : names)
+	{
+	  SynthesisUtils::ImageInformation<casacore::Complex> diskInfo(cfcDir+"/"+name);
+	  index.put(name, diskInfo);
+	}
+      EXPECT_TRUE(index.save());
+    }
+    ASSERT_TRUE(fs::exists(cfcDir+"/"+refim::CFCacheIndex::fileName));
+
+    {
+      refim::CFCacheIndex index(cfcDir);
+      for (unsigned int i=0; i<names.size(); i++)
+	{
+	  SynthesisUtils::ImageInformation<casacore::Complex> diskInfo(cfcDir+"/"+names[i]), imInfo;
+	  ASSERT_TRUE(index.get(names[i], imInfo)) << names[i];
+	  EXPECT_TRUE(casacore::allEQ(imInfo.getImShape(), diskInfo.getImShape())) << names[i];
+	  EXPECT_TRUE(imInfo.getCoordinateSystem().near(diskInfo.getCoordinateSystem())) << names[i];
+	  double pa;
+	  imInfo.getMiscInfo().get("ParallacticAngle", pa);
+	  EXPECT_DOUBLE_EQ(pa, 10.0*i);
+	}
+    }
+
+    // Modify the miscInfo Record of the second CF.
+    string miscInfo=cfcDir+"/"+names[1]+"/miscInfo.rec";
+    auto later=fs::last_write_time(miscInfo)+std::chrono::seconds(10);
+    fs::last_write_time(miscInfo, later);
+    if (fs::exists(miscInfo+"/table.dat")) fs::last_write_time(miscInfo+"/table.dat", later);
+    {
+      refim::CFCacheIndex index(cfcDir);
+      SynthesisUtils::ImageInformation<casacore::Complex> imInfo;
+      EXPECT_TRUE(index.get(names[0], imInfo));
+      EXPECT_FALSE(index.get(names[1], imInfo));
+    }
+
+    // An unreadable index is ignored.
+    {
+      std::ofstream(cfcDir+"/"+refim::CFCacheIndex::fileName) << "Not an index";
+    }
+    refim::CFCacheIndex index(cfcDir);
+    SynthesisUtils::ImageInformation<casacore::Complex> imInfo;
+    EXPECT_FALSE(index.get(names[0], imInfo));
+  }
+
+  TEST_F(CFCUnitTest, CFRotationCache) {
+    // A CF must be rotated once per PA bin, the rotated pixels must
+    // then come from the cache, and forget() must drop them.
+    casacore::String name="CFS_0_0_CF_0_0_0.im";
+    casacore::Array<casacore::Complex> pix=makeCF(name, 32, 0.0);
+    const casacore::Int64 cfBytes=32*32*sizeof(casacore::Complex);
+    const double tol=casacore::C::pi/180.0;
+
+    refim::CFRotationCache& cache=refim::CFRotationCache::instance();
+    cache.clear();
+    cache.resetStats();
+
+    casacore::CoordinateSystem cs=casacore::CoordinateUtil::defaultCoords4D();
+    casacore::Float samp=20.0;
+    casacore::Array<casacore::Complex> tt=SynthesisUtils::getCFPixels(cfcDir, name);
+    casacore::CountedPtr<CFCell> cell=new CFCell(tt, cs, samp);
+    cell->fileName_p=name;
+    cell->pa_p=casacore::Quantity(0.0, "deg");
+
+    // Within the tolerance of the PA of the CF.
+    cache.rotate(0.5*tol, cell, tol);
+    EXPECT_EQ(cache.getStats().unchanged, 1);
+    EXPECT_TRUE(casacore::allEQ(*(cell->getStorage()), pix));
+
+    // Rotated to the center of the bin.
+    cache.rotate(10.2*tol, cell, tol);
+    refim::CFRotationCache::Stats stats=cache.getStats();
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.cachedBytes, cfBytes);
+    EXPECT_NEAR(cell->pa_p.getValue("deg"), 10.0, 1e-9);
+    EXPECT_FALSE(casacore::allEQ(*(cell->getStorage()), pix));
+    casacore::Array<casacore::Complex> rotated=cell->getStorage()->copy();
+
+    // Back to the bin of the un-rotated CF, and to the rotated bin
+    // again: no more rotations.
+    cache.rotate(0.0, cell, tol);
+    EXPECT_TRUE(casacore::allEQ(*(cell->getStorage()), pix));
+    cache.rotate(9.8*tol, cell, tol);
+    EXPECT_TRUE(casacore::allEQ(*(cell->getStorage()), rotated));
+    stats=cache.getStats();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.cachedBytes, cfBytes);
+
+    cache.forget(&(*cell));
+    EXPECT_EQ(cache.getStats().cachedBytes, 0);
+
+    // The CF is now rotated from its current pixels.
+    cache.rotate(20.0*tol, cell, tol);
+    stats=cache.getStats();
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.cachedBytes, cfBytes);
+    EXPECT_NEAR(cell->pa_p.getValue("deg"), 20.0, 1e-9);
+
+    cache.clear();
+  }
+
+  TEST_F(CFCUnitTest, CFCPackQuant8Bounds) {
+    // The pixels of the CF packed as QUANT8 must be within the
+    // bounds in CFCPack.h: a relative error of the amplitude < 3%
+    // (half a step of the log. amplitude) and a phase error <= 0.70
+    // deg (half of the 1.41 deg step), down to quant8DynamicRange
+    // below the peak.  Smaller amplitudes are 0.
+    casacore::String name="CFS_0_0_CF_0_0_0.im";
+    casacore::Array<casacore::Complex> pix=makeCF(name, 64, 0.0);
+    refim::CFCPack::pack(cfcDir, {name}, refim::CFCPack::QUANT8);
+    std::shared_ptr<refim::CFCPack> pack=refim::CFCPack::open(cfcDir);
+    ASSERT_TRUE(pack != nullptr);
+    EXPECT_EQ(pack->getPixelType(), refim::CFCPack::QUANT8);
+    const refim::CFCPack::Entry* e=pack->find(name);
+    ASSERT_TRUE(e != NULL);
+    casacore::Array<casacore::Complex> packed=pack->pixels(*e);
+    ASSERT_EQ(packed.shape(), pix.shape());
+
+    const double halfStep=0.5*std::log(1.0/refim::CFCPack::quant8DynamicRange)/254.0;
+    const double maxAmpErr=std::exp(halfStep)-1.0, maxPhaseErr=180.0/256.0;
+    EXPECT_LT(maxAmpErr, 0.03);
+    EXPECT_LT(maxPhaseErr, 0.70+0.005);
+
+    float peak=casacore::max(casacore::amplitude(pix));
+    casacore::Bool dummy;
+    const casacore::Complex *orig=pix.getStorage(dummy), *dec=packed.getStorage(dummy);
+    casacore::Int nChecked=0, nZero=0;
+    for (size_t i=0; i<pix.nelements(); i++)
+      {
+	double amp=std::abs(orig[i])/peak;
+	if (amp >= refim::CFCPack::quant8DynamicRange*std::exp(halfStep))
+	  {
+	    EXPECT_LE(std::fabs(std::abs(dec[i])/std::abs(orig[i])-1.0), maxAmpErr+1e-5) << i;
+	    double dPhase=std::fabs(std::arg(dec[i]*std::conj(orig[i])))*180.0/casacore::C::pi;
+	    EXPECT_LE(dPhase, maxPhaseErr+1e-3) << i;
+	    nChecked++;
+	  }
+	else if (amp < refim::CFCPack::quant8DynamicRange)
+	  {
+	    EXPECT_EQ(dec[i], casacore::Complex(0.0)) << i;
+	    nZero++;
+	  }
+      }
+    // Both the ranges are in the CF.
+    EXPECT_GT(nChecked, 0);
+    EXPECT_GT(nZero, 0);
+
+    refim::CFCPack::remove(cfcDir);
+  }
+
+  TEST_F(CFCUnitTest, CFCPackSharedMemory) {
+    // Two users of a packed CFC (here via the CFCache directory and
+    // a symbolic link to it) must share one shared memory segment,
+    // and the last one to detach must remove it.  A segment left
+    // behind by a process that crashed must be re-used, and removed
+    // by the last process using it.
+    std::vector<casacore::String> names={"CFS_0_0_CF_0_0_0.im", "CFS_0_0_CF_0_1_0.im"};
+    std::vector<casacore::Array<casacore::Complex> > pix;
+    for (unsigned int i=0; i<names.size(); i++) pix.push_back(makeCF(names[i], 32, 10.0*i));
+    refim::CFCPack::pack(cfcDir, names, refim::CFCPack::QUANT8);
+    string link=cfcDir+".link";
+    fs::remove(link);
+    fs::create_directory_symlink(cfcDir, link);
+    setenv("CFCache_SHAREDMEM", "1", 1);
+
+    std::shared_ptr<refim::CFCPack> pack1=refim::CFCPack::open(cfcDir);
+    ASSERT_TRUE(pack1 != nullptr);
+    string segment=pack1->sharedSegment();
+    if (segment.empty())
+      {
+	unsetenv("CFCache_SHAREDMEM");
+	refim::CFCPack::close(cfcDir);
+	fs::remove(link);
+	GTEST_SKIP() << "POSIX shared memory is not available";
+      }
+    string segmentFile="/dev/shm"+segment;
+    EXPECT_TRUE(fs::exists(segmentFile));
+    EXPECT_EQ(pack1->nSharedUsers(), 1);
+
+    std::shared_ptr<refim::CFCPack> pack2=refim::CFCPack::open(link);
+    ASSERT_TRUE(pack2 != nullptr);
+    EXPECT_NE(pack1.get(), pack2.get());
+    EXPECT_EQ(pack2->sharedSegment(), segment);
+    EXPECT_EQ(pack1->nSharedUsers(), 2);
+    for (unsigned int i=0; i<names.size(); i++)
+      {
+	casacore::Array<casacore::Complex> pix1=pack1->pixels(*(pack1->find(names[i])));
+	casacore::Array<casacore::Complex> pix2=pack2->pixels(*(pack2->find(names[i])));
+	EXPECT_TRUE(casacore::allEQ(pix1, pix2)) << names[i];
+	float peak=casacore::max(casacore::amplitude(pix[i]));
+	EXPECT_LE(casacore::max(casacore::amplitude(pix1-pix[i])), 0.03*peak) << names[i];
+      }
+
+    pack1.reset();
+    refim::CFCPack::close(cfcDir);
+    EXPECT_TRUE(fs::exists(segmentFile));
+    EXPECT_EQ(pack2->nSharedUsers(), 1);
+    pack2.reset();
+    refim::CFCPack::close(link);
+    EXPECT_FALSE(fs::exists(segmentFile));
+
+    // A process that attaches, decodes a CF and exits without
+    // detaching (as if it crashed).
+    pid_t child=fork();
+    if (child == 0)
+      {
+	std::shared_ptr<refim::CFCPack> pack=refim::CFCPack::open(cfcDir);
+	bool ok=pack && (pack->sharedSegment() == segment) &&
+	  (pack->pixels(pack->entries()[0]).nelements() > 0);
+	_exit(ok ? 0 : 1);
+      }
+    int status;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_TRUE(fs::exists(segmentFile));
+
+    pack1=refim::CFCPack::open(cfcDir);
+    ASSERT_TRUE(pack1 != nullptr);
+    EXPECT_EQ(pack1->sharedSegment(), segment);
+    EXPECT_EQ(pack1->nSharedUsers(), 1);
+    for (unsigned int i=0; i<names.size(); i++)
+      {
+	float peak=casacore::max(casacore::amplitude(pix[i]));
+	casacore::Array<casacore::Complex> pix1=pack1->pixels(*(pack1->find(names[i])));
+	EXPECT_LE(casacore::max(casacore::amplitude(pix1-pix[i])), 0.03*peak) << names[i];
+      }
+    pack1.reset();
+    refim::CFCPack::close(cfcDir);
+    EXPECT_FALSE(fs::exists(segmentFile));
+
+    unsetenv("CFCache_SHAREDMEM");
+    fs::remove(link);
+  }
 
 };
@@ -34,25 +34,26 @@
 #include <libracore/DataBase.h>
 #include <libracore/MakeComponents.h>
 #include <roadrunner.h>
+#include <casacore/casa/Utilities/Regex.h>
+#include <synthesis/TransformMachines2/ImageInformation.h>
 
 std::exception_ptr CFServerThreadExceptionPtr_g = nullptr;
 
 CountedPtr<refim::FTMachine> ftm_g;
-hpg::CFSimpleIndexer cfsi_g({1,false},{1,false},{1,true},{1,true}, 1);
-std::shared_ptr<hpg::RWDeviceCFArray> dcfa_sptr_g;
 bool isRoot=true;
 
 //
 //---------------------------------------------------------------------------------------
 //
-std::tuple<bool, std::shared_ptr<hpg::RWDeviceCFArray>>
+CFSet
 prepCFEngine(casa::refim::MakeCFArray& mkCF,
 	     bool WBAwp, int nW,
 	     int ispw, double spwRefFreq,
 	     int nDataPol,
 	     casacore::ImageInterface<casacore::Float>& skyImage,
 	     casacore::Vector<Int>& polMap,
-	     casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l
+	     casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l,
+	     double maxW, double minPA, double maxPA
 	     )
 {
   LogIO log_l(LogOrigin("roadrunner","prepCFEngine"));
@@ -71,113 +72,146 @@ prepCFEngine(casa::refim::MakeCFArray& mkCF,
 		      cfs2_l,
 		      ispw, spwRefFreq,
 		      nDataPol,
-		      wNdxList, spwNdxList);
+		      wNdxList, spwNdxList,
+		      maxW, minPA, maxPA);
   auto endMkCF = std::chrono::steady_clock::now();
   std::chrono::duration<double> runtimeMkCF = endMkCF - startMkCF;
-  bool newCF=std::get<0>(ret);
-  std::shared_ptr<hpg::RWDeviceCFArray> dcf_sptr;
-  if (newCF)
+  CFSet cfSet;
+  cfSet.newCF=std::get<0>(ret);
+  if (cfSet.newCF)
     {
       casa::refim::MyCFArray cfArray;
       cfShapeList = std::get<4>(ret);
       log_l << "Make CF Array run time: " << runtimeMkCF.count() << " sec" << LogIO::POST;
-      log_l //<< "CF W list: " << wNdxList << endl
+      log_l << "CF W list: " << wNdxList << LogIO::POST
 	<< "CF SPW List: " << spwNdxList << LogIO::POST
 	<< "CF Shapes: ";
       for(auto s : cfShapeList) log_l << s << " "; log_l << LogIO::POST;
-      cfsi_g = get<2>(ret);
+      cfSet.cfsi = get<2>(ret);
 
-      dcf_sptr = std::get<3>(ret);
+      cfSet.dcfa = std::get<3>(ret);
 
       log_l << "done." << LogIO::POST;
     }
-  return std::make_tuple(newCF,dcf_sptr);
+  return cfSet;
 }
 //
 //---------------------------------------------------------------------------------------
+// The size (bytes) of the pixels of a CF set.
 //
-void CFServer(libracore::ThreadCoordinator& thcoord,
+size_t cfSetBytes(const CFSet& cfSet)
+{
+  size_t bytes=0;
+  if (cfSet.dcfa)
+    for (unsigned g=0; g<cfSet.dcfa->num_groups(); g++)
+      {
+	auto ext = cfSet.dcfa->extents(g);
+	bytes += (size_t)ext[0]*ext[1]*ext[2]*ext[3]*sizeof(hpg::CFArray::value_type);
+      }
+  return bytes;
+}
+//
+//---------------------------------------------------------------------------------------
+// Whether the CFs in the CFCache cfCache include the A-term and the PS
+// term, from the meta information of one of its CFs.  Returns false
+// if this is not known (e.g. no CFs, or CFs made before this was
+// recorded).
+//
+bool getCFCTerms(const string& cfCache, Bool& aTermOn, Bool& psTermOn)
+{
+  try
+    {
+      Directory cfcDir(cfCache);
+      Vector<String> cfNames=cfcDir.find(Regex::fromPattern("CFS_*.im"), false, false);
+      if (cfNames.nelements() == 0) return false;
+      TableRecord miscInfo=
+	casa::refim::SynthesisUtils::ImageInformation<Complex>(cfCache+"/"+cfNames(0)).getMiscInfo();
+      if (!miscInfo.isDefined("aTermOn") || !miscInfo.isDefined("psTermOn")) return false;
+      miscInfo.get("aTermOn", aTermOn);
+      miscInfo.get("psTermOn", psTermOn);
+      return true;
+    }
+  catch (AipsError &)
+    {
+      return false;
+    }
+}
+//
+//---------------------------------------------------------------------------------------
+//
+void CFServer(libracore::LookaheadQueue<CFSet>& cfQueue,
 	      casa::refim::MakeCFArray& mkCF,
 	      bool& WBAwp, int& nW,
 	      casacore::ImageInterface<casacore::Float>& skyImage,
 	      casacore::Vector<Int>& polMap,
 	      casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l,
-	      std::vector<int>& spwidList,
-	      std::vector<double>& spwRefFreqList,
+	      std::vector<CFWorkItem>& cfWorkList,
 	      int& nDataPol)
 {
   try
     {
       LogIO os(LogOrigin("roadrunner","CFServer"));
-      for(auto ispw : spwidList)
+      // The same CFs are used for all SPWs.
+      bool sameCFs = (((nW == 1) && (WBAwp == true)) ||  // A-only projection
+		      ((nW > 1) && (WBAwp == false)));   // W-only projection
+      for(auto& cfItem : cfWorkList)
 	{
 	  os << ".................CFServer................" << LogIO::POST;
 
-	  //Declare the in-memory CFCache dirty.  Specifically, the memory
-	  //accessed by the dcfa_sptr_g point should be considered dirty and
-	  //remain so till prepCFEngine returns.
-	  thcoord.setCFReady(false);
-	  // Using the global VB to get SPWID.  While mostly reliable, vb_g
-	  // is used in the main thread while CFServer runs in another
-	  // thread.  This can lead to runtime issues. If this list can be
-	  // determined up front before starting the data iteration (which
-	  // uses two threads), this can be made reliable.
-	  double spwRefFreq = spwRefFreqList[ispw];//spwRefFreqList[ispw];
-	  // int vbSPWID=(vb_g)->spectralWindows()(0);
+	  // The CF working set is determined in a pre-scan of the MS
+	  // before the start of the data iterations (in the DataBase
+	  // constructor), in the order the data iterations will need
+	  // it.  The global VB, which is used in the main thread, is
+	  // therefore not used here.
+	  int ispw = cfItem.spwID;
+	  double spwRefFreq = cfItem.spwRefFreq;
+	  // The CFs of an SPW are loaded once, for all its runs.
+	  double maxW=cfItem.maxW, minPA=cfItem.minPA, maxPA=cfItem.maxPA;
+	  for (auto& item : cfWorkList)
+	    if (sameCFs || (item.spwID == ispw))
+	      {
+		maxW  = std::max(maxW, item.maxW);
+		minPA = std::min(minPA, item.minPA);
+		maxPA = std::max(maxPA, item.maxPA);
+	      }
 	  os << "iSPW: " << ispw
 	     << ", SPW Ref. Freq. (Hz): " << spwRefFreq
 	     << " conjBeams: " << mkCF.conjBeams()
+	     << ", max |w|: " << maxW
+	     << ", PA: [" << minPA*180.0/C::pi << ", " << maxPA*180.0/C::pi << "] deg"
 	     << LogIO::POST;
-	  auto ret = prepCFEngine(mkCF,
-				  WBAwp, nW,
-				  //vbSPWID,
-				  ispw,
-				  spwRefFreq,nDataPol,
-				  skyImage,
-				  polMap,
-				  cfs2_l);
-	  thcoord.newCF=std::get<0>(ret);
-	  dcfa_sptr_g = std::get<1>(ret);
-
-	  thcoord.setCFReady(true);
-	  thcoord.Notify_CFReady();
-	  os << ".................CFServer waitForCFSent................" << LogIO::POST;
-	  if (thcoord.isEoD())
+	  CFSet cfSet = prepCFEngine(mkCF,
+				     WBAwp, nW,
+				     //vbSPWID,
+				     ispw,
+				     spwRefFreq,nDataPol,
+				     skyImage,
+				     polMap,
+				     cfs2_l,
+				     maxW, minPA, maxPA);
+	  //
+	  // Blocks while the gridder-thread is the maximum no. of CF
+	  // sets behind.  The queue is closed by the gridder-thread at
+	  // the end of the data.
+	  //
+	  size_t bytes=cfSetBytes(cfSet);
+	  if (!cfQueue.push(std::move(cfSet), bytes))
 	    {
 	      os << ".................EoD detected (CFServer exiting)................" << LogIO::POST;
-	      return;
+	      break;
 	    }
-	  thcoord.waitForCFSent();
 
-	  if (
-	      ((nW == 1) && (WBAwp == true)) ||  // A-only projection
-	      ((nW > 1) && (WBAwp == false)) // W-only projection
-	      )
-	    {
-	      thcoord.setEoD(true);
-	      return;
-	    }
-	  // if (vi2_cfsrvr->moreChunks())
-	  //  {
-	  //    vi2_cfsrvr->nextChunk();
-	  //    vi2_cfsrvr->origin(); // So that the associated vb is valid
-	  //    cerr << "Next SPWID from vi2_cfsrvr: " << vb_cfsrvr->spectralWindows()(0) << endl;
-	  //  }
+	  if (sameCFs) break;
 	}
     }
   catch (...)
     {
-      // First setup the global pointer to the exception on the top of
-      // the stack of this thread.
+      // Setup the global pointer to the exception on the top of the
+      // stack of this thread.  The parent thread is unblocked by
+      // closing the queue below.
       CFServerThreadExceptionPtr_g = std::current_exception();
-
-      // Now unblock the parent thread.
-      thcoord.setCFReady(true);
-      thcoord.Notify_CFReady();
-      // Also notify that the CFServer thread is treating this
-      // condition as EoD
-      thcoord.setEoD(true);
     }
+  cfQueue.close();
 }
 //
 //---------------------------------------------------------------------------------------
@@ -368,7 +402,7 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 		string& fieldStr, string& spwStr, string& uvDistStr,
 		bool& doPointing, bool& normalize, bool& doPBCorr,
 		bool& conjBeams, float& pbLimit, vector<float>& posigdev,
-		bool& doSPWDataIter) -> RRReturnType
+		bool& doSPWDataIter, int& nThreads, int& vbPrefetch, bool& sortVis, int& gridTileSize, float& cfMemBudget, bool& aTerm, int& cfLookahead, string& visCacheName) -> RRReturnType
 {
   // LogFilter filter(LogMessage::NORMAL);
   // LogSink::globalSink().filter(filter);
@@ -388,6 +422,15 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 		<<  LogIO::WARN << LogIO::POST;
 	  rmode = "norm";
 	}
+      // mode=all makes the weight, PSF and residual images in one
+      // pass over the data.  The residual image is the main product
+      // (made with ftm_g), and the weight and PSF images are the
+      // additional products (extraProducts below).
+      bool const allProducts = (imagingMode=="all");
+      string mainMode = allProducts ? string("residual") : imagingMode;
+      if (allProducts && (ftmName=="awphpg"))
+	throw(AipsError("mode=all is supported only with gridder=awproject"));
+
       // Set safe defaults...
       casa::refim::FTMachine::Type dataCol_l=casa::refim::FTMachine::CORRECTED;
       if (imagingMode=="predict")       dataCol_l=casa::refim::FTMachine::MODEL;
@@ -418,6 +461,10 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       // on all ranks but the root
       string imageNamePrefix =
 	imageName.substr(0, imageName.find_last_of("."));
+      // The images of mode=all are named with the base name of
+      // imageName and the extension of each product.
+      std::string baseName=librautils::removeExtension(imageName);
+      string mainImageName = allProducts ? baseName+"."+mainMode : imageName;
 
       //
       // -------------------------------------- End of UI -------------------------------------------------------------------
@@ -439,10 +486,17 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       //---------------------------------------------------------------------------------------
       // Construct the CFCache and CFSes.
       //
+      // Without the A-term, the CFs are computed on the fly (in
+      // memory) by the FTMachine if no CFCache is given.
+      //
+      Bool cfOnTheFly = ((!aTerm) && (cfCache == ""));
       CountedPtr<refim::CFCache> cfc(new refim::CFCache(cfCache.c_str()));
+      if (cfOnTheFly) cfc->initInMemory();
 
       casa::refim::SynthesisUtils::CFCHelperCodes whichCFS=casa::refim::SynthesisUtils::CFCHelperCodes::MAKE_CFCFS;
-      if (imagingMode == "psf" || imagingMode=="weight" )
+      if (allProducts)
+	whichCFS=casa::refim::SynthesisUtils::CFCHelperCodes::MAKE_BOTHCFS;
+      else if (imagingMode == "psf" || imagingMode=="weight" )
 	whichCFS=casa::refim::SynthesisUtils::CFCHelperCodes::MAKE_WTCFS;
 
       // Initialize the CFC and construct the in-memory CFSes.  The CFSes
@@ -452,33 +506,36 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       refim::CFCache* cfCacheObj=cfc.get();
       std::string cfcMode="dryrun";
 
-      std::future<std::tuple<CountedPtr<casa::refim::CFStore2>,
-			     CountedPtr<casa::refim::CFStore2>,
-			     std::exception_ptr>> cfsCtor_ret =
-	std::async(std::launch::async,
-		   &casa::refim::SynthesisUtils::constructCFS,
-		   std::ref(cfCacheObj), std::ref(blank),std::ref(blank),
-		   std::ref(cfcMode), std::ref(pa), std::ref(dpa),
-		   std::ref(whichCFS));
       std::shared_future<std::tuple<CountedPtr<casa::refim::CFStore2>,
 				    CountedPtr<casa::refim::CFStore2>,
-				    std::exception_ptr>>
-	shared_cfsCtor_ret = cfsCtor_ret.share();
-
-      log_l << "Started CFS ctor in a thread..." << LogIO::POST;
-      //
-      // Simulate the catch block for exceptions thrown immediately
-      // from a constructCFS() in a separate thread, giving it
-      // sufficient time (1s) to start execution.
-      //
-      {
-	// Blocking check to find if the thread is still running.
-	if (shared_cfsCtor_ret.wait_for(1s) != std::future_status::timeout)
+				    std::exception_ptr>> shared_cfsCtor_ret;
+      if (!cfOnTheFly)
+	{
+	  std::future<std::tuple<CountedPtr<casa::refim::CFStore2>,
+				 CountedPtr<casa::refim::CFStore2>,
+				 std::exception_ptr>> cfsCtor_ret =
+	    std::async(std::launch::async,
+		       &casa::refim::SynthesisUtils::constructCFS,
+		       std::ref(cfCacheObj), std::ref(blank),std::ref(blank),
+		       std::ref(cfcMode), std::ref(pa), std::ref(dpa),
+		       std::ref(whichCFS));
+	  shared_cfsCtor_ret = cfsCtor_ret.share();
+
+	  log_l << "Started CFS ctor in a thread..." << LogIO::POST;
+	  //
+	  // Simulate the catch block for exceptions thrown immediately
+	  // from a constructCFS() in a separate thread, giving it
+	  // sufficient time (1s) to start execution.
+	  //
 	  {
-	    auto ret=shared_cfsCtor_ret.get();
-	    if (std::get<2>(ret) != nullptr) std::rethrow_exception(std::get<2>(ret));
-	  }
-      };
+	    // Blocking check to find if the thread is still running.
+	    if (shared_cfsCtor_ret.wait_for(1s) != std::future_status::timeout)
+	      {
+		auto ret=shared_cfsCtor_ret.get();
+		if (std::get<2>(ret) != nullptr) std::rethrow_exception(std::get<2>(ret));
+	      }
+	  };
+	}
 
       //---------------------------------------------------------------------------------------
 
@@ -538,7 +595,7 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       TempImage<Complex> cgrid=makeEmptySkyImage(*(db.vi2_l), db.selectedMS, db.msSelection,
 						 imSize, cellSize, phaseCenter,
 						 stokes, refFreqStr, mode);
-      PagedImage<Float> skyImage(cgrid.shape(),cgrid.coordinates(), imageName);
+      PagedImage<Float> skyImage(cgrid.shape(),cgrid.coordinates(), mainImageName);
       //      cgrid.table().markForDelete();
 
       // Setup the weighting scheme in the supplied VI2
@@ -563,11 +620,12 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       //-------------------------------------------------------------------
       // Wait for CFS ctor thread to finish...
       //
-      {
-	//auto ret=cfsCtor_ret.get();
-	auto ret=get_async_status(shared_cfsCtor_ret,log_l);
-	if (std::get<2>(ret) != nullptr) std::rethrow_exception(std::get<2>(ret));
-      }
+      if (shared_cfsCtor_ret.valid())
+	{
+	  //auto ret=cfsCtor_ret.get();
+	  auto ret=get_async_status(shared_cfsCtor_ret,log_l);
+	  if (std::get<2>(ret) != nullptr) std::rethrow_exception(std::get<2>(ret));
+	}
       //-------------------------------------------------------------------
       // Create the AWP FTMachine.  The AWProjectionFT is construed
       // with the re-sampler depending on the ftmName (AWVisResampler
@@ -578,6 +636,37 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       MeasTable::Observatory(loc, MSColumns(db.selectedMS).observation().telescopeName()(0));
       Bool useDoublePrec=true, aTermOn=true, psTermOn=false, mTermOn=false,
 	doPSF=(imagingMode=="psf");
+      //
+      // The CFs computed on the fly are those without the A-term, for
+      // which the PS term is the anti-aliasing function.  Otherwise
+      // the terms are those the CFs in the CFCache were made with.
+      //
+      Bool cfcATermOn, cfcPSTermOn;
+      if (cfOnTheFly)
+	{
+	  aTermOn=false;
+	  psTermOn=true;
+	}
+      else if (getCFCTerms(cfCache, cfcATermOn, cfcPSTermOn))
+	{
+	  if (cfcATermOn != (Bool)aTerm)
+	    log_l << "aterm=" << aTerm << ", but the CFs in " << cfCache
+		  << (cfcATermOn ? " include" : " do not include")
+		  << " the A-term.  Using the CFs as they are." << LogIO::WARN;
+	  aTermOn=cfcATermOn;
+	  psTermOn=cfcPSTermOn;
+	}
+      else if (!aTerm)
+	{
+	  aTermOn=false;
+	  psTermOn=true;
+	}
+      // The PSF is made from the imaging weights, flags and UVWs
+      // only.  Its FTMachine is given FTMachine::PSF as the data
+      // column, and the visibilities are then never read.  The weight
+      // image is gridded as before (with dopsf=false), and reads the
+      // data.
+      Bool noVis=(mainMode=="psf");
 
       CountedPtr<refim::VisibilityResamplerBase> visResampler =
 	createAWPFTMachine(ftmName, modelImageName, ftm_g,
@@ -596,8 +685,19 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 			   pbLimit,
 			   posigdev,
 			   imageNamePrefix,
-			   imagingMode
+			   mainMode
 			   );
+      // No. of threads for the CPU (de-)gridder.  NoOp for the HPG
+      // resampler.
+      visResampler->setNumThreads(nThreads);
+      // (De-)grid the samples in bins of the CFs they use.  Has no
+      // effect with the HPG resampler.
+      visResampler->setSortByCF(sortVis);
+      visResampler->setGridTileSize(gridTileSize);
+      // Memory budget for the lazily loaded CF pixels.
+      refim::CFResidency::instance().setBudget((Int64)(cfMemBudget*1024.0*1024.0));
+      refim::CFResidency::instance().resetStats();
+      refim::CFRotationCache::instance().resetStats();
       {
 	// Matrix<Double> mssFreqSel;
 	// mssFreqSel  = db.msSelection.getChanFreqList(NULL,true);
@@ -634,6 +734,123 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       else
 	ftm_g->initializeToSky(cgrid, weight, *(db.vb_l));
 
+      // The CFs computed on the fly are made here, since the CF
+      // server thread (for gridder=awphpg) needs them before the
+      // first VisBuffer is (de-)gridded.
+      if (cfOnTheFly)
+	{
+	  refim::AWProjectFT* awpFT = dynamic_cast<refim::AWProjectFT*>(&(*ftm_g));
+	  if (awpFT != NULL) awpFT->prepConvFunction(cgrid, *(db.vb_l));
+	}
+
+      //
+      // The FTMachines for the additional products of mode=all.
+      // These read the same CFCache as ftm_g and are fed the same
+      // VisBuffers in the data consumer below.  Each FTMachine selects
+      // and loads its own CFs and keeps its own gridding plan (these
+      // are not shared with ftm_g).  The products are gridded as in
+      // mode=weight and mode=psf, and the model image is used only
+      // for the residual.
+      //
+      std::vector<ImagingProduct> extraProducts;
+      if (allProducts)
+	for (std::string productMode : {"weight", "psf"})
+	  {
+	    ImagingProduct product;
+	    product.mode=productMode;
+	    product.cgrid.reset(new TempImage<Complex>(cgrid.shape(), cgrid.coordinates()));
+	    product.skyImage.reset(new PagedImage<Float>(skyImage.shape(), skyImage.coordinates(),
+							 baseName+"."+productMode));
+	    if (!isRoot)
+	      product.skyImage->table().markForDelete();
+
+	    product.visResampler =
+	      createAWPFTMachine(ftmName, String(""), product.ftm,
+				 cfc,
+				 String("EVLA"),
+				 loc,
+				 WBAwp,nW,
+				 useDoublePrec,
+				 aTermOn,
+				 psTermOn,
+				 mTermOn,
+				 doPointing,
+				 doPBCorr,
+				 conjBeams,
+				 pbLimit,
+				 posigdev,
+				 imageNamePrefix,
+				 productMode
+				 );
+	    product.visResampler->setNumThreads(nThreads);
+	    product.visResampler->setSortByCF(sortVis);
+	    product.visResampler->setGridTileSize(gridTileSize);
+	    product.ftm->setSpwFreqSelection( mssFreqSel );
+	    product.ftm->setPBReady(true);
+
+	    product.cgrid->set(Complex(0.0));
+	    product.ftm->initializeToSky(*(product.cgrid), product.weight, *(db.vb_l));
+	    if (cfOnTheFly)
+	      {
+		refim::AWProjectFT* awpFT = dynamic_cast<refim::AWProjectFT*>(&(*(product.ftm)));
+		if (awpFT != NULL) awpFT->prepConvFunction(*(product.cgrid), *(db.vb_l));
+	      }
+	    extraProducts.push_back(std::move(product));
+	  }
+
+      //
+      // The residual with a model image.  The HPG resampler
+      // de-grids the model and grids the residual on the device
+      // (hpg::degrid_grid_visibilities()).  For the CPU gridder, the
+      // model is predicted with a separate FTMachine (modelFTM) for
+      // each VB in the data consumer below, and subtracted from the
+      // data in memory before gridding.  The MODEL_DATA column is
+      // neither read nor written.
+      //
+      CountedPtr<refim::FTMachine> modelFTM;
+      std::unique_ptr<TempImage<Complex>> modelGrid;
+      if ((mainMode=="residual") && (modelImageName!="") && (ftmName!="awphpg"))
+	{
+	  PagedImage<Float> modelImage(modelImageName);
+	  if (modelImage.shape() != skyImage.shape())
+	    throw(AipsError("Model image \""+modelImageName+"\" is of shape "
+			    +String::toString(modelImage.shape())+".  Expected "
+			    +String::toString(skyImage.shape())));
+
+	  modelGrid.reset(new TempImage<Complex>(skyImage.shape(), skyImage.coordinates()));
+	  StokesImageUtil::From(*modelGrid, modelImage);
+	  if(db.vb_l->polarizationFrame()==MSIter::Linear)
+	    StokesImageUtil::changeCStokesRep(*modelGrid,StokesImageUtil::LINEAR);
+	  else
+	    StokesImageUtil::changeCStokesRep(*modelGrid, StokesImageUtil::CIRCULAR);
+
+	  CountedPtr<refim::VisibilityResamplerBase> modelResampler =
+	    createAWPFTMachine(ftmName, String(""), modelFTM,
+			       cfc,
+			       String("EVLA"),
+			       loc,
+			       WBAwp,nW,
+			       useDoublePrec,
+			       aTermOn,
+			       psTermOn,
+			       mTermOn,
+			       doPointing,
+			       doPBCorr,
+			       conjBeams,
+			       pbLimit,
+			       posigdev,
+			       imageNamePrefix,
+			       String("predict")
+			       );
+	  modelResampler->setNumThreads(nThreads);
+	  modelResampler->setSortByCF(sortVis);
+	  modelResampler->setGridTileSize(gridTileSize);
+	  modelFTM->setSpwFreqSelection( mssFreqSel );
+	  modelFTM->setPBReady(true);
+	  modelFTM->initializeToVis(*modelGrid,*(db.vb_l));
+	  log_l << "Subtracting the model \"" << modelImageName << "\" from the data in memory" << LogIO::POST;
+	}
+
       timer.mark();
 
       CountedPtr<casa::refim::CFStore2> cfs2_l;
@@ -674,17 +891,39 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       //
       // Finally, the data iteration loops.
       //-----------------------------------------------------------------------------------
-      double griddingEngine_time=0.0, dataIO_time=0.0;
+      double griddingEngine_time=0.0, dataIO_time=0.0, modelPredict_time=0.0;
       unsigned long vol=0,nRows=0;
       ProgressMeter pm(1.0, db.vi2_l->ms().nrow(),
 		       "Gridding", "","","",true);
-      DataIterator di(isRoot,dataCol_l);
+      DataIterator di(isRoot, noVis ? casa::refim::FTMachine::PSF : dataCol_l);
+      // Read the data ahead of the gridder in a separate thread.  The
+      // predicted data is written via the VI2 from the data consumer,
+      // which is not possible with the prefetch.
+      if (imagingMode!="predict")
+	di.setPrefetchDepth(vbPrefetch);
+      // The passes that read the visibilities read them from the
+      // cache of the visibility data, without the VI2, or write the
+      // cache for the later passes (e.g. the later major cycles).  The
+      // key of the cache includes the settings of the imaging weights,
+      // which are cached.
+      std::unique_ptr<casa::refim::VisCache> visCache;
+      if ((visCacheName!="") && !noVis && (imagingMode!="predict"))
+	{
+	  std::string selection="field="+fieldStr+"|spw="+spwStr+"|uvrange="+uvDistStr
+	    +"|spwdataiter="+std::to_string(doSPWDataIter)
+	    +"|weighting="+weighting+"|rmode="+rmode+"|robust="+std::to_string(robust)
+	    +"|imsize="+std::to_string(NX)+"|cell="+std::to_string(cellSize)+"|phasecenter="+phaseCenter;
+	  visCache.reset(new casa::refim::VisCache(visCacheName, MSNBuf, selection, dataCol_l,
+						   casa::refim::SynthesisUtils::getenv("VisCache.HALF",(Bool)false)));
+	  di.setVisCache(visCache.get());
+	}
 
       //-----------------------------------------------------------------------------------
       // Lambda function called in the DataIterator::dataIter().  This
       // consumes the VB inside iterator loops
       //
-      // Uses ftm_g, doPSF, dataCol_l
+      // Uses ftm_g, doPSF, noVis, dataCol_l, extraProducts, modelFTM,
+      // modelPredict_time
       //-----------------------------------------------------------------------------------
 
       //
@@ -698,7 +937,7 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
       //
 
       auto dataConsumerFTM =
-	[&imagingMode, &doPSF, &dataCol_l]
+	[&imagingMode, &doPSF, &noVis, &dataCol_l, &extraProducts, &modelFTM, &modelPredict_time]
 	(vi::VisBuffer2 *vb_l, vi::VisibilityIterator2 *vi2_l)
       {
 	std::chrono::time_point<std::chrono::steady_clock> dataIO_start;
@@ -726,6 +965,12 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 
 	    thisIOTime = std::chrono::steady_clock::now() - dataIO_start;
 	  }
+	else if (noVis)
+	  {
+	    // Grid the weights for the PSF.  No data is read.
+	    ftm_g->put(*vb_l,-1,true,casa::refim::FTMachine::PSF);
+	    thisIOTime = std::chrono::duration<double>::zero();
+	  }
 	else
 	  {
 	    // Read the data from a specific data column into the
@@ -736,10 +981,35 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 	    else if (dataCol_l==casa::refim::FTMachine::MODEL)  {dataCube=vb_l->visCubeModel();}
 	    else                                                {dataCube=vb_l->visCube();}
 
+	    thisIOTime = std::chrono::steady_clock::now() - dataIO_start;
+
+	    // The additional products are gridded from the data as
+	    // read, as in mode=weight and mode=psf.
+	    if (extraProducts.size() > 0)
+	      {
+		vb_l->setVisCube(dataCube);
+		for (auto& product : extraProducts)
+		  if (product.mode=="psf") product.ftm->put(*vb_l,-1,true,casa::refim::FTMachine::PSF);
+		  else                     product.ftm->put(*vb_l,-1,false);
+	      }
+
+	    // Predict the model into the VB (in memory) and subtract
+	    // it from the data.  This is timed separately from the
+	    // data I/O.
+	    if (!modelFTM.null())
+	      {
+		std::chrono::time_point<std::chrono::steady_clock>
+		  model_start = std::chrono::steady_clock::now();
+		modelFTM->get(*vb_l,0);
+		dataCube -= vb_l->visCubeModel();
+		std::chrono::duration<double> thisModelTime = std::chrono::steady_clock::now() - model_start;
+		modelPredict_time += thisModelTime.count();
+	      }
+
 	    // Set the dataCube for consumstion in ftm_g->put()
+	    dataIO_start = std::chrono::steady_clock::now();
 	    vb_l->setVisCube(dataCube);
-
-	    thisIOTime = std::chrono::steady_clock::now() - dataIO_start;
+	    thisIOTime += std::chrono::steady_clock::now() - dataIO_start;
 
 	    // Grid the data from the VB (presumably the name put()
 	    // means "put the data from the VB into the complex grid")
@@ -789,96 +1059,81 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 	    static_cast<refim::AWVisResamplerHPG &>(*visResampler).getHPGDevice();
 	  casa::refim::MakeCFArray mkCF(mndx,conj_mndx, HPGDevice_p, conjBeams);
 
-	  // To get messages from ThreadCoordinator, pass &cerr (or
-	  // any other ostream*) to the constructor.
+	  // The CFServer prepares up to cfLookahead CF sets ahead of
+	  // the gridder, limited to CFCache.LOOKAHEADMB MB (default
+	  // 1024; 0 for no limit) of CF pixels.  The next set is
+	  // therefore usually ready when the data iterations move to a
+	  // new SPW.
 	  //
-	  // TODO: LogIO.output(), which returns the internal ostream
-	  // pointer, does not work. Why? SB: Probably because LogIO
-	  // is not thread-safe.
-	  libracore::ThreadCoordinator thcoord;
-	  thcoord.newCF=false;
+	  size_t lookaheadBytes = (size_t)(casa::refim::SynthesisUtils::getenv("CFCache.LOOKAHEADMB",1024.0)*1024.0*1024.0);
+	  libracore::LookaheadQueue<CFSet> cfQueue(cfLookahead, lookaheadBytes);
+	  log_l << "CF look-ahead: " << cfLookahead << " CF sets (max. "
+		<< lookaheadBytes/(1024*1024) << " MB)" << LogIO::POST;
 
 	  auto cfPrep = std::async(std::launch::async,
 				   &CFServer,
-				   std::ref(thcoord),
+				   std::ref(cfQueue),
 				   std::ref(mkCF),
 				   std::ref(WBAwp), std::ref(nW),
 				   std::ref(skyImage),
 				   std::ref(polMap),
 				   std::ref(cfs2_l),
-				   std::ref(db.spwidList),
-				   std::ref(db.spwRefFreqList),
+				   std::ref(db.cfWorkList),
 				   std::ref(nDataPol));
-	  // First set of CFs have to be ready before proceeding. The
-	  // ThreadCoordinator state after this remains CFReady=true,
-	  // since the call to .waitForCFReady_or_EoD() in the
-	  // DataIterator should immediately return.  The CFReady state is
-	  // reset in the lambda function code passed to the DataIterator
-	  // for thread coordination.
-	  thcoord.waitForCFReady_or_EoD();
+	  //
+	  // Get the next CF set from the queue.  If the queue is
+	  // closed and empty, the CFServer is done (the current CFs
+	  // are then used for the rest of the data), or it failed.
+	  //
+	  CFSet cfSet;
+	  auto nextCFSet = [&cfQueue, &cfSet]()
+	    {
+	      if (!cfQueue.pop(cfSet))
+		{
+		  if (CFServerThreadExceptionPtr_g) std::rethrow_exception(CFServerThreadExceptionPtr_g);
+		  cfSet.newCF=false;
+		}
+	    };
+	  // First set of CFs have to be ready before proceeding.
+	  nextCFSet();
 
 	  //-------------------------------------------------------------------------------------------
-	  // Lambda functions with the code to coordinate the two threads
+	  // Lambda function with the code to coordinate the two threads
 	  // via the data iteration loops in the DataIterator object.  The
-	  // following functions assume that the MS iteraters over the SPW
-	  // axis.
+	  // following function assumes that the data iterations visit
+	  // the SPWs in the order of the CF working set
+	  // (db.cfWorkList), which is determined by a pre-scan of the
+	  // same iterator.
 	  //
-	  // If the VB has a new SPW ID, increment the index into the list
-	  // of the selected SPW IDs, and wait for CFReady signal from the
-	  // CFServer thread. Once that is received, send the current CFSI
-	  // and DeviceCFArray to the visResampler. This function is used
-	  // in the chunk iterations of VI2.  When this returns,
-	  // VisResampler is ready for gridding, which is then triggered.
-	  // That in-turn first sends the current DeviceCFArray to the
-	  // device and issues the CFSent signal via a call to the
-	  // notifyCFSent() function.  This unblocks the CFServe thread,
-	  // which proceeds to load the next CF set.
+	  // If the VB has a new SPW ID, increment the index into the CF
+	  // working set, and take the next CF set from the queue
+	  // (waiting for the CFServer thread if it is not yet ready).
+	  // If it has new CFs, send the CFSI and DeviceCFArray to the
+	  // visResampler.  This function is used in the chunk
+	  // iterations of VI2.  When this returns, VisResampler is ready
+	  // for gridding, which is then triggered.
 	  //
 	  auto waitForCFReady =
-	    [&thcoord, &visResampler,&db](int& nVB, int& spwNdx)
+	    [&nextCFSet, &cfSet, &visResampler,&db](int& nVB, int& spwNdx)
 	    {
-	      if (db.vb_l->spectralWindows()(0) != db.spwidList[spwNdx])
+	      int vbSPW = db.vb_l->spectralWindows()(0);
+	      if (vbSPW != db.cfWorkList[spwNdx].spwID)
 		{
 		  nVB=0;    // Reset the VB count for the new SPW
-		  spwNdx++; // Advance the SPW ID counter
-		  //
-		  // At this point the internal state of the
-		  // ThreadCoordinator object remains CFReady=True from an
-		  // earlier call to thcoord.waitForCFReady_or_EoD(), soon
-		  // after starting the CFServer thread
-		  // (std::async(&CFServer,...).  This earlier call is to
-		  // make sure that the code does not proceed to using the
-		  // data iterators till the first CFs are loaded and
-		  // ready for use in the memory.
-		  //
-		  // .setCFReady(false) explicitly sets the internal state
-		  // of the ThreadCoordinator object to CFReady=false.
-		  //
-		  thcoord.waitForCFReady_or_EoD(); // Wait for notification from the CFServer
-		  thcoord.setCFReady(false);
+		  spwNdx++; // Advance to the next entry in the CF working set
+		  if (((unsigned)spwNdx >= db.cfWorkList.size()) ||
+		      (db.cfWorkList[spwNdx].spwID != vbSPW))
+		    throw(AipsError("Data iterations reached SPW "+std::to_string(vbSPW)
+				    +", which is not the next SPW in the CF working set from the pre-scan"));
+		  nextCFSet();
 		}
-	      if (thcoord.newCF)
+	      if (cfSet.newCF)
 		{
-		  visResampler->setCFSI(cfsi_g);
+		  visResampler->setCFSI(cfSet.cfsi);
 
-		  //if (visResampler->set_cf(dcfa_sptr_g)==false)
-		  //      cerr << "WFCFR: " << dcfa_sptr_g << endl;
-		  if (visResampler->set_cf(std::move(dcfa_sptr_g))==false)
+		  if (visResampler->set_cf(std::move(cfSet.dcfa))==false)
 		    throw(AipsError("Device CFArray pointer is null in CFServer"));
-		  thcoord.newCF=false;
-		}
-	    };
-	  //-------------------------------------------------------------------------------------------
-	  auto notifyCFSent =
-	    [&thcoord,&log_l](const int& nVB)
-	    {
-	      if ((nVB==0) && (!thcoord.isEoD()))
-		{
-		  log_l << "gridderEngine: CFSent notification" << LogIO::POST;
-		  thcoord.setCFSent(true);
-		  thcoord.newCF=false;
-		  thcoord.Notify_CFSent();
-		  dcfa_sptr_g.reset();
+		  cfSet.newCF=false;
 		}
 	    };
 	  //-------------------------------------------------------------------------------------------
@@ -887,29 +1142,46 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 	    {
 	      auto ret = di.dataIter(db.vi2_l, db.vb_l,
 				     dataConsumerFTM,
-				     waitForCFReady,
-				     notifyCFSent);
+				     waitForCFReady);
 	      griddingEngine_time += ret[2];
 	      dataIO_time += ret[3];
 	      vol += ret[1];
 	      nRows += ret[4];
 	    }
-	  catch (AipsError &er)
+	  catch (...)
 	    {
-	      throw(er);
+	      // Unblock the CFServer thread, which cfPrep waits for when
+	      // it goes out of scope.
+	      cfQueue.close();
+	      throw;
 	    }
-	  // Trying to ensure that the CFServer thread gets the signal
-	  // that EoD has been reached in the main thread.
-	  thcoord.setEoD(true);
-	  thcoord.setCFSent(true);
-	  thcoord.Notify_CFSent();
+	  // Signal the end of data to the CFServer thread.
+	  cfQueue.close();
 	  //cfPrep.wait(); // The main thread does not have to wait for the CFServer thread to exit.
 	}
       // End of data iteration loops
       //-----------------------------------------------------------------------------------
+      if (visCache) visCache->finish();
 
       rrr[CUMULATIVE_GRIDDING_ENGINE_TIME]=griddingEngine_time;
       log_l << "Cumulative time in griddingEngine: " << griddingEngine_time << " sec" << LogIO::POST;
+      if (!modelFTM.null())
+	log_l << "Cumulative time to predict and subtract the model: " << modelPredict_time << " sec" << LogIO::POST;
+      {
+	refim::CFResidency::Stats cfStats=refim::CFResidency::instance().getStats();
+	log_l << "CF lookups: " << cfStats.hits << " hits, " << cfStats.misses << " loads, "
+	      << cfStats.evictions << " evictions";
+	if (refim::CFResidency::instance().getBudget() > 0)
+	  log_l << ".  Peak memory for the loaded CFs: " << cfStats.peakBytes/(1024*1024) << " MB";
+	log_l << LogIO::POST;
+
+	refim::CFRotationCache::Stats rotStats=refim::CFRotationCache::instance().getStats();
+	Int64 nRotLookups=rotStats.hits+rotStats.misses;
+	if (nRotLookups > 0)
+	  log_l << "Rotated CF cache: " << rotStats.hits << " hits, " << rotStats.misses << " rotations ("
+		<< (100.0*rotStats.hits)/nRotLookups << "% hit rate), " << rotStats.evictions
+		<< " evictions.  Peak size: " << rotStats.peakBytes/(1024*1024) << " MB" << LogIO::POST;
+      }
       unsigned long allVol=vol;
       //log_l << "Total rows processed: " << allVol << LogIO::POST;
 
@@ -992,9 +1264,6 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 	    {
 	      // Split any extension in imageName to construct a name with
 	      // same base name and extension given by sowImageExt
-	      std::string baseName=imageName;
-	      baseName=librautils::removeExtension(imageName);
-
 	      PagedImage<float> sowImage(sow.shape(),cgrid.coordinates(), baseName+"."+sowImageExt);
 
 	      // Not sure what this info. is about, and if it is
@@ -1005,7 +1274,7 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 		miscinfo.define("INSTRUME", "EVLA");
 		miscinfo.define("distance", 0.0);
 		miscinfo.define("useweightimage", true);
-		miscinfo.define("imagingmode", imagingMode);
+		miscinfo.define("imagingmode", mainMode);
 		sowImage.setMiscInfo(miscinfo);
 		sowImage.put(sow);
 		sowImage.table().tableInfo().setSubType(casacore::String("SOW"));
@@ -1014,14 +1283,27 @@ auto Roadrunner(//bool& restartUI, int& argc, char** argv,
 	    }
 	  // Convert the skyImage (retrieved in ftm->finalizeToSky()) and
 	  // convert it from Feed basis to Stokes basis.
-	  StokesImageUtil::To(skyImage, cgrid);
-	  {
-	    Record miscinfo;
-	    miscinfo.define("imagingmode", imagingMode);
-	    miscinfo.define("normalization", "NONE");
-	    skyImage.table().tableInfo().setSubType(imagingMode);
-	    skyImage.setMiscInfo(miscinfo);
-	  }
+	  auto saveSkyImage = [](PagedImage<Float>& theSkyImage, ImageInterface<Complex>& theGrid,
+				 const std::string& theMode)
+	    {
+	      StokesImageUtil::To(theSkyImage, theGrid);
+	      Record miscinfo;
+	      miscinfo.define("imagingmode", theMode);
+	      miscinfo.define("normalization", "NONE");
+	      theSkyImage.table().tableInfo().setSubType(theMode);
+	      theSkyImage.setMiscInfo(miscinfo);
+	    };
+	  saveSkyImage(skyImage, cgrid, mainMode);
+
+	  // The additional products of mode=all.  The .sumwt image
+	  // saved above is that of the main product (the residual).
+	  for (auto& product : extraProducts)
+	    {
+	      product.ftm->finalizeToSky();
+	      product.ftm->getImage(product.weight, normalize);
+	      saveSkyImage(*(product.skyImage), *(product.cgrid), product.mode);
+	      log_l << "Made the " << product.mode << " image " << product.skyImage->name() << LogIO::POST;
+	    }
 	}
       //MSes are detach for cleaning up when the DataBase object goes
       //out of scope here.
@@ -35,6 +35,7 @@
 #include <casacore/coordinates/Coordinates/CoordinateSystem.h>
 #include <casacore/images/Images/ImageInterface.h>
 #include <casacore/images/Images/PagedImage.h>
+#include <casacore/images/Images/TempImage.h>
 //#include <casacore/tables/TaQL/ExprNode.h>
 
 #include <casacore/ms/MSSel/MSSelection.h>
@@ -47,9 +48,12 @@
 //#include <synthesis/TransformMachines2/PointingOffsets.h>
 #include <synthesis/TransformMachines2/CFStore2.h>
 #include <synthesis/TransformMachines2/MakeCFArray.h>
+#include <synthesis/TransformMachines2/CFResidency.h>
+#include <synthesis/TransformMachines2/CFRotationCache.h>
 
 #include <librautils/utils.h>
 #include <libracore/ThreadCoordinator.h>
+#include <libracore/DataBase.h>
 
 #ifdef LIBRA_USE_HPG
 #include <synthesis/TransformMachines2/AWVisResamplerHPG.h>
@@ -59,6 +63,7 @@
 
 #include <LibHPG.h>
 #include <stdexcept>
+#include <memory>
 using namespace casa;
 using namespace casa::refim;
 using namespace casacore;
@@ -98,12 +103,47 @@ std::string remove_extension(const std::string& path);
 // roadrunner (application layer) code.
 //#include <synthesis/TransformMachines2/test/RR_MPI.h>
 
+//
+//-------------------------------------------------------------------------
+// A CF set prepared by the CFServer thread for one entry of the CF
+// working set, in the queue to the gridder thread.
+/**
+ * @struct CFSet
+ * @brief The CFs for one entry of the CF working set (DataBase::cfWorkList).
+ */
+struct CFSet
+{
+  /** If false, the CFs of the previous entry are to be used. */
+  bool newCF=false;
+  /** The CFSI to use with the CFs. */
+  hpg::CFSimpleIndexer cfsi{{1,false},{1,false},{1,true},{1,true}, 1};
+  /** The CFs, to be sent to the device. */
+  std::shared_ptr<hpg::RWDeviceCFArray> dcfa;
+};
+//
+//-------------------------------------------------------------------------
+// An image made from the same data pass as the main image (the
+// weight and PSF images of mode=all).
+/**
+ * @struct ImagingProduct
+ * @brief The FTMachine, grid and sky image of an additional product of a data pass.
+ */
+struct ImagingProduct
+{
+  /** The imaging mode of the product ("weight" or "psf"). */
+  std::string mode;
+  casacore::CountedPtr<casa::refim::FTMachine> ftm;
+  casacore::CountedPtr<casa::refim::VisibilityResamplerBase> visResampler;
+  std::unique_ptr<casacore::TempImage<casacore::Complex>> cgrid;
+  std::unique_ptr<casacore::PagedImage<casacore::Float>> skyImage;
+  casacore::Matrix<casacore::Float> weight;
+};
 //
 //-------------------------------------------------------------------------
 // The engine that loads the required CFs from the cache and copies
 // them to the hpg::CFArray.
 /**
- * @fn std::tuple<bool, std::shared_ptr<hpg::RWDeviceCFArray>> prepCFEngine(casa::refim::MakeCFArray& mkCF, bool WBAwp, int nW, int ispw, double spwRefFreq, int nDataPol, casacore::ImageInterface<casacore::Float>& skyImage, casacore::Vector<Int>& polMap, casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l)
+ * @fn CFSet prepCFEngine(casa::refim::MakeCFArray& mkCF, bool WBAwp, int nW, int ispw, double spwRefFreq, int nDataPol, casacore::ImageInterface<casacore::Float>& skyImage, casacore::Vector<Int>& polMap, casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l, double maxW, double minPA, double maxPA)
  * @brief Prepares the CF Engine.
  * @param mkCF A reference to the MakeCFArray object.
  * @param WBAwp A boolean indicating whether to use wideband AWP.
@@ -114,48 +154,54 @@ std::string remove_extension(const std::string& path);
  * @param skyImage A reference to the sky image.
  * @param polMap A reference to the polarization map.
  * @param cfs2_l A reference to the CFStore2 object.
- * @return A tuple containing a boolean indicating whether a new CF was created and a shared pointer to the RWDeviceCFArray.
+ * @param maxW The max. |w| (wavelengths) of the data.  Only the W-planes up to this are loaded.
+ * @param minPA The min. parallactic angle (radians) of the data.
+ * @param maxPA The max. parallactic angle (radians) of the data.  The CFs nearest to [minPA, maxPA] are loaded.
+ * @return The CFSet, with newCF=false if the CFs of the previous call are to be used.
  */
-std::tuple<bool, std::shared_ptr<hpg::RWDeviceCFArray>>
+CFSet
 prepCFEngine(casa::refim::MakeCFArray& mkCF,
 	     bool WBAwp, int nW,
 	     int ispw, double spwRefFreq,
 	     int nDataPol,
 	     casacore::ImageInterface<casacore::Float>& skyImage,
 	     casacore::Vector<Int>& polMap,
-	     casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l
+	     casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l,
+	     double maxW, double minPA, double maxPA
 	     );
 
 
 //
 //-------------------------------------------------------------------------
-// Server function that triggers the prepCFEngine() fro each SPW in
-// the spwidList.  This is run in parallel with gridding in a separate
-// thread than the gridder-thread (the main thread).  Coordination
-// between the thread is managed by the ThreadCoordinator object.
+// Server function that triggers the prepCFEngine() for each entry of
+// the CF working set (DataBase::cfWorkList), in the order of the data
+// iterations.  The CFs are limited to the max. |w| and the PA range
+// of the SPW (of all the SPWs, if the same CFs are used for all).  This is run in parallel with gridding in a separate
+// thread than the gridder-thread (the main thread).  The prepared CF
+// sets are passed to the gridder-thread via a bounded queue, so that
+// the CFs for the next few entries are prepared while the current one
+// is in use.  The queue is closed when the CFServer exits.
 //
 /**
- * @fn void CFServer(ThreadCoordinator& thcoord, casa::refim::MakeCFArray& mkCF, bool& WBAwp, int& nW, casacore::ImageInterface<casacore::Float>& skyImage, casacore::Vector<Int>& polMap, casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l, casacore::Vector<int>& spwidList, casacore::Vector<double>& spwRefFreqList, int& nDataPol)
- * @brief Server function that triggers the prepCFEngine() for each SPW in the spwidList.
- * @param thcoord A reference to the ThreadCoordinator object.
+ * @fn void CFServer(libracore::LookaheadQueue<CFSet>& cfQueue, casa::refim::MakeCFArray& mkCF, bool& WBAwp, int& nW, casacore::ImageInterface<casacore::Float>& skyImage, casacore::Vector<Int>& polMap, casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l, std::vector<CFWorkItem>& cfWorkList, int& nDataPol)
+ * @brief Server function that triggers the prepCFEngine() for each entry in the cfWorkList.
+ * @param cfQueue The queue of CF sets to the gridder-thread.
  * @param mkCF A reference to the MakeCFArray object.
  * @param WBAwp A boolean indicating whether to use wideband AWP.
  * @param nW The number of w-projection planes.
  * @param skyImage A reference to the sky image.
  * @param polMap A reference to the polarization map.
  * @param cfs2_l A reference to the CFStore2 object.
- * @param spwidList A reference to the list of spectral window indices.
- * @param spwRefFreqList A reference to the list of reference frequencies for the spectral windows.
+ * @param cfWorkList A reference to the CF working set, in the order of data iterations (see DataBase::cfWorkList).
  * @param nDataPol The number of data polarizations.
  */
-void CFServer(libracore::ThreadCoordinator& thcoord,
+void CFServer(libracore::LookaheadQueue<CFSet>& cfQueue,
 	      casa::refim::MakeCFArray& mkCF,
 	      bool& WBAwp, int& nW,
 	      casacore::ImageInterface<casacore::Float>& skyImage,
 	      casacore::Vector<Int>& polMap,
 	      casacore::CountedPtr<casa::refim::CFStore2>& cfs2_l,
-	      std::vector<int>& spwidList,
-	      std::vector<double>& spwRefFreqList,
+	      std::vector<CFWorkItem>& cfWorkList,
 	      int& nDataPol);
 
 //--------------------------------------------------------------------------------------------
@@ -199,7 +245,7 @@ makeMNdx(const string& fileName,
 	 const int& nGridPlanes);
 
 /**
- * @fn void Roadrunner(string& MSNBuf, string& imageName, string& modelImageName, string& dataColumnName, string& sowImageExt, string& cmplxGridName, int& NX, int& nW, float& cellSize, string& stokes, string& refFreqStr, string& phaseCenter, string& weighting, string& rmode,  float& robust, string& ftmName, string& cfCache, string& imagingMode, bool& WBAwp, string& fieldStr, string& spwStr, string& uvDistStr, bool& doPointing, bool& normalize, bool& doPBCorr, bool& conjBeams, float& pbLimit, vector<float>& posigdev, bool& doSPWDataIter)
+ * @fn void Roadrunner(string& MSNBuf, string& imageName, string& modelImageName, string& dataColumnName, string& sowImageExt, string& cmplxGridName, int& NX, int& nW, float& cellSize, string& stokes, string& refFreqStr, string& phaseCenter, string& weighting, string& rmode,  float& robust, string& ftmName, string& cfCache, string& imagingMode, bool& WBAwp, string& fieldStr, string& spwStr, string& uvDistStr, bool& doPointing, bool& normalize, bool& doPBCorr, bool& conjBeams, float& pbLimit, vector<float>& posigdev, bool& doSPWDataIter, int& nThreads, int& vbPrefetch, bool& sortVis, int& gridTileSize, float& cfMemBudget, bool& aTerm, int& cfLookahead, string& visCacheName)
  * @brief Main function for the Roadrunner application.
  * @param MSNBuf The measurement set name buffer.
  * @param imageName The name of the image.
@@ -230,6 +276,14 @@ makeMNdx(const string& fileName,
  * @param pbLimit The limit for the primary beam.
  * @param posigdev The position sigma deviation.
  * @param doSPWDataIter A boolean indicating whether to do SPW data iteration.
+ * @param nThreads The number of threads used by the CPU gridder/degridder (gridder=awproject).  A value <= 0 uses all available threads.
+ * @param vbPrefetch The number of VisBuffers read ahead of the gridder in a separate thread (0: no read-ahead).
+ * @param sortVis If true, (de-)grid the samples of a VisBuffer in bins that use the same CFs (gridder=awproject).
+ * @param gridTileSize If > 0, grid in tiles of this many pixels on per-thread buffers (gridder=awproject).
+ * @param cfMemBudget Memory budget (MB) for the lazily loaded CF pixels (0 for no limit).
+ * @param aTerm Include the A-term in the CFs (if false, CFs are computed on the fly when cfCache is empty).
+ * @param cfLookahead The max. no. of CF sets prepared ahead of the gridder (for gridder=awphpg).
+ * @param visCacheName Name of the cache of the visibility data read on this pass, or written for the later passes ("" for no cache).
  */
 RRReturnType Roadrunner(//bool& restartUI, int& argc, char** argv,
 		string& MSNBuf, string& imageName, string& modelImageName,
@@ -243,7 +297,7 @@ RRReturnType Roadrunner(//bool& restartUI, int& argc, char** argv,
 		string& fieldStr, string& spwStr, string& uvDistStr,
 		bool& doPointing, bool& normalize, bool& doPBCorr,
 		bool& conjBeams, float& pbLimit, vector<float>& posigdev,
-		bool& doSPWDataIter);
+		bool& doSPWDataIter, int& nThreads, int& vbPrefetch, bool& sortVis, int& gridTileSize, float& cfMemBudget, bool& aTerm, int& cfLookahead, string& visCacheName);
 
 
 
@@ -263,7 +317,7 @@ void UI(Bool restart, int argc, char **argv, bool interactive,
   Bool& conjBeams,
   Float& pbLimit,
   vector<float> &posigdev,
-  Bool& doSPWDataIter);
+  Bool& doSPWDataIter, int& nThreads, int& vbPrefetch, Bool& sortVis, int& gridTileSize, float& cfMemBudget, Bool& aTerm, int& cfLookahead, string& visCacheName);
 
 
 #endif
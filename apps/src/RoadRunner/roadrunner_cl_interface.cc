@@ -60,7 +60,7 @@ void UI(Bool restart, int argc, char **argv, bool interactive,
 	Bool& conjBeams,
 	Float& pbLimit,
 	vector<float> &posigdev,
-	Bool& doSPWDataIter)
+	Bool& doSPWDataIter, int& nThreads, int& vbPrefetch, Bool& sortVis, int& gridTileSize, Float& cfMemBudget, Bool& aTerm, int& cfLookahead, string& visCacheName)
 {
   clSetPrompt(interactive);
 
@@ -120,17 +120,18 @@ void UI(Bool restart, int argc, char **argv, bool interactive,
 #endif // ROADRUNNER_USE_HPG
       i=1;clgetSValp("cfcache", CFCache,i);
 
-      // Expose the modelimagename parameter only for mode=residual or
-      // mode=predict
+      // Expose the modelimagename parameter only for mode=residual,
+      // mode=all or mode=predict
       InitMap(watchPoints,exposedKeys);
       exposedKeys.push_back("modelimagename");
       watchPoints["residual"]=exposedKeys;
+      watchPoints["all"]=exposedKeys;
       watchPoints["predict"]=exposedKeys;
       
       // Expose the datacolumn parameter only for mode=residual
       // exposedKeys.push_back("datacolumn");
       // watchPoints["residual"]=exposedKeys;
-      std::vector<std::string> imagingModeOpts = {"weight","psf","snrpsf","residual","predict"};
+      std::vector<std::string> imagingModeOpts = {"weight","psf","snrpsf","residual","all","predict"};
       i=1;clgetSValp("mode", imagingMode,i,watchPoints); clSetOptions("mode",imagingModeOpts);
 
       i=1;clgetValp("wbawp", WBAwp,i);
@@ -154,6 +155,15 @@ void UI(Bool restart, int argc, char **argv, bool interactive,
       i=1;clgetValp("usepointing", doPointing,i,watchPoints);
       i=2;i=clgetValp("pointingoffsetsigdev", posigdev,i);
 
+      i=1;clgetValp("nthreads", nThreads,i);
+      i=1;clgetValp("vbprefetch", vbPrefetch,i);
+      i=1;clgetValp("sortvis", sortVis,i);
+      i=1;clgetValp("gridtilesize", gridTileSize,i);
+      i=1;clgetValp("cfmembudget", cfMemBudget,i);
+      i=1;clgetValp("aterm", aTerm,i);
+      i=1;clgetValp("cflookahead", cfLookahead,i);
+      i=1;clgetSValp("viscache", visCacheName,i);
+
       i=1;cldbggetBValp("normalize",normalize,i);
       i=1;cldbggetBValp("spwdataiter",doSPWDataIter,i);
      EndCL();
@@ -165,7 +175,13 @@ void UI(Bool restart, int argc, char **argv, bool interactive,
        if (imageName == "")
 	 mesgs += "Imaging mode="+imagingMode+" needs imagename to be set.\n";
      
-     if (CFCache == "")
+     // The weight, PSF and residual of mode=all are made with the CPU
+     // gridder.
+     if ((imagingMode == "all") && (FTMName == "awphpg"))
+       mesgs += "Imaging mode=all needs gridder=awproject.\n";
+
+     // Without the A-term, the CFs can be computed on the fly.
+     if ((CFCache == "") && aTerm)
        mesgs += "The cfcache parameter needs to be set.\n";
 
      if (phaseCenter == "")
@@ -234,6 +250,14 @@ int main(int argc, char **argv)
   bool conjBeams= true;
   float pbLimit=1e-3;
   bool doSPWDataIter=false;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {300.0,300.0};
   bool interactive = true;
 
@@ -245,7 +269,7 @@ int main(int argc, char **argv)
 	 stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
 	 ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
 	 doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-	 doSPWDataIter);
+	 doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
       set_terminate(NULL);
       RRReturnType rrr;
@@ -254,7 +278,7 @@ int main(int argc, char **argv)
 		     stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
 		     ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
 		     doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-		     doSPWDataIter);
+		     doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
     }
   catch(clError& er)
     {
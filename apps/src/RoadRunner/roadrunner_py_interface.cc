@@ -58,5 +58,13 @@ PYBIND11_MODULE(roadrunner2py, m)
 	"conjbeams"_a=true,
         "pblimit"_a=0.2,
         "pointingoffsetsigdev"_a=posigdev_def,
-	"spwdataiter"_a=true);
+	"spwdataiter"_a=true,
+	"nthreads"_a=0,
+	"vbprefetch"_a=0,
+	"sortvis"_a=false,
+	"gridtilesize"_a=0,
+	"cfmembudget"_a=0.0,
+	"aterm"_a=true,
+	"cflookahead"_a=2,
+	"viscache"_a="");
 }
@@ -26,6 +26,13 @@
 #include <RoadRunner/roadrunner.h>
 #include <tests/test_utils.h>
 #include <libracore/LibracoreUtils.h>
+#include <casacore/casa/Arrays/ArrayMath.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/tables/Tables/Table.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <synthesis/TransformMachines2/AWGridKernels.h>
+#include <chrono>
+#include <future>
 using namespace std;
 using namespace std::filesystem;
 
@@ -61,6 +68,14 @@ TEST(RoadrunnerTest, UIFactory) {
   bool conjBeams= true;
   float pbLimit=1e-3;
   bool doSPWDataIter=false;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {300.0,300.0};
   bool interactive = false;
   cfCache="test";
@@ -70,7 +85,7 @@ TEST(RoadrunnerTest, UIFactory) {
      stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
      ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
      doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-     doSPWDataIter);
+     doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
   EXPECT_EQ(NX, 4000);
   EXPECT_FLOAT_EQ(cellSize, 0.025f);
@@ -102,6 +117,14 @@ TEST(RoadrunnerTest, UIThrow) {
   bool conjBeams= true;
   float pbLimit=1e-3;
   bool doSPWDataIter=false;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {300.0,300.0};
   bool interactive = false;
 
@@ -112,7 +135,7 @@ TEST(RoadrunnerTest, UIThrow) {
        stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
        ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
        doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-       doSPWDataIter);
+       doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
     FAIL() << "Expected an exception to be thrown";
   }
   catch (const std::exception& e) {
@@ -183,6 +206,14 @@ TEST(RoadrunnerTest, AppLevelSNRPSF_performance) {
   bool conjBeams=false;
   float pbLimit=0.01;
   bool doSPWDataIter=true;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {0.0,0.0};
 
   string ftmName="awphpg";
@@ -202,7 +233,7 @@ TEST(RoadrunnerTest, AppLevelSNRPSF_performance) {
                  stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
                  ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
                  doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-                 doSPWDataIter);
+                 doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
   // Check that the .psf is generated
   path p1("htclean_gpu_newpsf.psf");
@@ -285,6 +316,14 @@ TEST(RoadrunnerTest, AppLevelWeight) {
   bool conjBeams=false;
   float pbLimit=0.01;
   bool doSPWDataIter=true;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {0.0,0.0};
 
   string ftmName="awphpg";
@@ -304,7 +343,7 @@ TEST(RoadrunnerTest, AppLevelWeight) {
                  stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
                  ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
                  doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-                 doSPWDataIter);
+                 doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
   // Check that the weight files are generated
   path p1("htclean_gpu_newpsf.weight");
@@ -328,6 +367,398 @@ TEST(RoadrunnerTest, AppLevelWeight) {
 
 
 
+TEST(RoadrunnerTest, GridKernels) {
+  // The vectorized row kernels of the CPU (de-)gridder must match
+  // the scalar loops they replaced, with and without the phase
+  // gradient and the conjugate CF.
+  using namespace casa::refim;
+  const int n=37, oversampling=20;
+  std::vector<std::complex<float>> cf(n*oversampling), pg(2*n);
+  std::vector<int> cfOff(n), pgOff(n);
+  for (size_t i=0; i<cf.size(); i++) cf[i]=std::complex<float>(cos(0.01*i), sin(0.03*i));
+  for (size_t i=0; i<pg.size(); i++) pg[i]=std::polar(1.0f, (float)(0.07*i));
+  for (int j=0; j<n; j++) {cfOff[j]=(j*oversampling+7)%(n*oversampling); pgOff[j]=2*j+1;}
+  const std::complex<float> nvalue(0.3,-1.7);
+
+  for (bool conjCF : {false, true})
+    for (bool usePG : {false, true})
+      {
+	std::vector<std::complex<double>> grid(n, 0.5), gridRef(n, 0.5);
+	std::vector<std::complex<float>> fgrid(n);
+	std::complex<double> norm=0, normRef=0;
+	std::complex<float> dNorm=0, dNormRef=0, dRef=0;
+	for (int j=0; j<n; j++)
+	  {
+	    fgrid[j]=std::complex<float>(0.1*j, 1.0-0.05*j);
+	    std::complex<float> w = conjCF ? conj(cf[cfOff[j]]) : cf[cfOff[j]];
+	    normRef += w; dNormRef += w;
+	    gridRef[j] += nvalue*(usePG ? w*pg[pgOff[j]] : w);
+	    dRef += (usePG ? w*conj(pg[pgOff[j]]) : w)*fgrid[j];
+	  }
+
+	AWGridKernels::gridRow(grid.data(), cf.data(), cfOff.data(),
+			       usePG ? pg.data() : NULL, pgOff.data(),
+			       n, conjCF, nvalue, norm);
+	std::complex<float> d=AWGridKernels::degridRow(fgrid.data(), cf.data(), cfOff.data(),
+							usePG ? pg.data() : NULL, pgOff.data(),
+							n, conjCF, dNorm);
+	for (int j=0; j<n; j++)
+	  EXPECT_NEAR(abs(grid[j]-gridRef[j]), 0.0, 1e-5) << "conjCF=" << conjCF << " usePG=" << usePG << " j=" << j;
+	EXPECT_NEAR(abs(norm-normRef), 0.0, 1e-4);
+	EXPECT_NEAR(abs(d-dRef), 0.0, 1e-4);
+	EXPECT_NEAR(abs(dNorm-dNormRef), 0.0, 1e-4);
+      }
+}
+
+TEST(RoadrunnerTest, LookaheadQueue) {
+  // The CF sets must reach the gridder in the order the CFServer
+  // queued them, including those queued before the CFServer closed
+  // the queue at its end.  The queue must block the producer at the
+  // byte limit (but accept any item when empty), and close() must
+  // unblock either side.
+  using namespace std::chrono_literals;
+  {
+    libracore::LookaheadQueue<int> q(3);
+    for (int i=0; i<3; i++) EXPECT_TRUE(q.push(std::move(i)));
+    q.close();
+    EXPECT_FALSE(q.push(3));
+    int item;
+    for (int i=0; i<3; i++)
+      {
+	ASSERT_TRUE(q.pop(item));
+	EXPECT_EQ(item, i);
+      }
+    EXPECT_FALSE(q.pop(item));
+  }
+  {
+    libracore::LookaheadQueue<int> q(4, 100);
+    EXPECT_TRUE(q.push(0, 60));
+    auto blocked = std::async(std::launch::async, [&q]() { return q.push(1, 60); });
+    EXPECT_EQ(blocked.wait_for(100ms), std::future_status::timeout);
+    EXPECT_EQ(q.size(), 1u);
+    int item;
+    ASSERT_TRUE(q.pop(item));
+    EXPECT_EQ(item, 0);
+    EXPECT_TRUE(blocked.get());
+    ASSERT_TRUE(q.pop(item));
+    EXPECT_EQ(item, 1);
+    // An item larger than the limit is accepted by the empty queue.
+    EXPECT_TRUE(q.push(2, 500));
+
+    auto pushing = std::async(std::launch::async, [&q]() { return q.push(3, 10); });
+    EXPECT_EQ(pushing.wait_for(100ms), std::future_status::timeout);
+    q.close();
+    EXPECT_FALSE(pushing.get());
+    ASSERT_TRUE(q.pop(item));
+    EXPECT_EQ(item, 2);
+    EXPECT_FALSE(q.pop(item));
+  }
+  {
+    libracore::LookaheadQueue<int> q(2);
+    auto popping = std::async(std::launch::async, [&q]() { int item; return q.pop(item); });
+    EXPECT_EQ(popping.wait_for(100ms), std::future_status::timeout);
+    q.close();
+    EXPECT_FALSE(popping.get());
+  }
+}
+
+
+//
+//-------------------------------------------------------------------------
+// The parameters of Roadrunner(), with the defaults of the app-level
+// tests below (the CPU gridder, on the test MS and CFC).
+//
+struct RRParams
+{
+  string MSNBuf="CYGTST.corespiral.ms", imageName="test.residual", modelImageName="",
+    dataColumnName="data", sowImageExt="", cmplxGridName="", stokes="I",
+    refFreqStr="3.0e9", phaseCenter="J2000 19h57m44.44s  040d35m46.3s",
+    weighting="natural", rmode="none", ftmName="awproject", cfCache="4k_nosquint.cfc",
+    imagingMode="residual", fieldStr="", spwStr="*", uvDistStr="", visCacheName="";
+  int NX=4000, nW=1;
+  float cellSize=0.025, robust=0.0;
+  bool WBAwp=true, doPointing=false, normalize=false, doPBCorr=true, conjBeams=false;
+  float pbLimit=0.01;
+  vector<float> posigdev = {0.0,0.0};
+  bool doSPWDataIter=true;
+  int nThreads=0, vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+
+  RRReturnType run()
+  {
+    return Roadrunner(MSNBuf,imageName, modelImageName,dataColumnName,
+		      sowImageExt, cmplxGridName, NX, nW, cellSize,
+		      stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
+		      ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
+		      doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
+		      doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
+  }
+};
+//
+//-------------------------------------------------------------------------
+// Runs each test in a directory of its own, with a copy of the test MS
+// and CFC.
+//
+class RoadrunnerAppTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    testDir = current_path() / ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::filesystem::create_directory(testDir);
+    std::filesystem::copy(goldDir/"CYGTST.corespiral.ms", testDir/"CYGTST.corespiral.ms", copy_options::recursive);
+    std::filesystem::copy(goldDir/"4k_nosquint.cfc", testDir/"4k_nosquint.cfc", copy_options::recursive);
+    std::filesystem::current_path(testDir);
+  }
+  void TearDown() override
+  {
+    //move to parent directory
+    std::filesystem::current_path(testDir.parent_path());
+    remove_all(testDir);
+  }
+  // Expect the pixels of two images to be equal to within relTol of
+  // the peak of the first.
+  void expectImagesMatch(const string& name0, const string& name1, const float relTol=1e-6)
+  {
+    ASSERT_TRUE(exists(path(name0))) << "Missing " << name0;
+    ASSERT_TRUE(exists(path(name1))) << "Missing " << name1;
+    PagedImage<Float> im0(name0), im1(name1);
+    ASSERT_EQ(im0.shape(), im1.shape());
+    Array<Float> diff = im0.get() - im1.get();
+    EXPECT_NEAR(max(abs(diff)), 0.0, relTol*max(abs(im0.get()))) << name0 << " vs. " << name1;
+  }
+
+  // Make a model image with the shape and coordinates of the image
+  // from, and point sources at the phase center and off-center.
+  void makeModelImage(const string& from, const string& name)
+  {
+    PagedImage<Float> ref(from);
+    PagedImage<Float> model(ref.shape(), ref.coordinates(), name);
+    model.set(0.0);
+    IPosition pos(ref.shape().nelements(), 0);
+    pos(0)=ref.shape()(0)/2; pos(1)=ref.shape()(1)/2;
+    model.putAt(1.0, pos);
+    pos(0)+=ref.shape()(0)/16; pos(1)-=ref.shape()(1)/32;
+    model.putAt(0.5, pos);
+  }
+
+  path testDir;
+};
+
+
+TEST_F(RoadrunnerAppTest, AppLevelAllProducts) {
+  // mode=all is supported only by the CPU gridder.
+  RRParams rr;
+  rr.imageName="htclean_allproducts";
+  rr.sowImageExt="sumwt";
+  rr.imagingMode="all";
+  rr.run();
+
+  // All products are made from the one pass over the data.
+  for (string ext : {"weight", "psf", "residual", "sumwt"})
+    EXPECT_TRUE(exists(path("htclean_allproducts."+ext))) << "Missing the ." << ext << " image";
+
+  PagedImage<Float> psf("htclean_allproducts.psf");
+  EXPECT_EQ(psf.table().tableInfo().subType(), "psf");
+
+  // Each product must be the image made by a separate run in its own
+  // mode.  The model is used only for the residual.
+  makeModelImage("htclean_allproducts.residual", "test.model");
+  rr.imageName="htclean_allmodel";
+  rr.modelImageName="test.model";
+  rr.run();
+
+  rr.sowImageExt="";
+  for (string mode : {"weight", "psf", "residual"})
+    {
+      rr.imagingMode=mode;
+      rr.imageName="separate."+mode;
+      rr.run();
+      expectImagesMatch("htclean_allmodel."+mode, "separate."+mode);
+    }
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelPrefetch) {
+  // The gridders (and the CF selection by PA) must give the same
+  // residual with the VisBuffers read in a separate thread.
+  RRParams rr;
+  const std::vector<std::pair<string,int>> runs = {{"noprefetch.residual", 0}, {"prefetch.residual", 2}};
+  for (auto& r : runs)
+    {
+      rr.imageName=r.first;
+      rr.vbPrefetch=r.second;
+      rr.run();
+    }
+  expectImagesMatch("noprefetch.residual", "prefetch.residual");
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelVisCache) {
+  // The first pass writes the cache, and the second pass reads the
+  // data from it without the VI2 (the prefetch is then not used).
+  RRParams rr;
+  rr.visCacheName="vis.cache";
+  const std::vector<std::pair<string,int>> runs = {{"viscache_write.residual", 0}, {"viscache_read.residual", 2}};
+  for (auto& r : runs)
+    {
+      rr.imageName=r.first;
+      rr.vbPrefetch=r.second;
+      rr.run();
+      EXPECT_TRUE(exists(path(rr.visCacheName)/"VisCache.idx"));
+      // The data files are renamed when the pass is finished.
+      for (auto& f : directory_iterator(rr.visCacheName))
+	EXPECT_NE(f.path().extension(), ".tmp") << f.path();
+    }
+  expectImagesMatch("viscache_write.residual", "viscache_read.residual");
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelThreadedGridding) {
+  // The grid planes are gridded in parallel only with more than one
+  // plane.  For Stokes-I, the tiled gridder threads within the plane.
+  RRParams rr;
+  for (int tileSize : {0, 64})
+    {
+      string ext="_tile"+std::to_string(tileSize)+".residual";
+      rr.gridTileSize=tileSize;
+      const std::vector<std::pair<string,int>> runs = {{"serial"+ext, 1}, {"threaded"+ext, 4}};
+      for (auto& r : runs)
+	{
+	  rr.imageName=r.first;
+	  rr.nThreads=r.second;
+	  rr.run();
+	}
+      expectImagesMatch("serial"+ext, "threaded"+ext);
+    }
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelThreadedDegridding) {
+  // The model is de-gridded by the VB rows in parallel.
+  RRParams rr;
+  rr.imageName="template.residual";
+  rr.run();
+  makeModelImage("template.residual", "test.model");
+
+  rr.modelImageName="test.model";
+  const std::vector<std::pair<string,int>> runs = {{"serial.residual", 1}, {"threaded.residual", 4}};
+  for (auto& r : runs)
+    {
+      rr.imageName=r.first;
+      rr.nThreads=r.second;
+      rr.run();
+    }
+  expectImagesMatch("serial.residual", "threaded.residual");
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelFusedResidual) {
+  // The residual with the model subtracted in memory must be the
+  // residual of the data with the predicted model subtracted in the
+  // MS.
+  RRParams rr;
+  rr.imageName="template.residual";
+  rr.run();
+  makeModelImage("template.residual", "test.model");
+
+  rr.imageName="fused.residual";
+  rr.modelImageName="test.model";
+  rr.run();
+
+  // Predict the model into the DATA column of a copy of the MS, and
+  // subtract it from the DATA column of the MS.
+  std::filesystem::copy("CYGTST.corespiral.ms", "model.ms", copy_options::recursive);
+  RRParams predict;
+  predict.MSNBuf="model.ms";
+  predict.imageName="predict.residual";
+  predict.modelImageName="test.model";
+  predict.imagingMode="predict";
+  predict.dataColumnName="data";
+  predict.run();
+  {
+    Table ms("CYGTST.corespiral.ms", Table::Update), modelMS("model.ms");
+    ASSERT_EQ(ms.nrow(), modelMS.nrow());
+    ArrayColumn<Complex> data(ms, "DATA"), model(modelMS, "DATA");
+    for (rownr_t row=0; row<ms.nrow(); row++)
+      data.put(row, data(row) - model(row));
+  }
+
+  rr.imageName="separate.residual";
+  rr.modelImageName="";
+  rr.run();
+  expectImagesMatch("fused.residual", "separate.residual", 1e-5);
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelSortVis) {
+  // Gridding in bins of the CFs changes only the order of the sums.
+  RRParams rr;
+  rr.nThreads=4;
+  const std::vector<std::pair<string,bool>> runs = {{"unsorted.residual", false}, {"sorted.residual", true}};
+  for (auto& r : runs)
+    {
+      rr.imageName=r.first;
+      rr.sortVis=r.second;
+      rr.run();
+    }
+  expectImagesMatch("unsorted.residual", "sorted.residual");
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelGridTiles) {
+  // The tiled gridder must give the untiled residual and weight
+  // images.
+  RRParams rr;
+  rr.nThreads=4;
+  for (string mode : {"residual", "weight"})
+    {
+      rr.imagingMode=mode;
+      const std::vector<std::pair<string,int>> runs = {{"untiled."+mode, 0}, {"tiled."+mode, 64}};
+      for (auto& r : runs)
+	{
+	  rr.imageName=r.first;
+	  rr.gridTileSize=r.second;
+	  rr.run();
+	}
+      expectImagesMatch("untiled."+mode, "tiled."+mode);
+    }
+}
+
+
+TEST_F(RoadrunnerAppTest, AppLevelATermOff) {
+  // Without the A-term and a CFCache, the CFs are made in memory.
+  // The PSF and residual images must be made from them.
+  RRParams rr;
+  rr.aTerm=false;
+  rr.cfCache="";
+  for (string mode : {"psf", "residual"})
+    {
+      rr.imagingMode=mode;
+      rr.imageName="aterm0."+mode;
+      rr.run();
+      ASSERT_TRUE(exists(path(rr.imageName))) << "Missing " << rr.imageName;
+      PagedImage<Float> im(rr.imageName);
+      Array<Float> pix=im.get();
+      EXPECT_TRUE(allTrue(isFinite(pix))) << rr.imageName;
+      EXPECT_GT(max(abs(pix)), 0.0) << rr.imageName;
+      if (mode == "psf")
+	{
+	  // The peak of the PSF is at the center.
+	  Float minVal, maxVal;
+	  IPosition minPos, maxPos;
+	  minMax(minVal, maxVal, minPos, maxPos, pix);
+	  EXPECT_EQ(maxPos(0), rr.NX/2);
+	  EXPECT_EQ(maxPos(1), rr.NX/2);
+	}
+    }
+}
+
+
 TEST(RoadrunnerTest, Interface_rmode_plus2) {
   // Test if the rmode is set correctly in Roadrunner()
   // Get the test name
@@ -364,6 +795,14 @@ TEST(RoadrunnerTest, Interface_rmode_plus2) {
   bool conjBeams=false;
   float pbLimit=0.01;
   bool doSPWDataIter=true;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {0.0,0.0};
 
   string ftmName="awphpg";
@@ -382,7 +821,7 @@ TEST(RoadrunnerTest, Interface_rmode_plus2) {
                  stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
                  ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
                  doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-                 doSPWDataIter);
+                 doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
   // Check that the images are generated
   path p1("BriggsRobust+2.weight");
@@ -441,6 +880,14 @@ TEST(RoadrunnerTest, Interface_rmode_minus2) {
   bool conjBeams=false;
   float pbLimit=0.01;
   bool doSPWDataIter=true;
+  int nThreads=0;
+  int vbPrefetch=0;
+  bool sortVis=false;
+  int gridTileSize=0;
+  float cfMemBudget=0;
+  bool aTerm=true;
+  int cfLookahead=2;
+  string visCacheName="";
   vector<float> posigdev = {0.0,0.0};
 
   string ftmName="awphpg";
@@ -459,7 +906,7 @@ TEST(RoadrunnerTest, Interface_rmode_minus2) {
                  stokes, refFreqStr, phaseCenter, weighting, rmode, robust,
                  ftmName,cfCache, imagingMode, WBAwp,fieldStr,spwStr,uvDistStr,
                  doPointing,normalize,doPBCorr, conjBeams, pbLimit, posigdev,
-                 doSPWDataIter);
+                 doSPWDataIter, nThreads, vbPrefetch, sortVis, gridTileSize, cfMemBudget, aTerm, cfLookahead, visCacheName);
 
   // Check that the images are generated
   path p3("BriggsRobust-2.weight");
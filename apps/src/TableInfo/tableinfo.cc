@@ -68,6 +68,9 @@ void TableInfo_func(const string& MSNBuf,
 	  MSSummary mss(ms);
 
 	  mss.list(logio, verbose!=0);
+	  // The metadata of the data iterations saved by DataBase (e.g.
+	  // by roadrunner or coyote), if any.
+	  libracore::MSMetaCache::list(MSNBuf, logio);
 	  ofs << (os.str().c_str()) << endl;
 //	  exit(0);
 	}
@@ -37,6 +37,7 @@
 #include <casacore/images/Images/ImageSummary.h>
 #include <casacore/casa/Containers/Record.h>
 #include <casacore/lattices/Lattices/PagedArray.h>
+#include <libracore/MSMetaCache.h>
 #include <fstream>
 
 using namespace std;
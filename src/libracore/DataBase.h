@@ -32,6 +32,19 @@
 #include <msvis/MSVis/VisBuffer2.h>
 #include <msvis/MSVis/ViFrequencySelection.h>
 #include <casacore/ms/MeasurementSets/MeasurementSet.h>
+#include <casacore/ms/MeasurementSets/MSColumns.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/casa/Arrays/Slicer.h>
+#include <casacore/casa/Arrays/ArrayMath.h>
+#include <casacore/casa/BasicSL/Constants.h>
+#include <synthesis/TransformMachines2/Utils.h>
+#include <libracore/MSMetaCache.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <map>
+#include <unordered_set>
 using namespace casa;
 using namespace casa::refim;
 using namespace casacore;
@@ -118,6 +131,30 @@ ForwardIterator remove_duplicates( ForwardIterator first,
 
     return new_last;
 }
+/**
+ * @brief The CF working set for a run of consecutive data chunks with the same SPW.
+ *
+ * DataBase::cfWorkList holds these in the order in which the data
+ * iterators deliver the data.  An SPW that is visited more than once
+ * (e.g. with multiple fields and no SPW data iteration) has one entry
+ * per visit.  The CF server prepares only the W-planes up to the max.
+ * |w| of the SPW, and the CFs nearest to the PA range of the SPW.
+ */
+struct CFWorkItem
+{
+  /// The SPW ID
+  int spwID;
+  /// The reference frequency (Hz) of the SPW
+  double spwRefFreq;
+  /// The FIELD IDs in the run, in the order of first appearance
+  std::vector<int> fieldIDs;
+  /// The range of parallactic angles (radians) at the start of the chunks in the run
+  double minPA, maxPA;
+  /// Max. |u|, |v| and |w| (in wavelengths at the highest frequency) of the selected data in the SPW
+  double maxU, maxV, maxW;
+  /// The no. of chunks in the run
+  unsigned nChunks;
+};
 /**
  * @brief A class for loading and manipulating measurement sets.
  *
@@ -127,7 +164,8 @@ class DataBase
 {
 public:
   DataBase():
-    msSelection(),theMS(),selectedMS(),spwidList(),fieldidList(),spwRefFreqList(),sortCols()
+    msSelection(),theMS(),selectedMS(),spwidList(),fieldidList(),spwRefFreqList(),sortCols(),
+    cfWorkList()
   {};
   /**
    * @brief Constructs a Database object with the specified parameters.
@@ -148,7 +186,8 @@ public:
 	   bool& doSPWDataIter,
 	   std::function<void(const MeasurementSet& )> verifyMS=[](const MeasurementSet&){}//NoOp
 	   ):
-    msSelection(),theMS(),selectedMS(),spwidList(),fieldidList(),spwRefFreqList(),fullFreqList(), sortCols()
+    msSelection(),theMS(),selectedMS(),spwidList(),fieldidList(),spwRefFreqList(),fullFreqList(), sortCols(),
+    cfWorkList()
   {
     LogIO log_l(LogOrigin("DataBase","DataBase"));
     log_l << "Opening the MS (\"" << MSNBuf << "\"), applying data selection, "
@@ -216,19 +255,74 @@ public:
     // may be a tad slower in the absolute sense, specially for large monolith MSes.  In a relative
     // sense, its cost will remain insignificant for most imaging cases.
     //
+    // The same (metadata-only) pass over the chunks also builds the
+    // CF working set in the order of the data iterations
+    // (cfWorkList).  The metadata from this pass is saved in the
+    // sidecar of the MS (see libracore::MSMetaCache), and read from
+    // there by the later runs with the same data selection.  Set
+    // DataBase.METACACHE=0 to always scan the MS.
+    //
     {
-      log_l << "Getting SPW ID list using VI..." << LogIO::POST;
+      std::chrono::time_point<std::chrono::steady_clock> scan_start = std::chrono::steady_clock::now();
+      bool useMetaCache = SynthesisUtils::getenv("DataBase.METACACHE", (Bool)true);
+      std::string selection="field="+fieldStr+"|spw="+spwStr+"|uvrange="+uvDistStr
+	+"|spwdataiter="+std::to_string(doSPWDataIter);
+      libracore::MSMetaCache metaCache(MSNBuf, selection);
+
+      std::vector<libracore::MSMetaCache::Chunk> chunks;
+      std::map<int, libracore::MSMetaCache::SPWInfo> spwInfo;
+      if (useMetaCache && metaCache.valid())
+	{
+	  log_l << "Getting SPW ID list and the CF working set from "
+		<< libracore::MSMetaCache::fileName(MSNBuf) << "..." << LogIO::POST;
+	  chunks = metaCache.chunks();
+	  spwInfo = metaCache.spws();
+	}
+      else
+	{
+	  log_l << "Getting SPW ID list and the CF working set using VI..." << LogIO::POST;
+	  spwInfo = spwStats();
+	  for (vi2_l->originChunks();vi2_l->moreChunks(); vi2_l->nextChunk())
+	    {
+	      vi2_l->origin(); // So that the global vb is valid
+	      chunks.push_back(libracore::MSMetaCache::Chunk{vb_l->spectralWindows()(0), vb_l->fieldId()(0),
+							      (Int64)vi2_l->nRowsInChunk(),
+							      vb_l->time()(0), getPA(*vb_l)});
+	    }
+	  if (useMetaCache) metaCache.save(chunks, spwInfo);
+	}
+
       std::vector<int> vb_SPWIDList;
       std::unordered_set<double> pa_set;
 
-      vi2_l->originChunks();
-      for (vi2_l->originChunks();vi2_l->moreChunks(); vi2_l->nextChunk())
+      cfWorkList.clear();
+      for (auto& chunk : chunks)
 	{
-	  vi2_l->origin(); // So that the global vb is valid
-	  vb_SPWIDList.push_back(vb_l->spectralWindows()(0));
+	  int spw = chunk.spw, field = chunk.field;
+	  double pa = chunk.pa;
+	  vb_SPWIDList.push_back(spw);
 
-	  pa_set.insert(getPA(*vb_l));
+	  pa_set.insert(pa);
 	  //vb_PAList.push_back(getPA(*vb_l));
+
+	  if (cfWorkList.empty() || (cfWorkList.back().spwID != spw))
+	    {
+	      CFWorkItem item;
+	      item.spwID = spw;
+	      item.spwRefFreq = ((unsigned)spw < spwRefFreqList.size()) ? spwRefFreqList[spw] : 0.0;
+	      item.minPA = item.maxPA = pa;
+	      item.maxU = spwInfo.count(spw) ? spwInfo[spw].maxU : 0.0;
+	      item.maxV = spwInfo.count(spw) ? spwInfo[spw].maxV : 0.0;
+	      item.maxW = spwInfo.count(spw) ? spwInfo[spw].maxW : 0.0;
+	      item.nChunks = 0;
+	      cfWorkList.push_back(item);
+	    }
+	  CFWorkItem& item = cfWorkList.back();
+	  if (std::find(item.fieldIDs.begin(), item.fieldIDs.end(), field) == item.fieldIDs.end())
+	    item.fieldIDs.push_back(field);
+	  item.minPA = std::min(item.minPA, pa);
+	  item.maxPA = std::max(item.maxPA, pa);
+	  item.nChunks++;
 	}
       std::vector<double> vb_PAList(pa_set.begin(), pa_set.end());
       //
@@ -254,10 +348,21 @@ public:
 					vb_PAList.end()),
 		      vb_PAList.end());
 
-      log_l << "...done." << endl
+      std::chrono::duration<double> scan_time = std::chrono::steady_clock::now() - scan_start;
+      log_l << "...done in " << scan_time.count() << " sec." << endl
 	    << vb_SPWIDList.size() << " SPWs, " << vb_PAList.size() << " PA values found."
 	    << LogIO::POST;
 
+      log_l << "CF working set (in the order of data iterations):" << LogIO::POST;
+      for (auto& item : cfWorkList)
+	log_l << "  SPW " << item.spwID
+	      << ": ref. freq. " << item.spwRefFreq << " Hz, "
+	      << item.fieldIDs.size() << " field(s), "
+	      << item.nChunks << " chunk(s), "
+	      << "PA [" << item.minPA*180.0/C::pi << ", " << item.maxPA*180.0/C::pi << "] deg, "
+	      << "max |u|, |v|, |w| " << item.maxU << ", " << item.maxV << ", " << item.maxW << " wavelengths"
+	      << LogIO::POST;
+
       //for(uint i=0; auto id : vb_SPWIDList) spwidList[i++]=id; // Works only in C++-20
       //uint i=0; for(auto id : vb_SPWIDList) spwidList[i++]=id;
       spwidList = vb_SPWIDList;
@@ -387,8 +492,66 @@ public:
 
   std::vector<int> spwidList, fieldidList;
   std::vector<double> spwRefFreqList, fullFreqList;
+  /**
+   * @brief The CF working set, in the order of data iterations.
+   *
+   * Filled in the constructor.  The CF server uses this to prepare
+   * the CFs in the same order as the data iterations consume them.
+   */
+  std::vector<CFWorkItem> cfWorkList;
 
 private:
+  //
+  //-------------------------------------------------------------------
+  // The no. of rows, the time range and the max. |u|, |v| and |w|
+  // per SPW for the selected MS.  The max. |u|, |v| and |w| are in
+  // wavelengths at the highest frequency of the SPW.  Only the UVW, TIME and DATA_DESC_ID
+  // columns are read, in blocks of rows.
+  //
+  std::map<int, libracore::MSMetaCache::SPWInfo> spwStats()
+  {
+    std::map<int, libracore::MSMetaCache::SPWInfo> stats;
+    ArrayColumn<Double> uvwCol(selectedMS, MS::columnName(MS::UVW));
+    ScalarColumn<Int> ddCol(selectedMS, MS::columnName(MS::DATA_DESC_ID));
+    ScalarColumn<Double> timeCol(selectedMS, MS::columnName(MS::TIME));
+    MSDataDescColumns ddc(selectedMS.dataDescription());
+    MSSpWindowColumns spwc(selectedMS.spectralWindow());
+    Vector<Int> dd2spw = ddc.spectralWindowId().getColumn();
+
+    const rownr_t nRows = selectedMS.nrow(), blockSize = 1<<20;
+    for (rownr_t r0 = 0; r0 < nRows; r0 += blockSize)
+      {
+	Slicer rows(IPosition(1, r0), IPosition(1, std::min(blockSize, nRows-r0)));
+	Matrix<Double> uvw(uvwCol.getColumnRange(rows));
+	Vector<Int> dd = ddCol.getColumnRange(rows);
+	Vector<Double> time = timeCol.getColumnRange(rows);
+	for (size_t i = 0; i < dd.nelements(); i++)
+	  {
+	    int spw = dd2spw(dd(i));
+	    auto itr = stats.find(spw);
+	    if (itr == stats.end())
+	      itr = stats.emplace(spw, libracore::MSMetaCache::SPWInfo{0, time(i), time(i), 0.0, 0.0, 0.0}).first;
+	    libracore::MSMetaCache::SPWInfo& s = itr->second;
+	    s.nRows++;
+	    s.minTime = std::min(s.minTime, time(i));
+	    s.maxTime = std::max(s.maxTime, time(i));
+	    s.maxU = std::max(s.maxU, std::abs(uvw(0, i)));
+	    s.maxV = std::max(s.maxV, std::abs(uvw(1, i)));
+	    s.maxW = std::max(s.maxW, std::abs(uvw(2, i)));
+	  }
+      }
+
+    for (auto& s : stats)
+      {
+	double toWavelengths = max(spwc.chanFreq()(s.first))/C::c;
+	s.second.maxU *= toWavelengths;
+	s.second.maxV *= toWavelengths;
+	s.second.maxW *= toWavelengths;
+      }
+
+    return stats;
+  }
+
   // Expand the MSSelection channel ranges into a flat list of per-channel
   // frequencies (Hz). This works correctly for any spw= selection expression,
   // including finer selections like "2:10~30;5:20~30,6~17:10~20".
@@ -32,11 +32,16 @@
 #ifndef LIBRACORE_DATAITERATOR_H
 #define LIBRACORE_DATAITERATOR_H
 
+#include <algorithm>
 #include <mutex>
 #include <future>
 #include <thread>
 #include <condition_variable>
 #include <functional>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
 #include <casacore/casa/Logging/LogFilter.h>
 #include <synthesis/TransformMachines2/MakeCFArray.h>
 #include <synthesis/TransformMachines2/ThreadCoordinator.h>
@@ -44,6 +49,13 @@
 #include <msvis/MSVis/VisibilityIterator2.h>
 #include <casacore/casa/System/ProgressMeter.h>
 #include <msvis/MSVis/VisBuffer2.h>
+#include <msvis/MSVis/VisBufferImpl2.h>
+#include <msvis/MSVis/VisBufferComponents2.h>
+#include <casacore/measures/Measures/MFrequency.h>
+#include <casacore/ms/MeasurementSets/MeasurementSet.h>
+#include <casacore/ms/MeasurementSets/MSIter.h>
+#include <casacore/tables/Tables/TableCopy.h>
+#include <synthesis/TransformMachines2/VisCache.h>
 //#include <hpg/hpg.hpp>
 
 using namespace std;
@@ -64,6 +76,174 @@ using namespace casacore;
 // CompareFirst(1,2) and CompareFirst(1.2,3.1) will both work?
 
 
+/**
+ * @brief In-memory copies of the subtables of an MS, used by the
+ * PrefetchedVisBuffer objects.
+ *
+ * The VI2 reads the subtables of the MS (and its own caches of the
+ * quantities derived from them) while it iterates in the reader
+ * thread, which must then not be used from the data consumer.  The
+ * copy is made from the thread that iterates the VI2.  The main table
+ * has only the first row of the MS (for the keywords and the
+ * measure references of the columns).  The POINTING, SYSCAL, WEATHER,
+ * HISTORY and FLAG_CMD subtables, which can be large and are not used
+ * by the gridders, are copied without rows.
+ */
+class PrefetchedSubtables
+{
+public:
+  PrefetchedSubtables(const MeasurementSet& ms, const Int msId)
+    : msId_p(msId), msName_p(ms.tableName()), ms_p(), msIter_p(), columns_p()
+  {
+    const static std::vector<String> noRows={"POINTING","SYSCAL","WEATHER","HISTORY","FLAG_CMD"};
+
+    // Without rows, also for all the subtables.
+    Table main_l = ms.copyToMemoryTable("PrefetchedSubtables", true);
+    if (ms.nrow() > 0)
+      {
+	main_l.addRow();
+	TableCopy::copyRows(main_l, ms, 0, 0, 1);
+      }
+
+    const TableRecord& keys_l = ms.keywordSet();
+    for (uInt i=0; i<keys_l.nfields(); i++)
+      if (keys_l.type(i) == TpTable)
+	{
+	  String name_l = keys_l.name(i);
+	  bool rows_l = std::find(noRows.begin(), noRows.end(), name_l) == noRows.end();
+	  main_l.rwKeywordSet().defineTable(name_l, keys_l.asTable(i).copyToMemoryTable(name_l, !rows_l));
+	}
+
+    ms_p = MeasurementSet(main_l);
+    msIter_p = new MSIter(ms_p, Block<Int>());
+    msIter_p->origin();
+    columns_p.reset(new vi::SubtableColumns(msIter_p));
+  };
+
+  bool isFor(const MeasurementSet& ms, const Int msId) const
+  {return (msId == msId_p) && (ms.tableName() == msName_p);};
+
+  const MeasurementSet& ms() const {return ms_p;};
+  const vi::SubtableColumns& subtableColumns() const {return *columns_p;};
+
+private:
+  Int msId_p;
+  String msName_p;
+  MeasurementSet ms_p;
+  CountedPtr<MSIter> msIter_p;
+  std::unique_ptr<vi::SubtableColumns> columns_p;
+};
+
+/**
+ * @brief A VisBuffer2 holding a copy of a VisBuffer2 of a VI2, filled
+ * in a reader thread.
+ *
+ * The copy holds the components that the gridders use (see
+ * DataIterator::prefetchComponents()), a snapshot of the channel
+ * frequencies (for row 0, in the frames used by the FTMachines) and
+ * of the feed PA (for the times of the rows), and the subtables of
+ * the MS (see PrefetchedSubtables).  The buffer never accesses the
+ * VI2, which by then is at a different position and is used by the
+ * reader thread: accessing a component or a quantity that was not
+ * copied raises an exception.
+ */
+class PrefetchedVisBuffer : public vi::VisBufferImpl2
+{
+public:
+  PrefetchedVisBuffer(vi::ViImplementation2 *vii)
+    : vi::VisBufferImpl2(vii, vi::VisBufferOptions(vi::VbWritable | vi::VbRekeyable)),
+      freqs_p(), chanNumbers_p(), feedPa_p(), subtables_p()
+  {};
+  ~PrefetchedVisBuffer() {};
+
+  /**
+   * @brief Copy the given components of src, fetching them from the VI2 if required.
+   *
+   * This must be called from the thread that iterates the VI2.
+   *
+   * @param subtables The copy of the subtables of the MS of src.
+   */
+  void fetch(const vi::VisBuffer2& src, const vi::VisBufferComponents2& components,
+	     const std::shared_ptr<const PrefetchedSubtables>& subtables)
+  {
+    copyComponents(src, components, true, true);
+
+    freqs_p.clear();
+    for (auto frame : {(Int)vi::VisBuffer2::FrameNotSpecified, (Int)MFrequency::LSRK})
+      freqs_p[frame] = src.getFrequencies(0, frame);
+    chanNumbers_p.assign(src.getChannelNumbers(0));
+
+    feedPa_p.clear();
+    const Vector<Double>& time_l = src.time();
+    for (uInt i=0; i<time_l.nelements(); i++)
+      if (feedPa_p.find(time_l(i)) == feedPa_p.end())
+	feedPa_p[time_l(i)] = src.feedPa(time_l(i));
+
+    subtables_p = subtables;
+  };
+
+  virtual const Vector<Double>& getFrequencies(Int rowInBuffer,
+					       Int frame = vi::VisBuffer2::FrameNotSpecified) const
+  {
+    checkRow(rowInBuffer);
+    auto f = freqs_p.find(frame);
+    if (f == freqs_p.end())
+      throw(AipsError("PrefetchedVisBuffer: frequencies for frame "+std::to_string(frame)+" were not prefetched"));
+    return f->second;
+  };
+  virtual Double getFrequency(Int rowInBuffer, Int frequencyIndex,
+			      Int frame = vi::VisBuffer2::FrameNotSpecified) const
+  {return getFrequencies(rowInBuffer, frame)(frequencyIndex);};
+  virtual const Vector<Int>& getChannelNumbers(Int rowInBuffer) const
+  {checkRow(rowInBuffer); return chanNumbers_p;};
+  virtual Int getChannelNumber(Int rowInBuffer, Int frequencyIndex) const
+  {return getChannelNumbers(rowInBuffer)(frequencyIndex);};
+
+  virtual const Vector<Float>& feedPa(Double time) const
+  {
+    auto pa = feedPa_p.find(time);
+    if (pa == feedPa_p.end())
+      throw(AipsError("PrefetchedVisBuffer: feed PA for time "+std::to_string(time)+" was not prefetched"));
+    return pa->second;
+  };
+
+  virtual const MeasurementSet& ms() const {return subtables().ms();};
+  virtual const vi::SubtableColumns& subtableColumns() const {return subtables().subtableColumns();};
+
+  // The other quantities computed by the VI2.
+  virtual MDirection azel0(Double) const {notPrefetched("azel0"); return MDirection();};
+  virtual const Vector<MDirection>& azel(Double) const {notPrefetched("azel"); return azel_p;};
+  virtual Double hourang(Double) const {notPrefetched("hourang"); return 0.0;};
+  virtual Float parang0(Double) const {notPrefetched("parang0"); return 0.0;};
+  virtual const Vector<Float>& parang(Double) const {notPrefetched("parang"); return parang_p;};
+
+private:
+  // The frequencies are a function of (SPW, time).  Rows other than
+  // row 0 are served only if they share these with row 0.
+  void checkRow(Int row) const
+  {
+    if ((row != 0) &&
+	((spectralWindows()(row) != spectralWindows()(0)) || (time()(row) != time()(0))))
+      throw(AipsError("PrefetchedVisBuffer: frequencies for row "+std::to_string(row)+" were not prefetched"));
+  };
+  const PrefetchedSubtables& subtables() const
+  {
+    if (!subtables_p) throw(AipsError("PrefetchedVisBuffer: the subtables were not prefetched"));
+    return *subtables_p;
+  };
+  void notPrefetched(const std::string& what) const
+  {
+    throw(AipsError("PrefetchedVisBuffer: "+what+" is not prefetched"));
+  };
+
+  std::map<Int, Vector<Double> > freqs_p;
+  Vector<Int> chanNumbers_p;
+  std::map<Double, Vector<Float> > feedPa_p;
+  std::shared_ptr<const PrefetchedSubtables> subtables_p;
+  Vector<MDirection> azel_p;
+  Vector<Float> parang_p;
+};
+
 /**
  * @brief A class for iterating over visibility data.
  *
@@ -80,16 +260,84 @@ public:
    * This constructor constructs a DataIterator object with the specified parameters.
    *
    * @param isroot Whether this is the root DataIterator object.
-   * @param dataCol The type of data column to use.
+   * @param dataCol The type of data column to use.  FTMachine::PSF if the data consumer does not use the visibilities (which are then not prefetched).
    */
   DataIterator(const bool isroot,casa::refim::FTMachine::Type dataCol)
-    :isRoot_p(isroot), dataCol_l(dataCol) {};
+    :isRoot_p(isroot), prefetchDepth_p(0), subtables_p(), visCache_p(nullptr), dataCol_l(dataCol) {};
   /**
    * @brief Destroys the DataIterator object.
    *
    * This destructor destroys the DataIterator object.
    */
   ~DataIterator() {};
+  /**
+   * @brief Sets the number of VisBuffers read ahead of the data consumer.
+   *
+   * With depth > 0, iterVB() iterates the VI2 in a separate (reader)
+   * thread which fills up to depth copies of the VisBuffer2 while the
+   * data consumer (the gridder) runs on the current one.  The data
+   * consumer is then called with a PrefetchedVisBuffer and a NULL
+   * VI2 pointer.  The consumer therefore cannot write to the VI2, and
+   * prefetch must not be used for writing the predicted data.
+   *
+   * @param depth The maximum no. of VisBuffers in the queue. 0 (the default) disables the prefetch.
+   */
+  void setPrefetchDepth(const int& depth) {prefetchDepth_p = (depth > 0) ? depth : 0;};
+  int prefetchDepth() const {return prefetchDepth_p;};
+  /**
+   * @brief Sets the cache of the visibility data.
+   *
+   * In VisCache::WRITE mode, each VisBuffer2 is saved in the cache
+   * before it is given to the data consumer (or copied by the reader
+   * thread).  In VisCache::READ mode, dataIter() does not iterate the
+   * VI2, and the data consumer is called with a VisCacheBuffer set
+   * from the cache and a NULL VI2 pointer (see iterCache()).  The
+   * prefetch is then not used.  The cache must be for the data column
+   * of this DataIterator.
+   *
+   * @param visCache The cache (not owned).  nullptr (the default) for no cache.
+   */
+  void setVisCache(casa::refim::VisCache *visCache) {visCache_p = visCache;};
+  /**
+   * @brief The VisBuffer components copied by the reader thread.
+   *
+   * The visibility cube for the data column of this DataIterator
+   * (none for FTMachine::PSF) and the components used by the
+   * (de-)gridders.  WEIGHT_SPECTRUM is included if it is in the MS.
+   */
+  vi::VisBufferComponents2 prefetchComponents(const vi::VisBuffer2& vb) const
+  {
+    using vi::VisBufferComponent2;
+    vi::VisBufferComponents2 comps =
+      vi::VisBufferComponents2::these({VisBufferComponent2::Antenna1, VisBufferComponent2::Antenna2,
+	    VisBufferComponent2::ArrayId, VisBufferComponent2::CorrType,
+	    VisBufferComponent2::DataDescriptionIds,
+	    VisBufferComponent2::Direction1, VisBufferComponent2::Direction2,
+	    VisBufferComponent2::Exposure,
+	    VisBufferComponent2::Feed1, VisBufferComponent2::Feed2,
+	    VisBufferComponent2::FeedPa1, VisBufferComponent2::FeedPa2,
+	    VisBufferComponent2::FieldId, VisBufferComponent2::FlagCube,
+	    VisBufferComponent2::FlagRow, VisBufferComponent2::ImagingWeight,
+	    VisBufferComponent2::ObservationId, VisBufferComponent2::PhaseCenter,
+	    VisBufferComponent2::PolFrame, VisBufferComponent2::PolarizationId,
+	    VisBufferComponent2::ProcessorId, VisBufferComponent2::RowIds,
+	    VisBufferComponent2::Scan, VisBufferComponent2::Sigma,
+	    VisBufferComponent2::SpectralWindows, VisBufferComponent2::StateId,
+	    VisBufferComponent2::Time, VisBufferComponent2::TimeCentroid,
+	    VisBufferComponent2::TimeInterval, VisBufferComponent2::Uvw,
+	    VisBufferComponent2::Weight, VisBufferComponent2::WeightScaled});
+
+    if (dataCol_l==casa::refim::FTMachine::CORRECTED)   comps += VisBufferComponent2::VisibilityCubeCorrected;
+    else if (dataCol_l==casa::refim::FTMachine::MODEL)  comps += VisBufferComponent2::VisibilityCubeModel;
+    else if (dataCol_l!=casa::refim::FTMachine::PSF)    comps += VisBufferComponent2::VisibilityCubeObserved;
+
+    if (vb.existsColumn(VisBufferComponent2::WeightSpectrum))
+      {
+	comps += VisBufferComponent2::WeightSpectrum;
+	comps += VisBufferComponent2::WeightSpectrumScaled;
+      }
+    return comps;
+  };
   //
   //-------------------------------------------------------------------------------------------------
   //
@@ -119,11 +367,23 @@ public:
 	 std::function<void(const int&)>& cfSentNotifier
 	 )
   {
+    if (prefetchDepth_p > 0)
+      return iterVBPrefetch(vi2, vb, nVB, dataConsumer, cfSentNotifier);
+
     int vol=0,nRows=0;
     double dataIO_time=0.0;
 
     for (vi2->origin(); vi2->more(); vi2->next())
       {
+	if (visCache_p)
+	  {
+	    std::chrono::time_point<std::chrono::steady_clock> cache_start
+	      = std::chrono::steady_clock::now();
+	    visCache_p->save(*vb);
+	    std::chrono::duration<double> tt = std::chrono::steady_clock::now() - cache_start;
+	    dataIO_time += tt.count();
+	  }
+
 	auto ret=dataConsumer(vb,vi2);
 	vol += ret[0]; // Vis volume in bytes
 	dataIO_time += ret[1];
@@ -169,6 +429,9 @@ public:
 	   )
     
   {
+    if (visCache_p && (visCache_p->mode() == casa::refim::VisCache::READ))
+      return iterCache(vi2, dataConsumer, waitForCFReady, cfSentNotifier);
+
     unsigned long vol=0,nRows=0;
     int nVB=0;
     int spwNdx=0;
@@ -182,6 +445,7 @@ public:
   	vi2->origin(); // So that the global vb is valid
 
 	waitForCFReady(nVB,spwNdx);
+	if (visCache_p) visCache_p->newChunk();
 
   	std::chrono::time_point<std::chrono::steady_clock> griddingEngine_start
   	  = std::chrono::steady_clock::now();
@@ -194,21 +458,14 @@ public:
 	// (non HPG) these functions are a NoOp.
 	//
 	// The loop over data below blocks till waitForCFReady() returns.
-	// After CFReady signal is received from the CFServer thread, in
-	// waitForCFSent the current CFSI (cfsi_g) and the device CFArray
-	// (dcfa_sptr_g) are set for the vis resampler if a new CF set is
-	// available (due to change in VB SPW ID).  The CFArray is then
-	// sent to the device from the waitForCFReady() lambda
-	// function. iterVB() then calls cfSentNotifier() function to send
-	// the CFSent signal after successfully triggering the gridding
-	// with the current VB and CFs on the device.  CFServer in the
-	// main thread blocks till it gets the CFSent signal, after which
-	// it starts filling the DeviceCFArray with the next CF set in
-	// parallel with gridding which is always in the main thread, and
-	// issues a CFReady signal when the DeviceCFArray is ready for
-	// use.  Gridding is triggered via the call to iterVB() of this
-	// class instance, but the call is always made from the main
-	// thread.
+	// For a VB with a new SPW ID, waitForCFReady() takes the next CF
+	// set from the queue filled by the CFServer thread (waiting for
+	// it if it is not yet prepared), and sets the CFSI and the
+	// device CFArray for the vis resampler if the CF set has new
+	// CFs.  The CFServer thread prepares the CF sets for the next
+	// few SPWs in parallel with gridding, which is always in the
+	// main thread.  iterVB() then calls cfSentNotifier() after
+	// triggering the gridding of the first VB with the current CFs.
 	//
 
   	auto ret = iterVB(vi2, vb2,
@@ -233,7 +490,229 @@ public:
 
 
 private:
+  //
+  //-------------------------------------------------------------------------------------------------
+  //
+  /**
+   * @brief dataIter() from a VisCache in VisCache::READ mode.
+   *
+   * The cached VisBuffers are set in a VisCacheBuffer in the order
+   * of the data iterations of the pass that wrote the cache, and the
+   * VI2 is not iterated.  waitForCFReady() is called before the first
+   * VisBuffer of each chunk, as in dataIter().  The data consumer is
+   * called with a NULL VI2 pointer.  The time to set the
+   * VisCacheBuffer is the data I/O time.
+   *
+   * @return The same as dataIter().
+   */
+  std::vector<double>
+  iterCache(vi::VisibilityIterator2 *vi2,
+	    std::function<std::vector<double> (vi::VisBuffer2* vb,vi::VisibilityIterator2 *vi2_l)>& dataConsumer,
+	    std::function<void(int&, int& )>& waitForCFReady,
+	    std::function<void(const int&)>& cfSentNotifier
+	    )
+  {
+    double vol=0,nRows=0;
+    int nVB=0;
+    int spwNdx=0;
+    double griddingEngine_time=0,totalDataIO_time=0.0;
+
+    if (!cacheBuffer_p)
+      cacheBuffer_p.reset(new casa::refim::VisCacheBuffer(vi2->getImpl()));
+
+    ProgressMeter pm(1.0, vi2->ms().nrow(),
+		     "dataIter", "","","",true);
+
+    std::chrono::time_point<std::chrono::steady_clock> griddingEngine_start
+      = std::chrono::steady_clock::now();
+    for (size_t i=0; i<visCache_p->nVB(); i++)
+      {
+	if (visCache_p->startsChunk(i))
+	  {
+	    std::chrono::duration<double> tt = std::chrono::steady_clock::now() - griddingEngine_start;
+	    griddingEngine_time += tt.count();
+	    waitForCFReady(nVB,spwNdx);
+	    griddingEngine_start = std::chrono::steady_clock::now();
+	  }
+
+	std::chrono::time_point<std::chrono::steady_clock> cache_start
+	  = std::chrono::steady_clock::now();
+	visCache_p->read(i, *cacheBuffer_p);
+	std::chrono::duration<double> tt = std::chrono::steady_clock::now() - cache_start;
+	totalDataIO_time += tt.count();
+
+	auto ret=dataConsumer(cacheBuffer_p.get(),nullptr);
+	vol += ret[0]; // Vis volume in bytes
+	totalDataIO_time += ret[1];
+	nRows+=cacheBuffer_p->nRows();
+
+	cfSentNotifier(nVB);
+
+	nVB++;
+
+	if (CFServerThreadExceptionPtr_g) throw(AipsError("Exception in the CFServer thread"));
+	if (isRoot_p)
+  	  pm.update(Double(nRows));
+      }
+    std::chrono::duration<double> tt = std::chrono::steady_clock::now() - griddingEngine_start;
+    griddingEngine_time += tt.count();
+
+    std::vector<double> ret={(double)nVB, vol,griddingEngine_time,totalDataIO_time,nRows};
+    return ret;
+  };
+  //
+  //-------------------------------------------------------------------------------------------------
+  //
+  /**
+   * @brief iterVB() with the VI2 iterated in a reader thread.
+   *
+   * The reader thread fills a pool of prefetchDepth_p
+   * PrefetchedVisBuffer objects in the order of iterations and the
+   * data consumer runs in the calling thread.  The reader blocks
+   * when all buffers are in use, i.e. the queue is bounded.  The VI2
+   * is used only from the reader thread till this method returns.
+   *
+   * The returned I/O time is the time the data consumer waited for
+   * the data (the I/O not hidden behind the consumer) plus the time
+   * reported by the consumer.
+   */
+  std::vector<double>
+  iterVBPrefetch(vi::VisibilityIterator2 *vi2,
+		 vi::VisBuffer2 *vb,
+		 int& nVB,
+		 std::function<std::vector<double> (vi::VisBuffer2* vb,vi::VisibilityIterator2 *vi2_l)>& dataConsumer,
+		 std::function<void(const int&)>& cfSentNotifier
+		 )
+  {
+    double vol=0,nRows=0;
+    double dataIO_time=0.0;
+
+    if (vbPool_p.size() != (size_t)prefetchDepth_p)
+      {
+	vbPool_p.clear();
+	for (int i=0; i<prefetchDepth_p; i++)
+	  vbPool_p.push_back(std::unique_ptr<PrefetchedVisBuffer>(new PrefetchedVisBuffer(vi2->getImpl())));
+      }
+
+    std::mutex mut;
+    std::condition_variable freeCV, readyCV;
+    std::deque<PrefetchedVisBuffer*> freeQ, readyQ;
+    bool readerDone=false, abort=false;
+    std::exception_ptr readerException=nullptr;
+
+    for (auto& b : vbPool_p) freeQ.push_back(b.get());
+
+    auto reader = [&]()
+      {
+	try
+	  {
+	    vi2->origin();
+	    vi::VisBufferComponents2 comps = prefetchComponents(*vb);
+	    for (; vi2->more(); vi2->next())
+	      {
+		PrefetchedVisBuffer *buf;
+		{
+		  std::unique_lock<std::mutex> lok(mut);
+		  freeCV.wait(lok, [&]{ return !freeQ.empty() || abort; });
+		  if (abort) break;
+		  buf = freeQ.front(); freeQ.pop_front();
+		}
+
+		if (visCache_p) visCache_p->save(*vb);
+		if (!subtables_p || !subtables_p->isFor(vb->ms(), vb->msId()))
+		  subtables_p = std::make_shared<const PrefetchedSubtables>(vb->ms(), vb->msId());
+		buf->fetch(*vb, comps, subtables_p);
+
+		{
+		  std::lock_guard<std::mutex> lok(mut);
+		  readyQ.push_back(buf);
+		}
+		readyCV.notify_one();
+	      }
+	  }
+	catch (...)
+	  {
+	    readerException = std::current_exception();
+	  }
+	{
+	  std::lock_guard<std::mutex> lok(mut);
+	  readerDone=true;
+	}
+	readyCV.notify_one();
+      };
+
+    std::thread readerThread(reader);
+
+    try
+      {
+	while (true)
+	  {
+	    PrefetchedVisBuffer *buf=nullptr;
+	    {
+	      std::chrono::time_point<std::chrono::steady_clock> wait_start
+		= std::chrono::steady_clock::now();
+	      std::unique_lock<std::mutex> lok(mut);
+	      readyCV.wait(lok, [&]{ return !readyQ.empty() || readerDone; });
+	      std::chrono::duration<double> tt = std::chrono::steady_clock::now() - wait_start;
+	      dataIO_time += tt.count();
+	      if (readyQ.empty()) break; // readerDone
+	      buf = readyQ.front(); readyQ.pop_front();
+	    }
+
+	    auto ret=dataConsumer(buf,nullptr);
+	    vol += ret[0]; // Vis volume in bytes
+	    dataIO_time += ret[1];
+	    nRows+=buf->nRows();
+
+	    {
+	      std::lock_guard<std::mutex> lok(mut);
+	      freeQ.push_back(buf);
+	    }
+	    freeCV.notify_one();
+
+	    cfSentNotifier(nVB);
+
+	    nVB++;
+	  }
+      }
+    catch (...)
+      {
+	{
+	  std::lock_guard<std::mutex> lok(mut);
+	  abort=true;
+	}
+	freeCV.notify_one();
+	readerThread.join();
+	throw;
+      }
+    readerThread.join();
+    if (readerException) std::rethrow_exception(readerException);
+
+    std::vector<double> ret={vol,dataIO_time,nRows};
+    return ret;
+  };
+
   bool isRoot_p;
+  /**
+   * @brief The no. of VisBuffers read ahead of the consumer (0: no prefetch).
+   */
+  int prefetchDepth_p;
+  /**
+   * @brief The pool of buffers used by the reader thread.
+   */
+  std::vector<std::unique_ptr<PrefetchedVisBuffer> > vbPool_p;
+  /**
+   * @brief The copy of the subtables of the MS, shared by the buffers in the pool.
+   */
+  std::shared_ptr<const PrefetchedSubtables> subtables_p;
+  /**
+   * @brief The cache of the visibility data (nullptr for no cache).
+   */
+  casa::refim::VisCache *visCache_p;
+  /**
+   * @brief The VisBuffer set from the cache in VisCache::READ mode.
+   */
+  std::unique_ptr<casa::refim::VisCacheBuffer> cacheBuffer_p;
   /**
    * @brief The type of data column to use.
    */
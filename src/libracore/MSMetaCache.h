@@ -0,0 +1,364 @@
+// -*- C++ -*-
+//# MSMetaCache.h: Definition of the MSMetaCache class
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+
+/**
+ * @file MSMetaCache.h
+ * @brief Contains the sidecar file with the metadata of the data iterations over an MS.
+ */
+
+#ifndef LIBRACORE_MSMETACACHE_H
+#define LIBRACORE_MSMETACACHE_H
+
+#include <casacore/casa/IO/AipsIO.h>
+#include <casacore/casa/OS/File.h>
+#include <casacore/casa/OS/Path.h>
+#include <casacore/casa/Containers/Record.h>
+#include <casacore/casa/Arrays/Vector.h>
+#include <casacore/casa/Logging/LogIO.h>
+#include <casacore/casa/Exceptions/Error.h>
+#include <casacore/casa/Quanta/MVTime.h>
+#include <casacore/casa/BasicSL/Constants.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libracore
+{
+  /**
+   * @brief The latest modification time (ns) of the files of the MS and of its subtables (0 if it does not exist).
+   *
+   * The directories of the MS are scanned recursively, since the
+   * subtables (e.g. POINTING, or the SPECTRAL_WINDOW of a
+   * concatenated MS) are modified without touching the files of the
+   * main table.  Only the files (table.dat, table.f* etc.) are used.
+   * The lock files, which are written when a table is opened, and
+   * the directories, which are modified when a lock file is made,
+   * are excluded.
+   */
+  inline casacore::Int64 msStamp(const std::string& msName)
+  {
+    struct stat st;
+    if (::stat(msName.c_str(), &st) != 0) return 0;
+    if (!S_ISDIR(st.st_mode))
+      return (casacore::Int64)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec;
+
+    casacore::Int64 stamp=0;
+    if (DIR* d=opendir(msName.c_str()))
+      {
+	while (struct dirent* e=readdir(d))
+	  {
+	    std::string n(e->d_name);
+	    if ((n[0] != '.') && (n != "table.lock"))
+	      stamp = std::max(stamp, msStamp(msName+'/'+n));
+	  }
+	closedir(d);
+      }
+    return stamp;
+  }
+
+  /**
+   * @class MSMetaCache
+   * @brief The metadata of the data iterations over an MS, saved in a sidecar file of the MS.
+   *
+   * DataBase iterates over all the chunks of the VI2 to find the
+   * SPWs, fields and PAs in the order of the data iterations, and
+   * reads the UVW column for the max. |u|, |v| and |w| of each SPW.  These are
+   * saved in <MS>.meta (an AipsIO Record, next to the MS) for each
+   * data selection, and read from there by the later runs (e.g. of
+   * roadrunner in each major cycle, or of coyote) instead.
+   *
+   * The sidecar is keyed on the modification time of the files of
+   * the MS and of its subtables (see msStamp()).  The metadata of all data selections is
+   * dropped when the MS is modified.  A sidecar that cannot be
+   * written (e.g. in a read-only directory) is not an error.
+   */
+  class MSMetaCache
+  {
+  public:
+    /**
+     * @brief The metadata of a chunk of the data iterations.
+     */
+    struct Chunk
+    {
+      casacore::Int spw, field;
+      casacore::Int64 nRows;
+      /// The time (MJD seconds) and PA (radians) of the first VisBuffer of the chunk
+      casacore::Double time, pa;
+    };
+    /**
+     * @brief The metadata of the selected rows of an SPW.
+     */
+    struct SPWInfo
+    {
+      casacore::Int64 nRows;
+      /// The range of the time (MJD seconds) of the rows
+      casacore::Double minTime, maxTime;
+      /// Max. |u|, |v| and |w| (in wavelengths at the highest frequency of the SPW)
+      casacore::Double maxU, maxV, maxW;
+    };
+
+    static std::string fileName(const std::string& msName)
+    {return casacore::Path(msName).absoluteName()+".meta";};
+    /**
+     * @brief Loads the metadata for the data selection from the sidecar of the MS, if there is one.
+     *
+     * @param msName The name of the MS.
+     * @param selection A description of the data selection (with any other setting that changes the data iterations).
+     */
+    MSMetaCache(const std::string& msName, const std::string& selection)
+      : msName_p(msName), selection_p(selection), stamp_p(msStamp(msName)),
+	valid_p(false), chunks_p(), spws_p()
+    {
+      casacore::Record rec;
+      if (!load_p(rec)) return;
+      for (casacore::uInt i=0; i<rec.nfields(); i++)
+	if (rec.dataType(i) == casacore::TpRecord)
+	  {
+	    const casacore::Record& sel = rec.asRecord(i);
+	    if (sel.asString("selection") == selection_p)
+	      {
+		fromRecord(sel, chunks_p, spws_p);
+		valid_p = true;
+		break;
+	      }
+	  }
+    };
+    /**
+     * @brief true if the sidecar has the metadata for the data selection of the MS as it is now.
+     */
+    bool valid() const {return valid_p;};
+    const std::vector<Chunk>& chunks() const {return chunks_p;};
+    const std::map<casacore::Int, SPWInfo>& spws() const {return spws_p;};
+    /**
+     * @brief Sets the metadata for the data selection, and saves it in the sidecar.
+     *
+     * @return false if the sidecar could not be written.
+     */
+    bool save(const std::vector<Chunk>& chunks, const std::map<casacore::Int, SPWInfo>& spws)
+    {
+      chunks_p = chunks;
+      spws_p = spws;
+      valid_p = true;
+
+      // Keep the metadata of the other selections if the MS is not
+      // modified since.
+      casacore::Record rec;
+      if (!load_p(rec))
+	{
+	  rec = casacore::Record();
+	  rec.define("version", version);
+	  rec.define("stamp", stamp_p);
+	}
+      casacore::Int n=0;
+      std::string name;
+      for (;; n++)
+	{
+	  name = "sel"+std::to_string(n);
+	  if (!rec.isDefined(name) || (rec.asRecord(name).asString("selection") == selection_p)) break;
+	}
+      rec.defineRecord(name, toRecord());
+
+      //
+      // Write a temporary file and rename it, so that concurrent
+      // readers (e.g. other processes) never see a partial sidecar.
+      //
+      std::string fName = fileName(msName_p), tmpName = fName+".tmp."+std::to_string(getpid());
+      try
+	{
+	  {
+	    casacore::AipsIO file(tmpName, casacore::ByteIO::New);
+	    file << rec;
+	  }
+	  if (std::rename(tmpName.c_str(), fName.c_str()) != 0)
+	    throw(casacore::AipsError("Cannot rename "+tmpName));
+	}
+      catch (casacore::AipsError& x)
+	{
+	  ::unlink(tmpName.c_str());
+	  casacore::LogIO log_l(casacore::LogOrigin("MSMetaCache","save"));
+	  log_l << "Could not write " << fName << ": " << x.getMesg() << casacore::LogIO::NORMAL;
+	  return false;
+	}
+      return true;
+    };
+    /**
+     * @brief Lists the metadata in the sidecar of the MS, if there is one.
+     */
+    static void list(const std::string& msName, casacore::LogIO& os)
+    {
+      std::string fName = fileName(msName);
+      if (!casacore::File(fName).exists()) return;
+
+      casacore::Record rec;
+      try
+	{
+	  casacore::AipsIO file(fName, casacore::ByteIO::Old);
+	  file >> rec;
+	}
+      catch (casacore::AipsError& x)
+	{
+	  os << "Unreadable metadata sidecar " << fName << ": " << x.getMesg() << casacore::LogIO::WARN;
+	  return;
+	}
+      bool current = rec.isDefined("stamp") && (rec.asInt64("stamp") == msStamp(msName));
+      os << "Metadata sidecar " << fName
+	 << (current ? "" : " (out of date: the MS is modified since)") << casacore::LogIO::POST;
+
+      for (casacore::uInt i=0; i<rec.nfields(); i++)
+	{
+	  if (rec.dataType(i) != casacore::TpRecord) continue;
+	  const casacore::Record& sel = rec.asRecord(i);
+	  std::vector<Chunk> chunks;
+	  std::map<casacore::Int, SPWInfo> spws;
+	  fromRecord(sel, chunks, spws);
+
+	  os << "  Selection " << sel.asString("selection") << ": "
+	     << chunks.size() << " chunks" << casacore::LogIO::POST;
+	  for (auto& s : spws)
+	    {
+	      double minPA=0, maxPA=0;
+	      bool first=true;
+	      for (auto& c : chunks)
+		if (c.spw == s.first)
+		  {
+		    minPA = first ? c.pa : std::min(minPA, c.pa);
+		    maxPA = first ? c.pa : std::max(maxPA, c.pa);
+		    first = false;
+		  }
+	      os << "    SPW " << s.first << ": " << s.second.nRows << " rows, "
+		 << casacore::MVTime(s.second.minTime/casacore::C::day).string(casacore::MVTime::YMD, 7) << " ~ "
+		 << casacore::MVTime(s.second.maxTime/casacore::C::day).string(casacore::MVTime::YMD, 7) << ", "
+		 << "PA [" << minPA*180.0/casacore::C::pi << ", " << maxPA*180.0/casacore::C::pi << "] deg, "
+		 << "max |u|, |v|, |w| " << s.second.maxU << ", " << s.second.maxV << ", "
+		 << s.second.maxW << " wavelengths" << casacore::LogIO::POST;
+	    }
+	}
+    };
+
+  private:
+    static constexpr casacore::Int version=4;
+    //
+    // Load the sidecar, if there is one for the MS as it is now.
+    //
+    bool load_p(casacore::Record& rec) const
+    {
+      std::string fName = fileName(msName_p);
+      if (!casacore::File(fName).exists()) return false;
+      try
+	{
+	  casacore::AipsIO file(fName, casacore::ByteIO::Old);
+	  file >> rec;
+	  return (rec.asInt("version") == version) && (rec.asInt64("stamp") == stamp_p);
+	}
+      catch (casacore::AipsError& x)
+	{
+	  casacore::LogIO log_l(casacore::LogOrigin("MSMetaCache","load"));
+	  log_l << "Ignoring the unreadable " << fName << ": " << x.getMesg() << casacore::LogIO::WARN;
+	}
+      return false;
+    };
+
+    casacore::Record toRecord() const
+    {
+      size_t n=chunks_p.size(), nSPW=spws_p.size();
+      casacore::Vector<casacore::Int> spw(n), field(n);
+      casacore::Vector<casacore::Int64> nRows(n);
+      casacore::Vector<casacore::Double> time(n), pa(n);
+      for (size_t i=0; i<n; i++)
+	{
+	  const Chunk& c=chunks_p[i];
+	  spw(i)=c.spw; field(i)=c.field; nRows(i)=c.nRows; time(i)=c.time; pa(i)=c.pa;
+	}
+      casacore::Vector<casacore::Int> spwID(nSPW);
+      casacore::Vector<casacore::Int64> spwRows(nSPW);
+      casacore::Vector<casacore::Double> minTime(nSPW), maxTime(nSPW), maxU(nSPW), maxV(nSPW), maxW(nSPW);
+      size_t i=0;
+      for (auto& s : spws_p)
+	{
+	  spwID(i)=s.first; spwRows(i)=s.second.nRows;
+	  minTime(i)=s.second.minTime; maxTime(i)=s.second.maxTime;
+	  maxU(i)=s.second.maxU; maxV(i)=s.second.maxV; maxW(i)=s.second.maxW;
+	  i++;
+	}
+
+      casacore::Record sel;
+      sel.define("selection", casacore::String(selection_p));
+      sel.define("spw", spw);
+      sel.define("field", field);
+      sel.define("nrows", nRows);
+      sel.define("time", time);
+      sel.define("pa", pa);
+      sel.define("spwid", spwID);
+      sel.define("spwnrows", spwRows);
+      sel.define("spwmintime", minTime);
+      sel.define("spwmaxtime", maxTime);
+      sel.define("spwmaxu", maxU);
+      sel.define("spwmaxv", maxV);
+      sel.define("spwmaxw", maxW);
+      return sel;
+    };
+
+    static void fromRecord(const casacore::Record& sel, std::vector<Chunk>& chunks,
+			   std::map<casacore::Int, SPWInfo>& spws)
+    {
+      casacore::Vector<casacore::Int> spw, field, spwID;
+      casacore::Vector<casacore::Int64> nRows, spwRows;
+      casacore::Vector<casacore::Double> time, pa, minTime, maxTime, maxU, maxV, maxW;
+      sel.get("spw", spw);
+      sel.get("field", field);
+      sel.get("nrows", nRows);
+      sel.get("time", time);
+      sel.get("pa", pa);
+      sel.get("spwid", spwID);
+      sel.get("spwnrows", spwRows);
+      sel.get("spwmintime", minTime);
+      sel.get("spwmaxtime", maxTime);
+      sel.get("spwmaxu", maxU);
+      sel.get("spwmaxv", maxV);
+      sel.get("spwmaxw", maxW);
+
+      chunks.resize(spw.nelements());
+      for (size_t i=0; i<chunks.size(); i++)
+	chunks[i] = Chunk{spw(i), field(i), nRows(i), time(i), pa(i)};
+      spws.clear();
+      for (size_t i=0; i<spwID.nelements(); i++)
+	spws[spwID(i)] = SPWInfo{spwRows(i), minTime(i), maxTime(i), maxU(i), maxV(i), maxW(i)};
+    };
+
+    std::string msName_p, selection_p;
+    casacore::Int64 stamp_p;
+    bool valid_p;
+    std::vector<Chunk> chunks_p;
+    std::map<casacore::Int, SPWInfo> spws_p;
+  };
+};
+#endif
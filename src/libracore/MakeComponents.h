@@ -129,7 +129,10 @@ createAWPFTMachine(const String ftmName,
   //
   CountedPtr<refim::VisibilityResamplerBase> visResampler;
   int vbBucketSize = refim::SynthesisUtils::getenv("VBBUCKETSIZE",20000);
-  if (ftmName == "awphpg") visResampler = new refim::AWVisResamplerHPG(false,vbBucketSize);
+  // No. of buckets in the ring of VisData buckets.  A bucket is
+  // filled while the earlier ones are consumed by HPG.
+  int nVBBuckets = refim::SynthesisUtils::getenv("VBBUCKETS",2);
+  if (ftmName == "awphpg") visResampler = new refim::AWVisResamplerHPG(false,vbBucketSize,nVBBuckets);
   else visResampler = new refim::AWVisResampler();
   visResampler->setModelImage(modelImageName);
   //
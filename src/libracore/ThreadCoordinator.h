@@ -32,6 +32,8 @@
 #include <thread>
 #include <condition_variable>
 #include <functional>
+#include <deque>
+#include <utility>
 using namespace std;
 // using namespace std::this_thread; // sleep_for, sleep_until
 // using namespace std::chrono;      // nanoseconds, system_clock, seconds
@@ -215,5 +217,98 @@ namespace libracore
     std::condition_variable CFSent_cv;
     std::ostream* os;
   };
+  /**
+   * @class LookaheadQueue
+   * @brief A bounded FIFO queue between a producer and a consumer thread.
+   *
+   * The producer (e.g. the CFServer thread) fills the queue ahead of
+   * the consumer (the gridder thread).  push() blocks while the queue
+   * holds maxItems items, or while adding the item would take the
+   * queue over maxBytes (if maxBytes > 0).  An item is always
+   * accepted by an empty queue, so that an item larger than maxBytes
+   * does not block the producer for ever.  pop() blocks till an item
+   * is available.  Either side can close() the queue, which unblocks
+   * the other side.
+   */
+  template <class T>
+  class LookaheadQueue
+  {
+  public:
+    /**
+     * @brief Constructor for the LookaheadQueue class.
+     * @param maxItems The maximum no. of items in the queue (at least 1).
+     * @param maxBytes The maximum size of the items in the queue (0 for no limit).
+     */
+    LookaheadQueue(size_t maxItems=1, size_t maxBytes=0) :
+      maxItems_p(maxItems > 0 ? maxItems : 1), maxBytes_p(maxBytes), bytes_p(0),
+      closed_p(false), items_p(), mut_p(), notFull_cv(), notEmpty_cv()
+    {
+    }
+    /**
+     * @fn bool LookaheadQueue::push(T&& item, size_t bytes)
+     * @brief Adds an item to the end of the queue.  Blocks while the queue is full.
+     * @param item The item.
+     * @param bytes The size of the item.
+     * @return false if the queue was closed (the item is then dropped).
+     */
+    bool push(T&& item, size_t bytes=0)
+    {
+      std::unique_lock<std::mutex> lok(mut_p);
+      notFull_cv.wait(lok, [this, bytes]
+		      { return closed_p || items_p.empty() ||
+			  ((items_p.size() < maxItems_p) &&
+			   ((maxBytes_p == 0) || (bytes_p + bytes <= maxBytes_p))); });
+      if (closed_p) return false;
+      items_p.emplace_back(std::move(item), bytes);
+      bytes_p += bytes;
+      notEmpty_cv.notify_one();
+      return true;
+    }
+    /**
+     * @fn bool LookaheadQueue::pop(T& item)
+     * @brief Removes the item at the front of the queue.  Blocks till an item is available.
+     * @param item The item.
+     * @return false if the queue is empty and closed.
+     */
+    bool pop(T& item)
+    {
+      std::unique_lock<std::mutex> lok(mut_p);
+      notEmpty_cv.wait(lok, [this]
+		       { return closed_p || !items_p.empty(); });
+      if (items_p.empty()) return false;
+      item = std::move(items_p.front().first);
+      bytes_p -= items_p.front().second;
+      items_p.pop_front();
+      notFull_cv.notify_one();
+      return true;
+    }
+    /**
+     * @fn void LookaheadQueue::close()
+     * @brief Closes the queue.  The items already in the queue can still be removed with pop().
+     */
+    void close()
+    {
+      std::lock_guard<std::mutex> k(mut_p);
+      closed_p = true;
+      notFull_cv.notify_all();
+      notEmpty_cv.notify_all();
+    }
+    /**
+     * @fn size_t LookaheadQueue::size()
+     * @return The no. of items in the queue.
+     */
+    size_t size()
+    {
+      std::lock_guard<std::mutex> k(mut_p);
+      return items_p.size();
+    }
+
+  private:
+    size_t maxItems_p, maxBytes_p, bytes_p;
+    bool closed_p;
+    std::deque<std::pair<T, size_t>> items_p;
+    std::mutex mut_p;
+    std::condition_variable notFull_cv, notEmpty_cv;
+  };
 };
 #endif
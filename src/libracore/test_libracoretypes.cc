@@ -4,6 +4,9 @@
 #include <libracore/Matrix.h>
 #include <libracore/Vector.h>
 #include <libracore/imageInterface.h>
+#include <libracore/MSMetaCache.h>
+#include <fstream>
+#include <thread>
 
 using namespace std;
 
@@ -289,4 +292,59 @@ TEST(MdspanConversionTest, RoundTripMdspanCasamatrix)
             EXPECT_EQ(md2(i, j), matrix(i, j));
 }
 
+
+TEST(MSMetaCacheTest, SaveLoadAndInvalidate)
+{
+    // The sidecar needs only the files of the MS, not a valid MS.
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "MSMetaCacheTest";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "test.ms" / "POINTING");
+    std::ofstream(dir / "test.ms" / "table.f0") << "rows";
+    std::ofstream(dir / "test.ms" / "POINTING" / "table.f0") << "rows";
+    std::string msName = (dir / "test.ms").string();
+
+    std::vector<libracore::MSMetaCache::Chunk> chunks = {{0, 1, 100, 4.9e9, 0.1},
+                                                         {2, 1, 50, 4.9e9+10, 0.2}};
+    std::map<casacore::Int, libracore::MSMetaCache::SPWInfo> spws = {{0, {100, 4.9e9, 4.9e9+5, 800.0, 700.0, 12.5}},
+                                                                     {2, {50, 4.9e9+10, 4.9e9+20, 1600.0, 1400.0, 25.0}}};
+    {
+        libracore::MSMetaCache meta(msName, "spw=*");
+        EXPECT_FALSE(meta.valid());
+        EXPECT_TRUE(meta.save(chunks, spws));
+    }
+    {
+        libracore::MSMetaCache meta(msName, "spw=*");
+        ASSERT_TRUE(meta.valid());
+        ASSERT_EQ(meta.chunks().size(), 2u);
+        EXPECT_EQ(meta.chunks()[1].spw, 2);
+        EXPECT_EQ(meta.chunks()[1].nRows, 50);
+        EXPECT_DOUBLE_EQ(meta.chunks()[1].pa, 0.2);
+        EXPECT_DOUBLE_EQ(meta.spws().at(2).maxU, 1600.0);
+        EXPECT_DOUBLE_EQ(meta.spws().at(2).maxV, 1400.0);
+        EXPECT_DOUBLE_EQ(meta.spws().at(2).maxW, 25.0);
+
+        // Another data selection is saved alongside.
+        libracore::MSMetaCache other(msName, "spw=0");
+        EXPECT_FALSE(other.valid());
+        EXPECT_TRUE(other.save({chunks[0]}, {{0, spws[0]}}));
+        EXPECT_TRUE(libracore::MSMetaCache(msName, "spw=*").valid());
+        EXPECT_TRUE(libracore::MSMetaCache(msName, "spw=0").valid());
+    }
+    // Modifying a subtable of the MS invalidates the sidecar, but
+    // opening it (which writes the lock file) does not.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::ofstream(dir / "test.ms" / "POINTING" / "table.lock") << "lock";
+    EXPECT_TRUE(libracore::MSMetaCache(msName, "spw=*").valid());
+    std::ofstream(dir / "test.ms" / "POINTING" / "table.f0") << "more rows";
+    EXPECT_FALSE(libracore::MSMetaCache(msName, "spw=*").valid());
+
+    // So does modifying the MS.
+    EXPECT_TRUE(libracore::MSMetaCache(msName, "spw=*").save(chunks, spws));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::ofstream(dir / "test.ms" / "table.f0") << "more rows";
+    EXPECT_FALSE(libracore::MSMetaCache(msName, "spw=*").valid());
+
+    std::filesystem::remove_all(dir);
+}
+
 } // namespace test
\ No newline at end of file
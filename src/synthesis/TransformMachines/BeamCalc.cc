@@ -47,6 +47,7 @@
 #ifdef _OPENMP
 #include <omp.h>
 #endif
+#include <mutex>
 #if ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 4))
 #define GCC44x 1
 #else
@@ -58,6 +59,10 @@ using namespace std;
 using namespace casacore;
 namespace casa{
 
+  // Serializes the initialization of the singleton and of the
+  // geometries (CFs can be filled on several threads).
+  static std::mutex beamCalcMutex;
+
   std::string makeCASAPATH()
   {
     std::string casaPath;
@@ -101,6 +106,7 @@ namespace casa{
   }
 
   BeamCalc* BeamCalc::Instance(){
+    std::lock_guard<std::mutex> lock(beamCalcMutex);
     if(instance_p==0){
       instance_p = new BeamCalc();
     }
@@ -390,6 +396,7 @@ namespace casa{
 			  const MEpoch& obsTime,
 			  const String& otherAntRayPath){
 
+    std::lock_guard<std::mutex> lock(beamCalcMutex);
     setBeamCalcGeometries(obsName, antType, obsTime, otherAntRayPath);
 
     // Check against bandName if it is a non-NULL string.  Otherwise
@@ -678,18 +685,23 @@ namespace casa{
     Double dir[3] = {0.0, 0.0, 1.0};
     Double sub_h, feed_x, feed_y, feed_z, thmax, ftaper;
     char geomfile[128];//, *feedfile;
-    BeamCalcGeometry *geom;
+    BeamCalcGeometry geom_l, *geom=&geom_l;
     Int i;
     Double x, freq, df;
 
     //LogIO os;
-    if((0<=ap->band) && (ap->band<(Int)BeamCalcGeometries_p.size())){
-      geom = &(BeamCalcGeometries_p[ap->band]);
-      //os << "Using antenna parameters for " << geom->bandName << " band" << LogIO::POST;
-    }
-    else{
-      SynthesisError err(String("Internal Error: attempt to access beam geometry for non-existing band."));
-      throw(err);
+    {
+      // The geometries can be re-loaded (for another observatory or
+      // antenna type) by a thread filling other CFs, so use a copy.
+      std::lock_guard<std::mutex> lock(beamCalcMutex);
+      if((0<=ap->band) && (ap->band<(Int)BeamCalcGeometries_p.size())){
+	geom_l = BeamCalcGeometries_p[ap->band];
+	//os << "Using antenna parameters for " << geom->bandName << " band" << LogIO::POST;
+      }
+      else{
+	SynthesisError err(String("Internal Error: attempt to access beam geometry for non-existing band."));
+	throw(err);
+      }
     }
 
     sub_h = geom->sub_h;
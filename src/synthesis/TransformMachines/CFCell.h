@@ -162,6 +162,8 @@ namespace casa { //# NAMESPACE CASA - BEGIN
     }
     casacore::CountedPtr<casacore::Array<TT> >& getStorage() {return storage_p;}
     void setStorage(casacore::Array<TT>& val) {getStorage()->assign(val); cfShape_p=val.shape().asVector();};
+    // Use the storage of val, without a copy.
+    void referenceStorage(casacore::Array<TT>& val) {getStorage()->reference(val); cfShape_p=val.shape().asVector();};
     void clear();
     void makePersistent(const char *dir, const char *cfName="");
     casacore::CountedPtr<CFCell> clone();
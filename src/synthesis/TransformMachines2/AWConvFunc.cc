@@ -51,6 +51,13 @@
 //#include <casacore/casa/OS/Directory.h>
 //#include <casacore/casa/OS/Timer.h>
 #include <ostream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -199,6 +206,21 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
       cfsDone=0;
 
     ProgressMeter pm(1.0, Double(totalCFs), "fillCF", "","","",true);
+    //
+    // The CFs made for each W-plane without an A-term, and the PS
+    // term (see below).
+    //
+    struct WPlaneCF
+    {
+      Array<Complex> cf, wt;
+      Int xSupport, ySupport, xSupportWt, ySupportWt;
+      // The CFs are reused only if these too are the same.
+      Double cellSize;
+      Float sampling, samplingWt;
+    };
+    std::map<uInt, WPlaneCF> wPlaneCFs;
+    Matrix<Complex> psScreen;
+    Double psScreenSampling=0.0;
 
     for (uInt imx=0;imx<muellerElements.nelements();imx++) // Loop over all MuellerElements
       for (uInt imy=0;imy<muellerElements(imx).nelements();imy++)
@@ -290,128 +312,157 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 		    // IPosition cfBufShape=cfb.getCFCellPtr(freqValues(inu), wValues(iw),
 		    // 					  muellerElements(imx)(imy))->shape_p;
 
-		    cfWtBuf.resize(pbshp);
-		    cfBuf.resize(pbshp);
-
-		    const Vector<Double> sampling_l(2,sampling);
-		    //		    Double wval = wValues[iw];
-		    Matrix<Complex> cfBufMat(cfBuf.nonDegenerate()),
-		      cfWtBufMat(cfWtBuf.nonDegenerate());
 		    //
-		    // Apply the Prolate Spheroidal and W-Term kernels
+		    // Without an A-term, the CF of a W-plane is the same for all
+		    // the frequencies and Mueller elements.  It is then made once
+		    // per W-plane, and its pixels are shared by these CFCells.
 		    //
-
-		    Vector<Double> s(2); s=sampling;
-
-		    if (psTerm.isNoOp() || isDryRun)
-		      cfBufMat = cfWtBufMat = 1.0;
-		    else
+		    auto wPlaneCF = wPlaneCFs.find(iw);
+		    Bool reuseCF = ((wPlaneCF != wPlaneCFs.end()) &&
+				    (wPlaneCF->second.cellSize == cellSize(0)) &&
+				    (wPlaneCF->second.sampling == sampling) &&
+				    (wPlaneCF->second.samplingWt == samplingWt));
+		    Int supportBuffer = (Int)(getOversampling(psTerm, wTerm, aTerm)*2.0);
+		    if (reuseCF)
 		      {
-			//psTerm.applySky(cfBufMat, false);   // Assign (psScale set in psTerm.init()
-			//psTerm.applySky(cfWtBufMat, false); // Assign
-			psTerm.applySky(cfBufMat, s, cfBufMat.shape()(0)/s(0));   // Assign (psScale set in psTerm.init()
-			psTerm.applySky(cfWtBufMat, s, cfWtBufMat.shape()(0)/s(0)); // Assign
-
-			cfWtBuf *= cfWtBuf;
+			cfBuf.reference(wPlaneCF->second.cf);
+			cfWtBuf.reference(wPlaneCF->second.wt);
+			xSupport = wPlaneCF->second.xSupport; ySupport = wPlaneCF->second.ySupport;
+			xSupportWt = wPlaneCF->second.xSupportWt; ySupportWt = wPlaneCF->second.ySupportWt;
 		      }
+		    else
+		      {
+			cfWtBuf.resize(pbshp);
+			cfBuf.resize(pbshp);
+
+			const Vector<Double> sampling_l(2,sampling);
+			//		    Double wval = wValues[iw];
+			Matrix<Complex> cfBufMat(cfBuf.nonDegenerate()),
+			  cfWtBufMat(cfWtBuf.nonDegenerate());
+			//
+			// Apply the Prolate Spheroidal and W-Term kernels
+			//
+
+			Vector<Double> s(2); s=sampling;
+
+			if (psTerm.isNoOp() || isDryRun)
+			  cfBufMat = cfWtBufMat = 1.0;
+			else
+			  {
+			    //psTerm.applySky(cfBufMat, false);   // Assign (psScale set in psTerm.init()
+			    //psTerm.applySky(cfWtBufMat, false); // Assign
+			    // The PS term is the same for all the CFs of the
+			    // same shape and sampling.  Make it once.
+			    if ((!psScreen.shape().isEqual(cfBufMat.shape())) || (psScreenSampling != s(0)))
+			      {
+				psScreen.resize(cfBufMat.shape());
+				psScreen = Complex(0.0);
+				psTerm.applySky(psScreen, s, psScreen.shape()(0)/s(0));   // Assign (psScale set in psTerm.init()
+				psScreenSampling = s(0);
+			      }
+			    cfBufMat = psScreen;
+			    cfWtBufMat = psScreen;
 
-		    // WBAWP CODE BEGIN  -- make PS*PS for Weights
-		    // psTerm.applySky(cfWtBufMat, true);  // Multiply
-		    // WBAWP CODE END
-
-		    // psTerm.applySky(cfBufMat, s, inner/2.0);//pbshp(0)/(os));
-		    // psTerm.applySky(cfWtBufMat, s, inner/2.0);//pbshp(0)/(os));
+			    cfWtBuf *= cfWtBuf;
+			  }
 
-		    // W-term is a unit-amplitude term in the image
-		    // doimain.  No need to apply it to the
-		    // wt-functions.
+			// WBAWP CODE BEGIN  -- make PS*PS for Weights
+			// psTerm.applySky(cfWtBufMat, true);  // Multiply
+			// WBAWP CODE END
 
-		    if (!isDryRun)
-		      {
-			wTerm.applySky(cfBufMat, iw, cellSize, wScale, cfBuf.shape()(0));///4);
-		      }
+			// psTerm.applySky(cfBufMat, s, inner/2.0);//pbshp(0)/(os));
+			// psTerm.applySky(cfWtBufMat, s, inner/2.0);//pbshp(0)/(os));
 
-    		    IPosition PolnPlane(4,0,0,0,0),
-		      pbShape(4, cfBuf.shape()(0), cfBuf.shape()(1), 1, 1);
-		    //
-		    // Make TempImages and copy the buffers with PS *
-		    // WKernel applied (too bad that TempImages can't be
-		    // made with existing buffers)
-		    //
-		    //-------------------------------------------------------------
-		    TempImage<Complex> twoDPB_l(pbShape, cs_l);
-		    TempImage<Complex> twoDPBSq_l(pbShape,cs_l);
-		    //-------------------------------------------------------------
-		    cfWtBuf *= ftATerm_l.get()*conj(ftATermSq_l.get());
-
-		    cfBuf *= ftATerm_l.get();
-
-		    twoDPB_l.putSlice(cfBuf, PolnPlane);
-		    twoDPBSq_l.putSlice(cfWtBuf, PolnPlane);
-		    //tim.show("putSlice:");
-		    // WBAWP CODE BEGIN
-		    //		    twoDPB_l *= ftATerm_l;
-		    // WBAWP CODE END
-
-		    //		    twoDPBSq_l *= ftATermSq_l;//*conj(ftATerm_l);
-
-		    // To accumulate avgPB2, call this function.
-		    // PBSQWeight
-		    Bool PBSQ = false;
-		    if(PBSQ) makePBSq(twoDPBSq_l);
-		    //
-		    // Set the ref. freq. of the co-ordinate system to
-		    // that set by ATerm::applySky().
-		    //
-    		    CoordinateSystem cs=twoDPB_l.coordinates();
-    		    Int index= twoDPB_l.coordinates().findCoordinate(Coordinate::SPECTRAL);
-    		    SpectralCoordinate SpCS = twoDPB_l.coordinates().spectralCoordinate(index);
-
-    		    Double cfRefFreq=SpCS.referenceValue()(0);
-    		    Vector<Double> refValue; refValue.resize(1); refValue(0)=cfRefFreq;
-    		    SpCS.setReferenceValue(refValue);
-    		    cs.replaceCoordinate(SpCS,index);
-		    //
-		    // Now FT the function and copy the data from
-		    // TempImages back to the CFBuffer buffers
-		    //
-		    if (!isDryRun)
-		      {
-			LatticeFFT::cfft2d(twoDPB_l);
-			LatticeFFT::cfft2d(twoDPBSq_l);
-		      }
+			// W-term is a unit-amplitude term in the image
+			// doimain.  No need to apply it to the
+			// wt-functions.
 
-		    IPosition shp(twoDPB_l.shape());
-		    IPosition start(4, 0, 0, 0, 0), pbSlice(4, shp[0]-1, shp[1]-1,1/*polInUse*/, 1),
-		      sliceLength(4,cfBuf.shape()[0]-1,cfBuf.shape()[1]-1,1,1);
+			if (!isDryRun)
+			  {
+			    wTerm.applySky(cfBufMat, iw, cellSize, wScale, cfBuf.shape()(0));///4);
+			  }
 
-		    cfBuf(Slicer(start,sliceLength)).nonDegenerate()
-		      =(twoDPB_l.getSlice(start, pbSlice, true));
+			IPosition PolnPlane(4,0,0,0,0),
+			  pbShape(4, cfBuf.shape()(0), cfBuf.shape()(1), 1, 1);
+			//
+			// Make TempImages and copy the buffers with PS *
+			// WKernel applied (too bad that TempImages can't be
+			// made with existing buffers)
+			//
+			//-------------------------------------------------------------
+			TempImage<Complex> twoDPB_l(pbShape, cs_l);
+			TempImage<Complex> twoDPBSq_l(pbShape,cs_l);
+			//-------------------------------------------------------------
+			cfWtBuf *= ftATerm_l.get()*conj(ftATermSq_l.get());
+
+			cfBuf *= ftATerm_l.get();
+
+			twoDPB_l.putSlice(cfBuf, PolnPlane);
+			twoDPBSq_l.putSlice(cfWtBuf, PolnPlane);
+			//tim.show("putSlice:");
+			// WBAWP CODE BEGIN
+			//		    twoDPB_l *= ftATerm_l;
+			// WBAWP CODE END
+
+			//		    twoDPBSq_l *= ftATermSq_l;//*conj(ftATerm_l);
+
+			// To accumulate avgPB2, call this function.
+			// PBSQWeight
+			Bool PBSQ = false;
+			if(PBSQ) makePBSq(twoDPBSq_l);
+			//
+			// Set the ref. freq. of the co-ordinate system to
+			// that set by ATerm::applySky().
+			//
+			CoordinateSystem cs=twoDPB_l.coordinates();
+			Int index= twoDPB_l.coordinates().findCoordinate(Coordinate::SPECTRAL);
+			SpectralCoordinate SpCS = twoDPB_l.coordinates().spectralCoordinate(index);
+
+			Double cfRefFreq=SpCS.referenceValue()(0);
+			Vector<Double> refValue; refValue.resize(1); refValue(0)=cfRefFreq;
+			SpCS.setReferenceValue(refValue);
+			cs.replaceCoordinate(SpCS,index);
+			//
+			// Now FT the function and copy the data from
+			// TempImages back to the CFBuffer buffers
+			//
+			if (!isDryRun)
+			  {
+			    LatticeFFT::cfft2d(twoDPB_l);
+			    LatticeFFT::cfft2d(twoDPBSq_l);
+			  }
 
-		    shp = twoDPBSq_l.shape();
-		    IPosition pbSqSlice(4, shp[0]-1, shp[1]-1, 1, 1),
-		      sqSliceLength(4,cfWtBuf.shape()(0)-1,cfWtBuf.shape()[1]-1,1,1);
+			IPosition shp(twoDPB_l.shape());
+			IPosition start(4, 0, 0, 0, 0), pbSlice(4, shp[0]-1, shp[1]-1,1/*polInUse*/, 1),
+			  sliceLength(4,cfBuf.shape()[0]-1,cfBuf.shape()[1]-1,1,1);
+
+			cfBuf(Slicer(start,sliceLength)).nonDegenerate()
+			  =(twoDPB_l.getSlice(start, pbSlice, true));
+
+			shp = twoDPBSq_l.shape();
+			IPosition pbSqSlice(4, shp[0]-1, shp[1]-1, 1, 1),
+			  sqSliceLength(4,cfWtBuf.shape()(0)-1,cfWtBuf.shape()[1]-1,1,1);
+
+			cfWtBuf(Slicer(start,sqSliceLength)).nonDegenerate()
+			  =(twoDPBSq_l.getSlice(start, pbSqSlice, true));
+			//
+			// Finally, resize the buffers, limited to the
+			// support size determined by the threshold
+			// suppled by the ATerm (done internally in
+			// resizeCF()).  Transform the co-ord. system to
+			// the FT domain set the co-ord. sys. and modified
+			// support sizes.
+			//
+			if (!isDryRun)
+			  {
+			    wtcpeak = max(cfWtBuf);
+			    cfWtBuf /= wtcpeak;
+			  }
 
-		    cfWtBuf(Slicer(start,sqSliceLength)).nonDegenerate()
-		      =(twoDPBSq_l.getSlice(start, pbSqSlice, true));
-		    //
-		    // Finally, resize the buffers, limited to the
-		    // support size determined by the threshold
-		    // suppled by the ATerm (done internally in
-		    // resizeCF()).  Transform the co-ord. system to
-		    // the FT domain set the co-ord. sys. and modified
-		    // support sizes.
-		    //
-		    Int supportBuffer = (Int)(getOversampling(psTerm, wTerm, aTerm)*2.0);
-		    if (!isDryRun)
-		      {
-			wtcpeak = max(cfWtBuf);
-			cfWtBuf /= wtcpeak;
+			if (!isDryRun)
+			  AWConvFunc::resizeCF(cfWtBuf, xSupportWt, ySupportWt, supportBuffer, samplingWt,0.0);
 		      }
 
-		    if (!isDryRun)
-		      AWConvFunc::resizeCF(cfWtBuf, xSupportWt, ySupportWt, supportBuffer, samplingWt,0.0);
-
 		    Vector<Double> ftRef(2);
 
 		    ftRef(0)=cfWtBuf.shape()(0)/2.0;
@@ -439,29 +490,36 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 		    cfCellPtr->telescopeName_p = aTerm.getTelescopeName();
 		    cfCellPtr->isRotationallySymmetric_p = aTerm.isNoOp();
 
-		    if (!isDryRun)
+		    if (!reuseCF)
 		      {
-			cpeak = max(cfBuf);
-			cfBuf /= cpeak;
-		      }
+			if (!isDryRun)
+			  {
+			    cpeak = max(cfBuf);
+			    cfBuf /= cpeak;
+			  }
 
-		    if (!isDryRun)
-		      AWConvFunc::resizeCF(cfBuf, xSupport, ySupport, supportBuffer, sampling,0.0);
+			if (!isDryRun)
+			  AWConvFunc::resizeCF(cfBuf, xSupport, ySupport, supportBuffer, sampling,0.0);
 
-		    if (!isDryRun)
-		      {
-			LogIO log_l(LogOrigin("AWConvFunc2", "fillConvFuncBuffer[R&D]"));
-			log_l << "CF Support: " << xSupport << " (" << xSupportWt << ") " << "pixels" <<  LogIO::POST;
+			if (!isDryRun)
+			  {
+			    LogIO log_l(LogOrigin("AWConvFunc2", "fillConvFuncBuffer[R&D]"));
+			    log_l << "CF Support: " << xSupport << " (" << xSupportWt << ") " << "pixels" <<  LogIO::POST;
+			  }
+
+			cfNorm=cfWtNorm=1.0;
+
+			if (cfNorm != Complex(0.0)) cfBuf /= cfNorm;
+			if (cfWtNorm != Complex(0.0)) cfWtBuf /= cfWtNorm;
+
+			if (aTerm.isNoOp() && !isDryRun)
+			  wPlaneCFs[iw] = WPlaneCF{cfBuf, cfWtBuf, xSupport, ySupport, xSupportWt, ySupportWt,
+						   cellSize(0), sampling, samplingWt};
 		      }
 
 		    ftRef(0)=cfBuf.shape()(0)/2.0;
 		    ftRef(1)=cfBuf.shape()(1)/2.0;
 
-		    cfNorm=cfWtNorm=1.0;
-
-		    if (cfNorm != Complex(0.0)) cfBuf /= cfNorm;
-		    if (cfWtNorm != Complex(0.0)) cfWtBuf /= cfWtNorm;
-
 		    ftCoords=cs_l;
 		    if (isDryRun)
 		      {
@@ -1555,6 +1613,10 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
   // should) be a global function outside this class definition. It
   // calls fillConvFuncBuffer2(), another static function.
   //
+  // The CFs are filled on nThreads threads (all the cores if
+  // nThreads <= 0).  The meta information is read from the CFC
+  // before that, serially.
+  //
   void AWConvFunc::makeConvFunction2(const String& cfCachePath,
 				     const Vector<Double>&,// uvScale,
 				     const Vector<Double>& uvOffset,
@@ -1565,10 +1627,10 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 				     const Bool aTermOn,
 				     const Bool conjBeams,
 				     SynthesisUtils::ImageInformation<Complex> imInfo_cfcache,
-				     const bool makePersistent)
+				     const bool makePersistent,
+				     const Int nThreads)
   {
     LogIO log_l(LogOrigin("AWConvFunc2", "makeConvFunction2[R&D]"));
-    Int convSize, convSampling;//, polInUse;
     Array<Complex> convFunc_l, convWeights_l;
     //
     // Get the coordinate system
@@ -1577,7 +1639,6 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
     Vector<int> imShape;
     CoordinateSystem skyCoords;
     const String uvGridDiskImage=cfCachePath+"/"+"uvgrid.im";
-    Double skyMinFreq;
     Vector<Double> skyIncr;
     CountedPtr<PagedImage<Complex> > cgrid_l;
     //    ImageInformation<Complex> imInfo;
@@ -1635,19 +1696,34 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
       skyIncr = dc.increment();
     }
 
-    CountedPtr<CFBuffer> cfb_p, cfwtb_p;
-
     IPosition cfsShape = cfs2.shape();
     IPosition wCFStShape = cfwts2.shape();
 
+    //
+    // The CFs to fill, with the information needed to fill each of
+    // them independently of the others.
+    //
+    struct CFToFill
+    {
+      CountedPtr<CFBuffer> cfb, cfwtb;
+      Int iNu, iW, iPol;
+      CFCStruct miscInfo;
+      Double skyMinFreq;
+      Int convSampling;
+      bool aTermOn, psTermOn, wTermOn, conjBeams;
+    };
+    std::vector<CFToFill> cfsToFill;
+    //
+    // Collect the list of CFs to fill.  Everything that reads the
+    // CFC from the disk, or uses shared objects (BeamCalc), is done
+    // here, serially.
+    //
     //Matrix<Int> uniqueBaselineTypeList=makeBaselineList(aTerm_p->getAntTypeList());
-    Bool wbAWP, wTermOn;
     for (int iPA=0; iPA<cfsShape[0]; iPA++)
       for (int iB=0; iB<cfsShape[1]; iB++)
 	  {
-	    log_l << "Filling CFs for baseline type " << iB << ", PA slot " << iPA << LogIO::WARN << LogIO::POST;
-	    cfb_p=cfs2.getCFBuffer(iPA,iB);
-	    cfwtb_p=cfwts2.getCFBuffer(iPA,iB);
+	    CountedPtr<CFBuffer> cfb_p=cfs2.getCFBuffer(iPA,iB);
+	    CountedPtr<CFBuffer> cfwtb_p=cfwts2.getCFBuffer(iPA,iB);
 
 	    cfb_p->primeTheCache();
 	    cfwtb_p->primeTheCache();
@@ -1659,8 +1735,6 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 		  for (int iW=0; iW<cfbShape(1); iW++)   // W axis
 		    {
 		      CFCStruct miscInfo;
-		      CoordinateSystem cs_l;
-		      Float sampling;
 
 		      CountedPtr<CFCell>& currentCFCell_ptr=(*cfb_p).getCFCellPtr(iNu, iW, iPol);
 		      // tt->show("",cout);
@@ -1670,14 +1744,13 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 			{
 			  currentCFCell_ptr->getAsStruct(miscInfo); // Get misc. info. for this CFCell
 
-			  int xSupport=miscInfo.xSupport;
-			  int ySupport=miscInfo.ySupport;
-
 			  if (miscInfo.shape[0] == miscInfo.xSupport*2*miscInfo.sampling + 4*miscInfo.sampling+1)
 			    break;
-			  wbAWP=True; // Always true since the Freq. value is got from the coord. sys.
-			  wTermOn=(miscInfo.wValue > 0.0);
 
+			  CFToFill cf;
+			  cf.cfb=cfb_p; cf.cfwtb=cfwtb_p;
+			  cf.iNu=iNu; cf.iW=iW; cf.iPol=iPol;
+			  cf.miscInfo=miscInfo;
 			  {
 			    //This code uses the BeamCalc class to get
 			    //the nominal min. freq. of the band in
@@ -1687,18 +1760,19 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 			    try
 			      {
 				Int bandID = BeamCalc::Instance()->getBandID(miscInfo.freqValue,miscInfo.telescopeName,miscInfo.bandName);
-				skyMinFreq = casa::EVLABandMinFreqDefaults[bandID];
+				cf.skyMinFreq = casa::EVLABandMinFreqDefaults[bandID];
 			      }
 			    catch(AipsError &e)
 			      {
 				log_l << "Determining the minimum frequency from sky image." << LogIO::POST;
 				Int index= skyCoords.findCoordinate(Coordinate::SPECTRAL);
 				SpectralCoordinate SpCS = skyCoords.spectralCoordinate(index);
-				skyMinFreq=SpCS.referenceValue()(0);
+				cf.skyMinFreq=SpCS.referenceValue()(0);
 			      }
 			  }
 
-			  bool aTermOn_l=aTermOn, psTermOn_l=psTermOn, wTermOn_l=wTermOn, conjBeams_l=conjBeams;
+			  cf.aTermOn=aTermOn; cf.psTermOn=psTermOn; cf.conjBeams=conjBeams;
+			  cf.wTermOn=(miscInfo.wValue > 0.0);
 			  {
 			    // Read the miscinfo for the currect CFCell.
 			    SynthesisUtils::ImageInformation<Complex> imInfo_cfcell(cfCachePath+"/"+currentCFCell_ptr->fileName_p);
@@ -1709,113 +1783,162 @@ AWConvFunc::AWConvFunc(const casacore::CountedPtr<ATerm> aTerm,
 			    // So, if the parameters are defined in the CFCell's miscInfo.rec, use them.
 			    // Else use the values supplied as parameters to this method.
 			    //
-			    if (miscInfoRec.isDefined("aTermOn"))  miscInfoRec.get("aTermOn",  aTermOn_l);
-			    if (miscInfoRec.isDefined("psTermOn")) miscInfoRec.get("psTermOn", psTermOn_l);
-			    if (miscInfoRec.isDefined("wTermOn"))  miscInfoRec.get("wTermOn",  wTermOn_l);
-			    if (miscInfoRec.isDefined("conjBeams"))  miscInfoRec.get("conjBeams",  conjBeams_l);
+			    if (miscInfoRec.isDefined("aTermOn"))  miscInfoRec.get("aTermOn",  cf.aTermOn);
+			    if (miscInfoRec.isDefined("psTermOn")) miscInfoRec.get("psTermOn", cf.psTermOn);
+			    if (miscInfoRec.isDefined("wTermOn"))  miscInfoRec.get("wTermOn",  cf.wTermOn);
+			    if (miscInfoRec.isDefined("conjBeams"))  miscInfoRec.get("conjBeams",  cf.conjBeams);
 			    float s;
 			    miscInfoRec.get("Sampling",s);
-			    convSampling = s;
+			    cf.convSampling = s;
 			  }
-			  CountedPtr<ConvolutionFunction> awCF =
-			    AWProjectFT::makeCFObject(miscInfo.telescopeName,
-						      aTermOn_l, psTermOn_l, wTermOn_l,true,
-						      wbAWP, conjBeams_l, xSupport, convSampling);
-			  if (aTermOn_l==false)
-			    {
-			      (static_cast<AWConvFunc &>(*awCF)).aTerm_p->setOpCode(CFTerms::NOOP);
-			      (static_cast<AWConvFunc &>(*awCF)).aTerm_p->cacheVBInfo(miscInfo.telescopeName, miscInfo.diameter);
-			    }
-			  if (psTermOn_l==false) (static_cast<AWConvFunc &>(*awCF)).psTerm_p->setOpCode(CFTerms::NOOP);
-			  if (wTermOn_l==false) (static_cast<AWConvFunc &>(*awCF)).wTerm_p->setOpCode(CFTerms::NOOP);
-
-			  //aTerm_p->cacheVBInfo(miscInfo.telescopeName, miscInfo.diameter);
-
-			  String bandName;
-			  cfb_p->getParams(cs_l, sampling, xSupport, ySupport,bandName,iNu,iW,iPol);
-			  //convSampling=miscInfo.sampling;
-
-			  //convSize=miscInfo.shape[0];
-			  // This method loads "empty CFs".  Those have
-			  // support size equal to the CONVBUF size
-			  // required.  So use that, instead of the
-			  // "shape" information from CFs, since the
-			  // latter for empty CFs can be small (to save
-			  // disk space and i/o -- the CFs are supposed
-			  // to be empty anyway at this stage!)
-			  convSize=xSupport;
-
-			  IPosition start(4, 0, 0, 0, 0);
-			  IPosition pbSlice(4, convSize, convSize, 1, 1);
-			  {
-			    // Set up the anti-aliasing operator (psTerm_p) for this CF.
-			    Int inner=convSize/(convSampling);
-
-			    //Float psScale = (2*coords.increment()(0))/(nx*image.coordinates().increment()(0));
-			    Float innerQuaterFraction=1.0;
-			    innerQuaterFraction=refim::SynthesisUtils::getenv("AWCF.FUDGE",innerQuaterFraction);
-
-			    Double lambdaByD = innerQuaterFraction*1.22*C::c/skyMinFreq/miscInfo.diameter;
-			    Double FoV_x = fabs(skyNX*skyIncr(0));
-			    Double FoV_y = fabs(skyNY*skyIncr(1));
-			    Vector<Double> uvScale_l(3);
-			    uvScale_l(0) = (FoV_x < lambdaByD) ? FoV_x : lambdaByD;
-			    uvScale_l(1) = (FoV_y < lambdaByD) ? FoV_y : lambdaByD;
-			    uvScale_l(2) = 0.0;
-
-			    Float psScale = 2.0/(innerQuaterFraction*convSize/convSampling);// nx*image.coordinates().increment()(0)*convSampling/2;
-			    ((static_cast<AWConvFunc &>(*awCF)).psTerm_p)->init(IPosition(2,inner,inner), uvScale_l, uvOffset,psScale);
-			  }
-			  //
-			  // By this point, the all the 4 axis (Time/PA, Freq, Pol,
-			  // Baseline) of the CFBuffer objects have been setup.  The CFs
-			  // will now be filled using the supplied PS-, W- ad A-term objects.
-			  //
-			  try
-			    {
-			      // A note for future cleanup: The cfb_p,
-			      // cfwtb_p and convSize information now
-			      // should not be required since those are
-			      // in miscInfo. Any information is
-			      // currently derived from CFBs should be
-			      // made available via miscInfo.  This
-			      // will also make this call more CASACore
-			      // agnostic (and some day exposed for
-			      // direct use).
-			      AWConvFunc::fillConvFuncBuffer2(*cfb_p, *cfwtb_p, convSize, convSize,
-							      NULL,
-							      miscInfo,
-							      *((static_cast<AWConvFunc &>(*awCF)).psTerm_p),
-							      *((static_cast<AWConvFunc &>(*awCF)).wTerm_p),
-							      *((static_cast<AWConvFunc &>(*awCF)).aTerm_p),
-							      conjBeams_l, imInfo_cfcache);
-			    }
-			  catch (CFSupportZero& e)
-			    {
-			      LogIO log_l(LogOrigin("AWConvFunc", "makeConvFunction2"));
-			      log_l << e.what() << LogIO::POST
-				    << "We are assuming that the CF (\"" << currentCFCell_ptr->fileName_p <<"\") is already filled"
-				    << LogIO::POST;
-			    }
-			  // Mark this CFCell as filled.  The decision
-			  // to trigger filling of the CF and WTCF
-			  // earlier is based on checking isFilled_p
-			  // only for CF, but since
-			  // fillConvFuncBuffer2() fills both CF and
-			  // WTCF, mark the latter as filled also.
-			  currentCFCell_ptr->isFilled_p=true;
-			  ((*cfwtb_p).getCFCellPtr(iNu, iW, iPol))->isFilled_p  = true;
-			  ((*cfwtb_p).getCFCellPtr(iNu, iW, iPol))->conjBeams_p = conjBeams_l;
-			  ((*cfwtb_p).getCFCellPtr(iNu, iW, iPol))->aTermOn_p   = aTermOn_l;
-			  ((*cfwtb_p).getCFCellPtr(iNu, iW, iPol))->psTermOn_p  = psTermOn_l;
-			  ((*cfwtb_p).getCFCellPtr(iNu, iW, iPol))->wTermOn_p   = wTermOn_l;
-
-			  //cfb_p->show(NULL,cerr);
+			  cfsToFill.push_back(cf);
 			}
 		    } // End of loop over W terms
 	      } // End of loop over frequencies
 	  } // End of loop over baselines
 
+    //
+    // Fill one CF (and its WTCF).  Each call uses its own
+    // ConvolutionFunction object and touches only its own CFCells,
+    // so that the CFs can be filled in parallel.
+    //
+    auto fillCF = [&](CFToFill& cf)
+      {
+	Bool wbAWP=True; // Always true since the Freq. value is got from the coord. sys.
+	int xSupport=cf.miscInfo.xSupport;
+	int ySupport=cf.miscInfo.ySupport;
+	Int convSize;
+	CoordinateSystem cs_l;
+	Float sampling;
+
+	CountedPtr<ConvolutionFunction> awCF =
+	  AWProjectFT::makeCFObject(cf.miscInfo.telescopeName,
+				    cf.aTermOn, cf.psTermOn, cf.wTermOn,true,
+				    wbAWP, cf.conjBeams, xSupport, cf.convSampling);
+	AWConvFunc& awcf_l = static_cast<AWConvFunc &>(*awCF);
+	if (cf.aTermOn==false)
+	  {
+	    awcf_l.aTerm_p->setOpCode(CFTerms::NOOP);
+	    awcf_l.aTerm_p->cacheVBInfo(cf.miscInfo.telescopeName, cf.miscInfo.diameter);
+	  }
+	if (cf.psTermOn==false) awcf_l.psTerm_p->setOpCode(CFTerms::NOOP);
+	if (cf.wTermOn==false) awcf_l.wTerm_p->setOpCode(CFTerms::NOOP);
+
+	String bandName;
+	cf.cfb->getParams(cs_l, sampling, xSupport, ySupport,bandName,cf.iNu,cf.iW,cf.iPol);
+	// This method loads "empty CFs".  Those have
+	// support size equal to the CONVBUF size
+	// required.  So use that, instead of the
+	// "shape" information from CFs, since the
+	// latter for empty CFs can be small (to save
+	// disk space and i/o -- the CFs are supposed
+	// to be empty anyway at this stage!)
+	convSize=xSupport;
+	{
+	  // Set up the anti-aliasing operator (psTerm_p) for this CF.
+	  Int inner=convSize/(cf.convSampling);
+
+	  Float innerQuaterFraction=1.0;
+	  innerQuaterFraction=refim::SynthesisUtils::getenv("AWCF.FUDGE",innerQuaterFraction);
+
+	  Double lambdaByD = innerQuaterFraction*1.22*C::c/cf.skyMinFreq/cf.miscInfo.diameter;
+	  Double FoV_x = fabs(skyNX*skyIncr(0));
+	  Double FoV_y = fabs(skyNY*skyIncr(1));
+	  Vector<Double> uvScale_l(3);
+	  uvScale_l(0) = (FoV_x < lambdaByD) ? FoV_x : lambdaByD;
+	  uvScale_l(1) = (FoV_y < lambdaByD) ? FoV_y : lambdaByD;
+	  uvScale_l(2) = 0.0;
+
+	  Float psScale = 2.0/(innerQuaterFraction*convSize/cf.convSampling);
+	  awcf_l.psTerm_p->init(IPosition(2,inner,inner), uvScale_l, uvOffset,psScale);
+	}
+	//
+	// By this point, the all the 4 axis (Time/PA, Freq, Pol,
+	// Baseline) of the CFBuffer objects have been setup.  The CFs
+	// will now be filled using the supplied PS-, W- ad A-term objects.
+	//
+	try
+	  {
+	    // A note for future cleanup: The cfb_p,
+	    // cfwtb_p and convSize information now
+	    // should not be required since those are
+	    // in miscInfo. Any information is
+	    // currently derived from CFBs should be
+	    // made available via miscInfo.  This
+	    // will also make this call more CASACore
+	    // agnostic (and some day exposed for
+	    // direct use).
+	    AWConvFunc::fillConvFuncBuffer2(*cf.cfb, *cf.cfwtb, convSize, convSize,
+					    NULL,
+					    cf.miscInfo,
+					    *(awcf_l.psTerm_p), *(awcf_l.wTerm_p), *(awcf_l.aTerm_p),
+					    cf.conjBeams, imInfo_cfcache);
+	  }
+	catch (CFSupportZero& e)
+	  {
+	    LogIO log_l(LogOrigin("AWConvFunc", "makeConvFunction2"));
+	    log_l << e.what() << LogIO::POST
+		  << "We are assuming that the CF (\"" << cf.cfb->getCFCellPtr(cf.iNu, cf.iW, cf.iPol)->fileName_p
+		  <<"\") is already filled"
+		  << LogIO::POST;
+	  }
+	// Mark this CFCell as filled.  The decision
+	// to trigger filling of the CF and WTCF
+	// earlier is based on checking isFilled_p
+	// only for CF, but since
+	// fillConvFuncBuffer2() fills both CF and
+	// WTCF, mark the latter as filled also.
+	cf.cfb->getCFCellPtr(cf.iNu, cf.iW, cf.iPol)->isFilled_p=true;
+	CountedPtr<CFCell>& wtCell=cf.cfwtb->getCFCellPtr(cf.iNu, cf.iW, cf.iPol);
+	wtCell->isFilled_p  = true;
+	wtCell->conjBeams_p = cf.conjBeams;
+	wtCell->aTermOn_p   = cf.aTermOn;
+	wtCell->psTermOn_p  = cf.psTermOn;
+	wtCell->wTermOn_p   = cf.wTermOn;
+      };
+
+    //
+    // Fill the CFs on nThreads threads (nThreads <= 0 uses all the
+    // cores).  Each thread picks the next CF in the list when done
+    // with the previous one, since the cost of a CF varies a lot
+    // with its size.
+    //
+    unsigned nWorkers = (nThreads > 0) ? nThreads : std::max(std::thread::hardware_concurrency(), 1u);
+    nWorkers = std::min<size_t>(nWorkers, cfsToFill.size());
+    log_l << "Filling " << cfsToFill.size() << " CFs"
+	  << ((nWorkers > 1) ? " using "+String::toString(nWorkers)+" threads" : "")
+	  << LogIO::POST;
+
+    if (nWorkers <= 1)
+      for (auto& cf : cfsToFill) fillCF(cf);
+    else
+      {
+	std::atomic<size_t> next(0);
+	std::exception_ptr excpt=nullptr;
+	std::mutex excptMutex;
+	auto worker = [&]()
+	  {
+	    for (size_t i=next++; i<cfsToFill.size(); i=next++)
+	      {
+		try
+		  {
+		    fillCF(cfsToFill[i]);
+		  }
+		catch (...)
+		  {
+		    // Keep the first exception, and stop all threads.
+		    std::lock_guard<std::mutex> lock(excptMutex);
+		    if (excpt == nullptr) excpt = std::current_exception();
+		    next = cfsToFill.size();
+		  }
+	      }
+	  };
+	std::vector<std::thread> workers;
+	for (unsigned t=0; t<nWorkers; t++) workers.emplace_back(worker);
+	for (auto& t : workers) t.join();
+	if (excpt != nullptr) std::rethrow_exception(excpt);
+      }
+
     //
     // Make the CFStores persistent.
     //
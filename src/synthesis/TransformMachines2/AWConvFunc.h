@@ -104,7 +104,8 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 				  const casacore::Bool aTermOn,
 				  const casacore::Bool conjBeams,
 				  SynthesisUtils::ImageInformation<Complex> ImInfo=SynthesisUtils::ImageInformation<Complex>(),
-				  const casacore::Bool makePersistent=true);
+				  const casacore::Bool makePersistent=true,
+				  const casacore::Int nThreads=1);
     static void fillConvFuncBuffer2(CFBuffer& cfb, CFBuffer& cfWtb,
 				    const casacore::Int& nx, const casacore::Int& ny,
 				    const casacore::ImageInterface<casacore::Complex>* skyImage,
@@ -0,0 +1,164 @@
+// -*- C++ -*-
+//# AWGridKernels.cc: Row kernels for the AW-projection CPU (de-)gridder
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning AIPS++ should be addressed as follows:
+//#        Internet email: aips2-request@nrao.edu.
+//#        Postal address: AIPS++ Project Office
+//#                        National Radio Astronomy Observatory
+//#                        520 Edgemont Road
+//#                        Charlottesville, VA 22903-2475 USA
+//#
+//# $Id$
+
+#include <synthesis/TransformMachines2/AWGridKernels.h>
+#include <cstddef>
+
+//
+// With GCC on x86-64, each kernel is compiled for AVX-512, AVX2 and
+// the baseline ISA.  The dynamic loader picks the version for the CPU
+// (via an ifunc resolver) the first time a kernel is called.
+// Elsewhere, there is a single (portable) version.
+//
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__ELF__)
+#define AWGRIDKERNELS_TARGETS __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define AWGRIDKERNELS_TARGETS
+#endif
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    namespace
+    {
+      //
+      // The kernel bodies.  These are inlined into each of the
+      // target-specific versions below.
+      //
+      template <class G>
+      inline __attribute__((always_inline))
+      void gridRowImpl(std::complex<G>* __restrict__ grid,
+		       const std::complex<float>* __restrict__ cfRow, const int* __restrict__ cfOff,
+		       const std::complex<float>* __restrict__ pgRow, const int* __restrict__ pgOff,
+		       const int n, const bool conjCF,
+		       const std::complex<float>& nvalue,
+		       std::complex<double>& norm)
+      {
+	G* __restrict__ g = reinterpret_cast<G*>(grid);
+	const float* __restrict__ cf = reinterpret_cast<const float*>(cfRow);
+	const float vr=nvalue.real(), vi=nvalue.imag();
+	const float s = conjCF ? -1.0f : 1.0f;
+	double nr=0.0, ni=0.0;
+
+	if (pgRow == NULL)
+	  {
+#pragma omp simd reduction(+:nr,ni)
+	    for (int j=0; j<n; j++)
+	      {
+		const float wr=cf[2*cfOff[j]], wi=s*cf[2*cfOff[j]+1];
+		nr += wr; ni += wi;
+		g[2*j]   += vr*wr - vi*wi;
+		g[2*j+1] += vr*wi + vi*wr;
+	      }
+	  }
+	else
+	  {
+	    const float* __restrict__ pg = reinterpret_cast<const float*>(pgRow);
+#pragma omp simd reduction(+:nr,ni)
+	    for (int j=0; j<n; j++)
+	      {
+		const float cr=cf[2*cfOff[j]], ci=s*cf[2*cfOff[j]+1];
+		nr += cr; ni += ci;
+		const float pr=pg[2*pgOff[j]], pi=pg[2*pgOff[j]+1];
+		const float wr=cr*pr - ci*pi, wi=cr*pi + ci*pr;
+		g[2*j]   += vr*wr - vi*wi;
+		g[2*j+1] += vr*wi + vi*wr;
+	      }
+	  }
+	norm += std::complex<double>(nr,ni);
+      }
+
+      inline __attribute__((always_inline))
+      std::complex<float> degridRowImpl(const std::complex<float>* __restrict__ grid,
+					const std::complex<float>* __restrict__ cfRow, const int* __restrict__ cfOff,
+					const std::complex<float>* __restrict__ pgRow, const int* __restrict__ pgOff,
+					const int n, const bool conjCF,
+					std::complex<float>& norm)
+      {
+	const float* __restrict__ g = reinterpret_cast<const float*>(grid);
+	const float* __restrict__ cf = reinterpret_cast<const float*>(cfRow);
+	const float s = conjCF ? -1.0f : 1.0f;
+	float sr=0.0, si=0.0, nr=0.0, ni=0.0;
+
+	if (pgRow == NULL)
+	  {
+#pragma omp simd reduction(+:sr,si,nr,ni)
+	    for (int j=0; j<n; j++)
+	      {
+		const float wr=cf[2*cfOff[j]], wi=s*cf[2*cfOff[j]+1];
+		nr += wr; ni += wi;
+		sr += wr*g[2*j]   - wi*g[2*j+1];
+		si += wr*g[2*j+1] + wi*g[2*j];
+	      }
+	  }
+	else
+	  {
+	    const float* __restrict__ pg = reinterpret_cast<const float*>(pgRow);
+#pragma omp simd reduction(+:sr,si,nr,ni)
+	    for (int j=0; j<n; j++)
+	      {
+		const float cr=cf[2*cfOff[j]], ci=s*cf[2*cfOff[j]+1];
+		nr += cr; ni += ci;
+		// wt = cf * conj(phase gradient)
+		const float pr=pg[2*pgOff[j]], pi=pg[2*pgOff[j]+1];
+		const float wr=cr*pr + ci*pi, wi=ci*pr - cr*pi;
+		sr += wr*g[2*j]   - wi*g[2*j+1];
+		si += wr*g[2*j+1] + wi*g[2*j];
+	      }
+	  }
+	norm += std::complex<float>(nr,ni);
+	return std::complex<float>(sr,si);
+      }
+    };
+
+    AWGRIDKERNELS_TARGETS
+    void AWGridKernels::gridRow(std::complex<double>* grid,
+				const std::complex<float>* cfRow, const int* cfOff,
+				const std::complex<float>* pgRow, const int* pgOff,
+				const int n, const bool conjCF,
+				const std::complex<float>& nvalue,
+				std::complex<double>& norm)
+    {gridRowImpl(grid, cfRow, cfOff, pgRow, pgOff, n, conjCF, nvalue, norm);}
+
+    AWGRIDKERNELS_TARGETS
+    void AWGridKernels::gridRow(std::complex<float>* grid,
+				const std::complex<float>* cfRow, const int* cfOff,
+				const std::complex<float>* pgRow, const int* pgOff,
+				const int n, const bool conjCF,
+				const std::complex<float>& nvalue,
+				std::complex<double>& norm)
+    {gridRowImpl(grid, cfRow, cfOff, pgRow, pgOff, n, conjCF, nvalue, norm);}
+
+    AWGRIDKERNELS_TARGETS
+    std::complex<float> AWGridKernels::degridRow(const std::complex<float>* grid,
+						 const std::complex<float>* cfRow, const int* cfOff,
+						 const std::complex<float>* pgRow, const int* pgOff,
+						 const int n, const bool conjCF,
+						 std::complex<float>& norm)
+    {return degridRowImpl(grid, cfRow, cfOff, pgRow, pgOff, n, conjCF, norm);}
+  };
+};
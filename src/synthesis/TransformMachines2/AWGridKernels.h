@@ -0,0 +1,83 @@
+// -*- C++ -*-
+//# AWGridKernels.h: Row kernels for the AW-projection CPU (de-)gridder
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning AIPS++ should be addressed as follows:
+//#        Internet email: aips2-request@nrao.edu.
+//#        Postal address: AIPS++ Project Office
+//#                        National Radio Astronomy Observatory
+//#                        520 Edgemont Road
+//#                        Charlottesville, VA 22903-2475 USA
+//#
+//# $Id$
+
+#ifndef SYNTHESIS_TRANSFORM2_AWGRIDKERNELS_H
+#define SYNTHESIS_TRANSFORM2_AWGRIDKERNELS_H
+
+#include <complex>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // The innermost loops of AWVisResampler, for one row (fixed CF
+    // y-pixel) of the convolution function.  The grid pixels of a row
+    // are contiguous and the CF pixels are at the pre-computed
+    // offsets cfOff[0..n-1] from cfRow (the oversampled CF is read
+    // with a stride of the sampling).  The phase gradient, if pgRow
+    // is not NULL, is read at pgOff[0..n-1] from pgRow.
+    //
+    // The loops are written on the real and imaginary parts so that
+    // the compiler vectorizes them.  On x86-64 with GCC, AVX-512,
+    // AVX2 and baseline versions are compiled and the one to use is
+    // selected at run time for the CPU (see AWGridKernels.cc).
+    //
+    namespace AWGridKernels
+    {
+      //
+      // grid[j] += nvalue*wt[j], j=0..n-1, where wt is the CF
+      // (conjugated if conjCF), multiplied by the phase gradient.
+      // norm accumulates the sum of the CF values (before the phase
+      // gradient).
+      //
+      void gridRow(std::complex<double>* grid,
+		   const std::complex<float>* cfRow, const int* cfOff,
+		   const std::complex<float>* pgRow, const int* pgOff,
+		   const int n, const bool conjCF,
+		   const std::complex<float>& nvalue,
+		   std::complex<double>& norm);
+      void gridRow(std::complex<float>* grid,
+		   const std::complex<float>* cfRow, const int* cfOff,
+		   const std::complex<float>* pgRow, const int* pgOff,
+		   const int n, const bool conjCF,
+		   const std::complex<float>& nvalue,
+		   std::complex<double>& norm);
+      //
+      // Returns sum_j wt[j]*grid[j], j=0..n-1, where wt is the CF
+      // (conjugated if conjCF), multiplied by the conjugate of the
+      // phase gradient.  norm accumulates the sum of the CF values
+      // (before the phase gradient).
+      //
+      std::complex<float> degridRow(const std::complex<float>* grid,
+				    const std::complex<float>* cfRow, const int* cfOff,
+				    const std::complex<float>* pgRow, const int* pgOff,
+				    const int n, const bool conjCF,
+				    std::complex<float>& norm);
+    };
+  };
+};
+#endif
@@ -1317,7 +1317,7 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 	// If dry run, write the uvgrid as an image for later use in
 	// filling the empty CFCache.  Only the co-ordinate system of
 	// the uvgrid is required later.
-	if (dryRun())
+	if (dryRun() && !cfCache_p->isInMemory())
 	  {
 	    // PagedImage<Complex> thisGrid(lattice->shape(),image.coordinates(), 
 	    // 				 cfCache_p->getCacheDir()+"/uvgrid.im");
@@ -1331,8 +1331,12 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 	// Save only the CF Cube for the current value of PA (not the
 	// entire CFStore -- CFs for PA values encountered earlier
 	// than current value have already need made persistent).
-	cfs2_p->makePersistent(cfCache_p->getCacheDir().c_str(),"","",    Quantity(pa,"rad"),dPAQuant,0,0);
-	cfwts2_p->makePersistent(cfCache_p->getCacheDir().c_str(),"","WT",Quantity(pa,"rad"),dPAQuant,0,0);
+	// CFs computed on the fly are never written to the disk.
+	if (!cfCache_p->isInMemory())
+	  {
+	    cfs2_p->makePersistent(cfCache_p->getCacheDir().c_str(),"","",    Quantity(pa,"rad"),dPAQuant,0,0);
+	    cfwts2_p->makePersistent(cfCache_p->getCacheDir().c_str(),"","WT",Quantity(pa,"rad"),dPAQuant,0,0);
+	  }
 	Double memUsed=cfs2_p->memUsage();
 	String unit(" KB");
 	memUsed = (Int)(memUsed/1024.0+0.5);
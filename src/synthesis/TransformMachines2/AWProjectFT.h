@@ -435,6 +435,13 @@ namespace casa { //# NAMESPACE CASA - BEGIN
     // Image Scaling and offset
     casacore::Vector<casacore::Double> uvScale, uvOffset;
     CountedPtr<CFBuffer> getCFB(const int irow) {return (*vb2CFBMap_p)[irow];}
+    //
+    // Make (or locate) the CFs for the data in vb, without
+    // (de-)gridding it.  Used when the CFs are computed on the fly
+    // and are needed before the first (de-)gridding call.
+    //
+    void prepConvFunction(const casacore::ImageInterface<casacore::Complex>& image,
+			  const vi::VisBuffer2& vb) {findConvFunction(image, vb);}
   protected:
     
     casacore::Int nint(casacore::Double val) {return casacore::Int(floor(val+0.5));};
@@ -28,16 +28,24 @@
 
 #include <synthesis/TransformMachines/SynthesisError.h>
 #include <synthesis/TransformMachines2/AWVisResampler.h>
+#include <synthesis/TransformMachines2/AWGridKernels.h>
 #include <synthesis/TransformMachines2/Utils.h>
+#include <synthesis/TransformMachines2/CFResidency.h>
+#include <synthesis/TransformMachines2/CFRotationCache.h>
 #include <synthesis/TransformMachines/SynthesisMath.h>
 #include <casacore/coordinates/Coordinates/SpectralCoordinate.h>
 #include <casacore/coordinates/Coordinates/CoordinateSystem.h>
 #include <casacore/casa/OS/Timer.h>
+#include <casacore/casa/Arrays/ArrayMath.h>
 #include <fstream>
 #include <iostream>
 #include <typeinfo>
 #include <iomanip>
 #include <cfenv>
+#include <exception>
+#include <map>
+#include <tuple>
+#include <vector>
 #include <synthesis/TransformMachines2/FortranizedLoops.h>
 //#include <synthesis/TransformMachines2/hpg.hpp>
 
@@ -129,7 +137,8 @@ namespace casa{
       }
     //pndx=1;
     //    cerr << "CFC indexes(w,f,p),ipol: " << wndx << " " << fndx << " " << pndx << " " << ipol << endl;
-    cfcell=&(*(cfb->getCFCellPtr(fndx,wndx,pndx)));
+    CountedPtr<CFCell>& cfcellPtr=cfb->getCFCellPtr(fndx,wndx,pndx);
+    cfcell=&(*cfcellPtr);
 
     //cerr << "CF Name: " << cfcell->fileName_p << endl;
 
@@ -141,23 +150,29 @@ namespace casa{
     if (convFuncV == NULL)
       throw(SynthesisFTMachineError("cfcell->getStorage() == null"));
 
-    // Load the CF if it not already loaded.  If a new CF is loaded,
-    // check if it needs to be rotated.
+    // Load the CF if it not already loaded.
     if (convFuncV->shape().product() == 0)
       {
 	Array<Complex>  tt=SynthesisUtils::getCFPixels(cfb->getCFCacheDir(), cfcell->fileName_p);
-	cfcell->setStorage(tt);
+	cfcell->referenceStorage(tt);
+	// Keep the lazily loaded CFs within the memory budget.  This
+	// may release other CFs (not those used since the last
+	// newEpoch()).
+	CFResidency::instance().admit(cfcellPtr, cfcell->pa_p);
+	convFuncV = &(*cfcell->getStorage());
+      }
+    else
+      CFResidency::instance().touch(cfcellPtr);
 
-	//cerr << (cfcell->isRotationallySymmetric_p?"o":"+");
+    //cerr << (cfcell->isRotationallySymmetric_p?"o":"+");
 
-	// No rotation necessary if the CF is rotationally symmetric
-	if (!(cfcell->isRotationallySymmetric_p))
-	  {
-	    CFCell *baseCFC=NULL;
-	    // Rotate only if the difference between CF PA and VB PA
-	    // is greater than paTolerance.
-	    SynthesisUtils::rotate2(vbPA, *baseCFC, *cfcell, paTolerance_p);
-	  }
+    // No rotation necessary if the CF is rotationally symmetric.
+    // Otherwise rotate it if the difference between CF PA and VB PA
+    // is greater than paTolerance (the CFs rotated for each PA bin
+    // are cached).
+    if (!(cfcell->isRotationallySymmetric_p))
+      {
+	CFRotationCache::instance().rotate(vbPA, cfcellPtr, paTolerance_p);
 	convFuncV = &(*cfcell->getStorage());
       }
 
@@ -226,49 +241,295 @@ namespace casa{
       }
   }
 
+  //
+  //-----------------------------------------------------------------------------------
+  //
+  Int AWVisResampler::nWorkerThreads_p(const Int& nWork)
+  {
+    Int nth=1;
+#ifdef _OPENMP
+    if (nThreads_p > 0) nth=min(nThreads_p, omp_get_max_threads());
+    else                nth=omp_get_max_threads();
+#endif
+    return max(1,min(nth, nWork));
+  }
+  //
+  //-----------------------------------------------------------------------------------
+  // Build the per-VisBuffer gridding plan (see AWGridPlan).
+  //
+  void AWVisResampler::makeGridPlan_p(AWGridPlan& plan, VBStore& vbs,
+				      const IPosition& gridShape,
+				      const Matrix<Double>& wUVW,
+				      const Int& startChan, const Int& endChan,
+				      const Bool& conjFreq, const Bool& useImgWts,
+				      const Bool& degrid)
+  {
+    Int rbeg = vbs.beginRow_p, rend = vbs.endRow_p;
+    Int nDataPol  = vbs.flagCube_p.shape()[0];
+    Int nDataChan = vbs.flagCube_p.shape()[1];
+    Int nGridPol = gridShape[2], nGridChan = gridShape[3];
+
+    Bool Dummy;
+    const Double *freq=vbs.freq_p.getStorage(Dummy);
+    const Bool *rowFlag_ptr = vbs.rowFlag_p.getStorage(Dummy);
+    const Bool *flagCube_ptr = vbs.flagCube_p.getStorage(Dummy);
+    const Float *imgWts_ptr = vbs.imagingWeight_p.getStorage(Dummy);
+
+    Int vbSpw = (vbs.vb_p)->spectralWindows()(0);
+    Double vbPA = vbs.paQuant_p.getValue("rad");
+
+    // The plan holds pointers to the CF pixels.  Keep the CFs used
+    // from here on resident till the next plan is made.
+    CFResidency::instance().newEpoch();
+
+    Vector<Double> wVals, fVals; PolMapType mVals, mNdx, conjMVals, conjMNdx;
+    Double fIncr, wIncr;
+    (*vb2CFBMap_p)[0]->getCoordList(fVals,wVals,mNdx, mVals, conjMNdx, conjMVals, fIncr, wIncr);
+    // The de-gridder uses the Mueller index maps in the reverse order
+    // compared to the gridder.
+    PolMapType& mNdx0 = degrid ? conjMNdx : mNdx;
+    PolMapType& mNdx1 = degrid ? mNdx : conjMNdx;
+
+    plan.beginRow = rbeg;
+    plan.nDataChan = nDataChan;
+    plan.nW = wVals.nelements();
+    plan.sampleBucket.assign(max(0,rend-rbeg)*nDataChan, -1);
+    plan.buckets.clear();
+    plan.cfs.clear();
+
+    // The CFs of a bucket are stored as [ipol][mCol] in plan.cfs.
+    plan.polOffset.resize(nDataPol);
+    plan.nMCols.resize(nDataPol);
+    Int nCFPerBucket=0;
+    for (Int ipol=0; ipol<nDataPol; ipol++)
+      {
+	plan.polOffset[ipol] = nCFPerBucket;
+	plan.nMCols[ipol] = conjMNdx[ipol].nelements();
+	nCFPerBucket += plan.nMCols[ipol];
+      }
+
+    typedef std::tuple<const CFBuffer*, Int, Int, Bool> BucketKey;
+    std::map<BucketKey, Int> bucketMap;
+    // Data polarizations for which the CFs of a bucket are resolved.
+    std::vector<Bool> polResolved;
+
+    Vector<Int> cfShape, support(2);
+    Double cfRefFreq;
+    Float s;
+    Int sx, sy;
+
+    for (Int irow=rbeg; irow<rend; irow++)
+      {
+	if (rowFlag_ptr[irow]) continue;
+	CountedPtr<CFBuffer> cfb = (*vb2CFBMap_p)[irow];
+	Double wVal = (wUVW.nelements() > 0) ? wUVW(2,irow) : 0.0;
+
+	for (Int ichan=startChan; ichan<endChan; ichan++)
+	  {
+	    Int achan=chanMap_p[ichan];
+	    if ((achan < 0) || (achan >= nGridChan)) continue;
+	    if (useImgWts && (imgWts_ptr[ichan+irow*nDataChan] == 0.0)) continue;
+
+	    Int wndx = cfb->nearestWNdx(abs(wVal)*freq[ichan]/C::c);
+	    Int fndx = cfb->nearestFreqNdx(vbSpw,ichan,conjFreq);
+	    BucketKey key(&(*cfb), fndx, wndx, (wVal > 0.0));
+
+	    Int ib;
+	    auto itr = bucketMap.find(key);
+	    if (itr == bucketMap.end())
+	      {
+		AWGridPlanBucket bucket;
+		cfb->getParams(cfRefFreq, s, sx, sy, fndx, wndx, 0);
+		bucket.sampling = SynthesisUtils::nint(s);
+		bucket.cfBegin = plan.cfs.size();
+
+		ib = plan.buckets.size();
+		plan.buckets.push_back(bucket);
+		plan.cfs.resize(plan.cfs.size()+nCFPerBucket);
+		polResolved.resize(polResolved.size()+nDataPol, false);
+		bucketMap[key] = ib;
+	      }
+	    else
+	      ib = itr->second;
+
+	    plan.sampleBucket[(irow-rbeg)*nDataChan + ichan] = ib;
+
+	    // Resolve the CFs only for the polarizations that will be
+	    // used.  This loads the same CFs as the gridding loops would.
+	    for (Int ipol=0; ipol<nDataPol; ipol++)
+	      {
+		if (polResolved[ib*nDataPol + ipol]) continue;
+		if (flagCube_ptr[ipol + ichan*nDataPol + irow*nDataPol*nDataChan]) continue;
+		Int targetIMPol=polMap_p(ipol);
+		if ((targetIMPol < 0) || (targetIMPol >= nGridPol)) continue;
+
+		for (uInt mCol=0; mCol<(uInt)plan.nMCols[ipol]; mCol++)
+		  {
+		    AWGridPlanCF& cfp = plan.cfs[plan.buckets[ib].cfBegin + plan.polOffset[ipol] + mCol];
+		    try
+		      {
+			cfp.cf = getConvFunc_p(vbPA, cfShape, support, cfp.muellerElement,
+					       cfb, wVal, fndx, wndx, mNdx0, mNdx1,
+					       ipol, mCol);
+		      }
+		    catch (SynthesisFTMachineError& x)
+		      {
+			LogIO log_l(LogOrigin("AWVisResampler[R&D]","makeGridPlan_p"));
+			log_l << x.getMesg() << LogIO::EXCEPTION;
+		      }
+		    cfp.support[0] = support[0]; cfp.support[1] = support[1];
+		    cfp.convOrigin[0] = cfShape[0]/2; cfp.convOrigin[1] = cfShape[1]/2;
+		    cacheAxisIncrements(cfShape.getStorage(Dummy), cfp.cfInc);
+		  }
+		polResolved[ib*nDataPol + ipol] = true;
+	      }
+	  }
+      }
+
+    //
+    // Bin the samples by bucket (a counting sort).  std::map iterates
+    // over the buckets in the order of their keys.
+    //
+    plan.sorted = sortByCF_p;
+    plan.binBucket.clear(); plan.binBegin.clear(); plan.sortedSamples.clear();
+    if (plan.sorted)
+      {
+	Int nBins = plan.buckets.size();
+	std::vector<Int> binOfBucket(nBins);
+	for (auto& b : bucketMap)
+	  {
+	    binOfBucket[b.second] = plan.binBucket.size();
+	    plan.binBucket.push_back(b.second);
+	  }
+
+	plan.binBegin.assign(nBins+1, 0);
+	for (const Int& ib : plan.sampleBucket)
+	  if (ib >= 0) plan.binBegin[binOfBucket[ib]+1]++;
+	for (Int i=0; i<nBins; i++) plan.binBegin[i+1] += plan.binBegin[i];
+
+	std::vector<Int> next(plan.binBegin.begin(), plan.binBegin.end()-1);
+	plan.sortedSamples.resize(plan.binBegin[nBins]);
+	for (Int k=0; k<(Int)plan.sampleBucket.size(); k++)
+	  if (plan.sampleBucket[k] >= 0)
+	    plan.sortedSamples[next[binOfBucket[plan.sampleBucket[k]]]++] = k;
+      }
+  }
   //
   //-----------------------------------------------------------------------------------
   // Template implementation for DataToGrid
   //
+  // The grid planes (image channel x polarization) are independent.
+  // Each thread owns a disjoint set of planes and grids only the
+  // samples that land on them.  This needs no synchronization for
+  // the grid or the sumwt, and scales with the number of planes for
+  // cube and full-pol imaging.  For a single plane (MFS Stokes-I),
+  // this reduces to the serial gridder.  The tiled gridder
+  // (DataToGridTiled_p) parallelizes also within a plane.
+  //
   template <class T>
   void AWVisResampler::DataToGridImpl_p(Array<T>& grid,  VBStore& vbs, 
 					Matrix<Double>& sumwt,const Bool& dopsf,
 					Bool /*useConjFreqCF*/)
   {
-    Int nDataChan, nDataPol, nGridPol, nGridChan, nx, ny, nw;//, nCFFreq;
-    Int targetIMChan, targetIMPol, rbeg, rend;//, PolnPlane, ConjPlane;
+    Int nGridPlanes = grid.shape()[2]*grid.shape()[3];
+    Int nth = nWorkerThreads_p(nGridPlanes);
+
+    cacheAxisIncrements(grid.shape().asVector(), gridInc_p);
+
+    //
+    // Resolve the CFs for this VisBuffer.
+    //
+    {
+      Bool accumCFs=((vbs.uvw_p.nelements() == 0) && dopsf);
+      Int startChan=0, endChan=vbs.flagCube_p.shape()[1];
+      if (accumCFs) {startChan = vbs.startChan_p; endChan = vbs.endChan_p;}
+
+      makeGridPlan_p(gridPlan_p, vbs, grid.shape(), vbs.uvw_p,
+		     startChan, endChan, vbs.conjBeams_p, true, false);
+    }
+
+    if (gridTileSize_p > 0)
+      {
+	DataToGridTiled_p(grid, vbs, sumwt, dopsf);
+	return;
+      }
+
+    if (nth == 1)
+      {
+	Double nVis=0;
+	DataToGridPlanes_p(grid, vbs, sumwt, dopsf, gridPlan_p, 1, 0, nVis);
+	nVisGridded_p += nVis;
+	return;
+      }
+
+    Double nVis=0;
+    std::vector<std::exception_ptr> threadException(nth, nullptr);
+
+#pragma omp parallel num_threads(nth) reduction(+:nVis)
+    {
+      Int tid=0;
+#ifdef _OPENMP
+      tid=omp_get_thread_num();
+#endif
+      try
+	{
+	  DataToGridPlanes_p(grid, vbs, sumwt, dopsf, gridPlan_p, nth, tid, nVis);
+	}
+      catch (...)
+	{
+	  // Exceptions cannot cross the parallel region.  Re-throw
+	  // from the calling thread below.
+	  threadException[tid]=std::current_exception();
+	}
+    }
+    nVisGridded_p += nVis;
+
+    for (auto& e : threadException)
+      if (e) std::rethrow_exception(e);
+  }
+  //
+  //-----------------------------------------------------------------------------------
+  //
+  template <class T>
+  void AWVisResampler::DataToGridPlanes_p(Array<T>& grid,  VBStore& vbs, 
+					  Matrix<Double>& sumwt,const Bool& dopsf,
+					  const AWGridPlan& plan,
+					  const Int& nPlaneSets, const Int& planeSet,
+					  Double& nVisGridded,
+					  const AWGridTile* tile)
+  {
+    Int nDataChan, nDataPol, nGridPol, nx, ny, nw;
+    Int targetIMChan, targetIMPol, rbeg, rend;
     Int startChan, endChan;
-    
 
-    Vector<Float> sampling(2),scaledSampling(2);
-    Vector<Int> support(2),loc(3), iloc(4),scaledSupport(2);
+    Vector<Float> sampling(2);
+    // The location of a sample on the grid (gridLoc) and on
+    // griddedData (loc).  These differ only for a tile.
+    Vector<Int> gridLoc(3), loc(3);
     Vector<Double> pos(3), off(3);
     Vector<Int> igrdpos(4);
 
-    Complex phasor, nvalue /*, wt */;
+    Complex phasor, nvalue;
     DComplex norm;
-    Vector<Int> cfShape;
-    // cfShape=(*vb2CFBMap_p)[0]->getStorage()(0,0,0)->getStorage()->shape().asVector();
-
-    Vector<Int> convOrigin;// = (cfShape)/2;
-    Double cfRefFreq;
     const Matrix<Double> UVW=vbs.uvw_p;
 
-    //    Double cfScale=1.0;
+    // Thread-local copies of the state used in the inner loops
+    // (accumulateToGrid.inc).
+    Vector<Int> gridInc_l;
+    Matrix<Complex> phaseGrad_l;
+    std::vector<Int> cfOffX_l, pgOffX_l;
 
-    //timer_p.mark();
-    rbeg = 0;       rend = vbs.nRow_p;
     rbeg = vbs.beginRow_p;
     rend = vbs.endRow_p;
     
     nx = grid.shape()[0]; ny = grid.shape()[1]; 
-    nGridPol = grid.shape()[2]; nGridChan = grid.shape()[3];
-
-    // const std::array<unsigned, 4> grid_size{(uInt)nx, (uInt)ny, (uInt)nGridPol, (uInt)nGridChan};
-    // const std::array<unsigned, 4> cf_size{31, 21, 2, 3};
-    // const std::array<float, 2> grid_scale{0.1, -0.1};
-    // auto st0 = hpg::Gridder(hpg::Device::Cuda, 2, grid_size, grid_scale);
-
+    nGridPol = grid.shape()[2];
+    Int x0=0, y0=0, chan0=0;
+    if (tile != NULL)
+      {
+	nx = tile->gridNX; ny = tile->gridNY;
+	x0 = tile->x0; y0 = tile->y0; chan0 = tile->chan;
+      }
 
     nDataPol  = vbs.flagCube_p.shape()[0];
     nDataChan = vbs.flagCube_p.shape()[1];
@@ -280,24 +541,17 @@ namespace casa{
       
     Double *freq=vbs.freq_p.getStorage(Dummy);
 
-    cacheAxisIncrements(grid.shape().asVector(), gridInc_p);
+    cacheAxisIncrements(grid.shape().asVector(), gridInc_l);
 
     Bool * __restrict__ flagCube_ptr=vbs.flagCube_p.getStorage(Dummy);
     Bool * __restrict__ rowFlag_ptr = vbs.rowFlag_p.getStorage(Dummy);;
     Float * __restrict__ imgWts_ptr = vbs.imagingWeight_p.getStorage(Dummy);
     Complex * __restrict__ visCube_ptr = vbs.visCube_p.getStorage(Dummy);
 
-    Vector<Double> wVals, fVals; PolMapType mVals, mNdx, conjMVals, conjMNdx;
-    Double fIncr, wIncr;
     CountedPtr<CFBuffer> cfb = (*vb2CFBMap_p)[0];
     bool finitePointingOffsets=cfb->finitePointingOffsets();
+    nw = plan.nW;
 
-    cfb->getCoordList(fVals,wVals,mNdx, mVals, conjMNdx, conjMVals, fIncr, wIncr);
-
-    nw = wVals.nelements();
-    iloc = 0;
-
-    IPosition shp=vbs.flagCube_p.shape();
    if (accumCFs)
      {
 	startChan = vbs.startChan_p;
@@ -309,261 +563,409 @@ namespace casa{
 	endChan = nDataChan;
       }
 
-   Int vbSpw = (vbs.vb_p)->spectralWindows()(0);
-   Double vbPA = vbs.paQuant_p.getValue("rad");
+    //
+    // Grid the data polarizations [ipolBeg, ipolEnd) of the sample
+    // (irow, ichan).  Samples with zero weight or outside the image
+    // channels are not in the plan and must not be passed here.
+    //
+    Int phaseGradRow=-1;
+    auto gridSample = [&](const Int irow, const Int ichan, const Int ipolBeg, const Int ipolEnd)
+    {
+      const AWGridPlanBucket& bucket = plan.buckets[plan.bucket(irow, ichan)];
+      if (irow != phaseGradRow)
+	{
+	  phaseGrad_l.reference((vb2CFBMap_p->vectorPhaseGradCalculator_p[vb2CFBMap_p->vbRow2BLMap_p[irow]])->field_phaseGrad_p);
+	  phaseGradRow=irow;
+	}
 
-   for(Int irow=rbeg; irow< rend; irow++){   
-      
-      if(!(*(rowFlag_ptr+irow)))
-	{   
-	  setFieldPhaseGrad((vb2CFBMap_p->vectorPhaseGradCalculator_p[vb2CFBMap_p->vbRow2BLMap_p[irow]])->field_phaseGrad_p);
-	  cfb = (*vb2CFBMap_p)[irow];
-
-	  for(Int ichan=startChan; ichan< endChan; ichan++)
-	    {
-	      if (*(imgWts_ptr + ichan+irow*nDataChan)!=0.0) 
-		{  
-		  targetIMChan=chanMap_p[ichan];
-		  
-		  if((targetIMChan>=0) && (targetIMChan<nGridChan)) 
-		    {
+      targetIMChan=chanMap_p[ichan];
+      Double dataWVal = (UVW.nelements() > 0) ? UVW(2,irow) : 0.0;
 
-		      //		      Double dataWVal = (UVW.nelements() > 0) ? dataWVal = UVW(2,irow) : 0.0;
-		      Double dataWVal = (UVW.nelements() > 0) ? UVW(2,irow) : 0.0;
-		      Int wndx = cfb->nearestWNdx(dataWVal*freq[ichan]/C::c);
-		      Int cfFreqNdx = cfb->nearestFreqNdx(vbSpw,ichan,vbs.conjBeams_p);
-		      Float s;
-		      //
-		      //------------------------------------------------------------------------------
-		      //
-		      // Using the int-index version for Freq, W and Muellerelements
-		      //
-		      //------------------------------------------------------------------------------
-		      //
-
-		      cfb->getParams(cfRefFreq, s, support(0), support(1),cfFreqNdx,wndx,0);
-
-		      sampling(0) = sampling(1) = SynthesisUtils::nint(s);
+      sampling(0) = sampling(1) = bucket.sampling;
 		      
-		      sgrid(pos,loc,off, phasor, irow, UVW, dphase_p[irow], freq[ichan], 
-			    uvwScale_p, offset_p, sampling);
-			{
-			  // Loop over all image-plane polarization planes.
-
-			  for(Int ipol=0; ipol< nDataPol; ipol++) 
-			    { 
-			      if((!(*(flagCube_ptr + ipol + ichan*nDataPol + irow*nDataPol*nDataChan))))
-				{  
-				  targetIMPol=polMap_p(ipol);
-				  if ((targetIMPol>=0) && (targetIMPol<nGridPol)) 
-				    {
-				      igrdpos[2]=targetIMPol; igrdpos[3]=targetIMChan;
+      sgrid(pos,gridLoc,off, phasor, irow, UVW, dphase_p[irow], freq[ichan], 
+	    uvwScale_p, offset_p, sampling);
+      loc(0)=gridLoc(0)-x0; loc(1)=gridLoc(1)-y0; loc(2)=gridLoc(2);
+
+      // Loop over all image-plane polarization planes.
+      for(Int ipol=ipolBeg; ipol< ipolEnd; ipol++) 
+	{ 
+	  if((!(*(flagCube_ptr + ipol + ichan*nDataPol + irow*nDataPol*nDataChan))))
+	    {  
+	      targetIMPol=polMap_p(ipol);
+	      if ((targetIMPol>=0) && (targetIMPol<nGridPol) &&
+		  (((targetIMPol + targetIMChan*nGridPol) % nPlaneSets) == planeSet))
+		{
+		  igrdpos[2]=targetIMPol; igrdpos[3]=targetIMChan-chan0;
 				      
-				      norm = 0.0;
-				      // Loop over all relevant elements of the Mueller matrix for the polarization
-				      // ipol.
-				      Vector<int> conjMRow = conjMNdx[ipol];
-
-//cfFreqNdx=0;
-				      for (uInt mCols=0;mCols<conjMRow.nelements(); mCols++) 
-					{
-					  int visVecElement=mCols, muellerElement;
-
-					  Complex* convFuncV=NULL;
-					  //timer_p.mark();
-					  try
-					    {
-					      convFuncV=getConvFunc_p(vbPA,
-								      cfShape, support,muellerElement,
-								      cfb, dataWVal, cfFreqNdx,
-								      wndx, mNdx, conjMNdx, ipol,  mCols);
-					    }
-					  catch (SynthesisFTMachineError& x)
-					    {
-					      LogIO log_l(LogOrigin("AWVisResampler[R&D]","DataToGridImpl_p"));
-					      log_l << x.getMesg() << LogIO::EXCEPTION;
-					    }
-					  // Extract the vis. vector element corresponding to the mCols column of the conjMRow row of the Mueller matrix.
-
-					  visVecElement=(int)(muellerElement%nDataPol);
-					  // If the vis. vector element is flagged, don't grid it.
-					  if(((*(flagCube_ptr + visVecElement + ichan*nDataPol + irow*nDataPol*nDataChan)))) break;
-
-					  if(dopsf) nvalue=Complex(*(imgWts_ptr + ichan + irow*nDataChan));
-					  else      nvalue=Complex(*(imgWts_ptr+ichan+irow*nDataChan))*
-					   	      (*(visCube_ptr+visVecElement+ichan*nDataPol+irow*nDataChan*nDataPol)*phasor);
-
-					  if (!onGrid(nx, ny, nw, loc, support)) break;
-
-					  convOrigin=cfShape/2;
-					  
-					  cacheAxisIncrements(cfShape, cfInc_p);
-					  nVisGridded_p++;
+		  norm = 0.0;
+		  // Loop over all relevant elements of the Mueller matrix for the polarization
+		  // ipol.
+		  for (Int mCols=0;mCols<plan.nMCols[ipol]; mCols++) 
+		    {
+		      const AWGridPlanCF& cfp = plan.cf(bucket, ipol, mCols);
+		      // Extract the vis. vector element corresponding to the mCols column of the conjMRow row of the Mueller matrix.
+		      int visVecElement=(int)(cfp.muellerElement%nDataPol);
+		      // If the vis. vector element is flagged, don't grid it.
+		      if(((*(flagCube_ptr + visVecElement + ichan*nDataPol + irow*nDataPol*nDataChan)))) break;
+
+		      if(dopsf) nvalue=Complex(*(imgWts_ptr + ichan + irow*nDataChan));
+		      else      nvalue=Complex(*(imgWts_ptr+ichan+irow*nDataChan))*
+				  (*(visCube_ptr+visVecElement+ichan*nDataPol+irow*nDataChan*nDataPol)*phasor);
+
+		      if (!onGrid(nx, ny, nw, gridLoc, cfp.support)) break;
+
+		      nVisGridded++;
 #include <synthesis/TransformMachines2/accumulateToGrid.inc>
-					}
-				      sumwt(targetIMPol,targetIMChan) += vbs.imagingWeight_p(ichan, irow)*fabs(norm);
-				      //		      *(sumWt_ptr+apol+achan*nGridChan)+= *(imgWts_ptr+ichan+irow*nDataChan);
-				    }
-				}
-			      // else
-			      // 	{
-			      // 	  cerr << "Vis0: " << irow << " " << ipol << " " << UVW(0,irow) << " " << UVW(1,irow) << " " << UVW(2,irow) << endl;
-			      // 	}
-			    } // End poln-loop
-			}
 		    }
+		  sumwt(targetIMPol,targetIMChan) += vbs.imagingWeight_p(ichan, irow)*fabs(norm);
 		}
-	    } // End chan-loop
-	}
-    } // End row-loop
+	    }
+	} // End poln-loop
+    };
+
+    if (tile != NULL)
+      {
+	for (const Int& k : tile->samples)
+	  gridSample(k / nDataChan + rbeg, k % nDataChan, 0, nDataPol);
+      }
+    else if (plan.sorted)
+      {
+	// Bin by bin, one data polarization at a time, so that the same
+	// CFs are used for consecutive samples.
+	for (uInt bin=0; bin<plan.binBucket.size(); bin++)
+	  for (Int ipol=0; ipol<nDataPol; ipol++)
+	    for (Int k=plan.binBegin[bin]; k<plan.binBegin[bin+1]; k++)
+	      {
+		Int ichan = plan.sortedSamples[k] % nDataChan;
+		Int irow = plan.sortedSamples[k] / nDataChan + rbeg;
+		gridSample(irow, ichan, ipol, ipol+1);
+	      }
+      }
+    else
+      {
+	for(Int irow=rbeg; irow< rend; irow++)
+	  {
+	    if(*(rowFlag_ptr+irow)) continue;
+	    for(Int ichan=startChan; ichan< endChan; ichan++)
+	      if (plan.bucket(irow, ichan) >= 0) gridSample(irow, ichan, 0, nDataPol);
+	  } // End row-loop
+      }
 
     T *tt=(T *)gridStore;
     grid.putStorage(tt,gDummy);
   }
   //
   //-----------------------------------------------------------------------------------
+  //
+  template <class T>
+  void AWVisResampler::DataToGridTiled_p(Array<T>& grid,  VBStore& vbs, 
+					 Matrix<Double>& sumwt,const Bool& dopsf)
+  {
+    const AWGridPlan& plan = gridPlan_p;
+    Int nx = grid.shape()[0], ny = grid.shape()[1], nGridPol = grid.shape()[2];
+    Int nDataChan = vbs.flagCube_p.shape()[1];
+
+    //
+    // The halo of the tiles is the largest CF support.  Tiles of the
+    // same colour, (tx%2, ty%2), are two tiles apart.  With a tile
+    // size of at least twice the halo, their buffers cover disjoint
+    // parts of the grid.
+    //
+    Int halo=0;
+    for (const AWGridPlanCF& cfp : plan.cfs)
+      if (cfp.cf != NULL) halo = max(halo, max(cfp.support[0], cfp.support[1]));
+    Int tileSize = max(gridTileSize_p, 2*halo);
+    Int ntx = (nx+tileSize-1)/tileSize, nty = (ny+tileSize-1)/tileSize;
+
+    //
+    // Bin the samples by (image channel, tile).  Only the nearest
+    // grid pixel is needed for this.  The order of the samples in
+    // the plan is kept.
+    //
+    std::vector<AWGridTile> tiles;
+    std::vector<Int> colourTiles[4];
+    std::map<Int, Int> tileIndex;
+    {
+      Vector<Double> pos(3), off(3);
+      Vector<Int> loc(3);
+      Vector<Float> sampling(2, 1.0);
+      Complex phasor;
+      auto binSample = [&](const Int k)
+      {
+	Int irow = k/nDataChan + plan.beginRow, ichan = k%nDataChan;
+	sgrid(pos, loc, off, phasor, irow, vbs.uvw_p, 0.0, vbs.freq_p[ichan],
+	      uvwScale_p, offset_p, sampling);
+	// Samples off the grid are not gridded.
+	if ((loc(0) < 0) || (loc(0) >= nx) || (loc(1) < 0) || (loc(1) >= ny)) return;
+
+	Int achan = chanMap_p[ichan];
+	Int tx = loc(0)/tileSize, ty = loc(1)/tileSize;
+	Int key = (achan*nty + ty)*ntx + tx;
+	auto itr = tileIndex.find(key);
+	if (itr == tileIndex.end())
+	  {
+	    AWGridTile t;
+	    t.x0 = tx*tileSize - halo; t.y0 = ty*tileSize - halo; t.chan = achan;
+	    t.gridNX = nx; t.gridNY = ny;
+	    t.xMin = t.xMax = loc(0); t.yMin = t.yMax = loc(1);
+	    itr = tileIndex.insert(std::make_pair(key, (Int)tiles.size())).first;
+	    colourTiles[(tx%2) + 2*(ty%2)].push_back(tiles.size());
+	    tiles.push_back(t);
+	  }
+	AWGridTile& t = tiles[itr->second];
+	t.xMin = min(t.xMin, loc(0)); t.xMax = max(t.xMax, loc(0));
+	t.yMin = min(t.yMin, loc(1)); t.yMax = max(t.yMax, loc(1));
+	t.samples.push_back(k);
+      };
+
+      if (plan.sorted)
+	for (const Int& k : plan.sortedSamples) binSample(k);
+      else
+	for (Int k=0; k<(Int)plan.sampleBucket.size(); k++)
+	  if (plan.sampleBucket[k] >= 0) binSample(k);
+    }
+
+    Int nth = nWorkerThreads_p(max(colourTiles[0].size(),
+				   max(colourTiles[1].size(),
+				       max(colourTiles[2].size(), colourTiles[3].size()))));
+
+    //
+    // Per-thread tile buffers and sumwt.  The buffers are kept zero
+    // between the tiles: only the part that a tile may have touched
+    // is added to the grid and reset.
+    //
+    Int nb = tileSize + 2*halo;
+    std::vector<Array<T> > tileBuf(nth);
+    std::vector<Matrix<Double> > sumwt_l(nth);
+    for (Int t=0; t<nth; t++)
+      {
+	tileBuf[t].resize(IPosition(4, nb, nb, nGridPol, 1));
+	tileBuf[t] = T(0.0);
+	sumwt_l[t].resize(sumwt.shape());
+	sumwt_l[t] = 0.0;
+      }
+
+    Bool gDummy;
+    T* gridStore = grid.getStorage(gDummy);
+    Vector<Int> gridInc_l;
+    cacheAxisIncrements(grid.shape().asVector(), gridInc_l);
+
+    Double nVis=0;
+    std::vector<std::exception_ptr> threadException(nth, nullptr);
+    for (Int colour=0; colour<4; colour++)
+      {
+	const std::vector<Int>& work = colourTiles[colour];
+
+#pragma omp parallel for num_threads(nth) schedule(dynamic) reduction(+:nVis)
+	for (Int i=0; i<(Int)work.size(); i++)
+	  {
+	    Int tid=0;
+#ifdef _OPENMP
+	    tid=omp_get_thread_num();
+#endif
+	    try
+	      {
+		const AWGridTile& tile = tiles[work[i]];
+		DataToGridPlanes_p(tileBuf[tid], vbs, sumwt_l[tid], dopsf, plan, 1, 0, nVis, &tile);
+
+		// Add the touched part of the buffer to the grid.
+		Int bx0 = max(tile.xMin-halo, 0), bx1 = min(tile.xMax+halo, nx-1);
+		Int by0 = max(tile.yMin-halo, 0), by1 = min(tile.yMax+halo, ny-1);
+		Bool bDummy;
+		T* bufStore = tileBuf[tid].getStorage(bDummy);
+		for (Int ipol=0; ipol<nGridPol; ipol++)
+		  for (Int iy=by0; iy<=by1; iy++)
+		    {
+		      T* __restrict__ b = bufStore + (bx0-tile.x0) + (iy-tile.y0)*nb + ipol*nb*nb;
+		      T* __restrict__ g = gridStore + bx0 + iy*gridInc_l[1]
+			+ ipol*gridInc_l[2] + tile.chan*gridInc_l[3];
+		      for (Int ix=0; ix<=bx1-bx0; ix++) {g[ix] += b[ix]; b[ix] = T(0.0);}
+		    }
+		tileBuf[tid].putStorage(bufStore, bDummy);
+	      }
+	    catch (...)
+	      {
+		threadException[tid]=std::current_exception();
+	      }
+	  }
+
+	for (auto& e : threadException)
+	  if (e) std::rethrow_exception(e);
+      }
+    grid.putStorage(gridStore, gDummy);
+
+    for (Int t=0; t<nth; t++) sumwt += sumwt_l[t];
+    nVisGridded_p += nVis;
+  }
+  //
+  //-----------------------------------------------------------------------------------
   // Re-sample VisBuffer to a regular grid (griddedData) (a.k.a. de-gridding)
   //
+  // Each predicted visibility is independent.  The rows are
+  // distributed across the threads (interleaved, for a rough
+  // load-balance across baselines), with all loop state local to the
+  // thread.
+  //
   void AWVisResampler::GridToData(VBStore& vbs, const Array<Complex>& grid)
   {
-    Int nDataChan, nDataPol, nGridPol, nGridChan, nx, ny,nw;//, nCFFreq;
-    Int achan, apol, rbeg, rend;//, PolnPlane, ConjPlane;
-    Vector<Float> sampling(2);//scaledSampling(2);
-    Vector<Int> support(2),loc(3), iloc(4);
+    Int rbeg = vbs.beginRow_p, rend = vbs.endRow_p;
+    Int nth = nWorkerThreads_p(rend-rbeg);
+
+    //
+    // Resolve the CFs for this VisBuffer.  The W-value used for the
+    // CF lookup is from the VisBuffer.  This also fills the UVW cache
+    // of the VisBuffer, which is not thread-safe.
+    //
+    makeGridPlan_p(gridPlan_p, vbs, grid.shape(), vbs.vb_p->uvw(),
+		   0, vbs.flagCube_p.shape()[1], false, false, true);
+
+    if (nth == 1)
+      {
+	GridToDataRows_p(vbs, grid, gridPlan_p, 1, 0);
+	return;
+      }
+
+    std::vector<std::exception_ptr> threadException(nth, nullptr);
+
+#pragma omp parallel num_threads(nth)
+    {
+      Int tid=0;
+#ifdef _OPENMP
+      tid=omp_get_thread_num();
+#endif
+      try
+	{
+	  GridToDataRows_p(vbs, grid, gridPlan_p, nth, tid);
+	}
+      catch (...)
+	{
+	  threadException[tid]=std::current_exception();
+	}
+    }
+
+    for (auto& e : threadException)
+      if (e) std::rethrow_exception(e);
+  }
+  //
+  //-----------------------------------------------------------------------------------
+  //
+  void AWVisResampler::GridToDataRows_p(VBStore& vbs, const Array<Complex>& grid,
+					const AWGridPlan& plan,
+					const Int& nRowSets, const Int& rowSet)
+  {
+    Int nDataChan, nDataPol, nGridPol, nx, ny,nw;
+    Int achan, apol, rbeg, rend;
+    Vector<Float> sampling(2);
+    Vector<Int> loc(3);
     Vector<Double> pos(3), off(3);
     
-    IPosition grdpos(4);
-    
     Vector<Complex> norm(4,0.0);
     Complex phasor, nvalue;
     CountedPtr<CFBuffer> cfb=(*vb2CFBMap_p)[0];
-    Vector<Int> cfShape=cfb->getStorage()(0,0,0)->getStorage()->shape().asVector();
     Bool finitePointingOffset=cfb->finitePointingOffsets();
 
-    Vector<Int> convOrigin = (cfShape)/2;
-    Double cfRefFreq;//cfScale=1.0
+    // Thread-local copies of the state used in the inner loops
+    // (accumulateFromGrid.inc).
+    Vector<Int> gridInc_l;
+    Matrix<Complex> phaseGrad_l;
+    std::vector<Int> cfOffX_l, pgOffX_l;
     
-    rbeg=0;
-    rend=vbs.nRow_p;
     rbeg = vbs.beginRow_p;
     rend = vbs.endRow_p;
     nx       = grid.shape()[0]; ny        = grid.shape()[1];
-     nGridPol = grid.shape()[2]; nGridChan = grid.shape()[3];
+    nGridPol = grid.shape()[2];
     
     nDataPol  = vbs.flagCube_p.shape()[0];
     nDataChan = vbs.flagCube_p.shape()[1];
     
-    //
-    // The following code reduces most array accesses to the simplest
-    // possible to improve performance.  However this made no
-    // difference in the run-time performance compared to Vector,
-    // Matrix and Cube indexing.
-    //
     Bool Dummy;
     const Complex* __restrict__ gridStore = grid.getStorage(Dummy);
-    (void)gridStore;
     Vector<Int> igrdpos(4);
     Double *freq=vbs.freq_p.getStorage(Dummy);
     Bool *rowFlag=vbs.rowFlag_p.getStorage(Dummy);
     
     Matrix<Double>& uvw=vbs.uvw_p;
+    const Matrix<Double>& vbUVW=vbs.vb_p->uvw();
     Cube<Complex>&  visCube=vbs.visCube_p;
     Cube<Bool>&     flagCube=vbs.flagCube_p;
     
-    Vector<Int> gridInc, cfInc;
-    
-    cacheAxisIncrements(grid.shape().asVector(), gridInc_p);
-    //cacheAxisIncrements(cfShape, cfInc_p);
-    // Initialize the co-ordinates used for reading the CF values The
-    // CFs are 4D arrays, with the last two axis degenerate (of length
-    // 1).  The last two axis were formerly the W-, and
-    // Polarization-axis.
-    iloc = 0;
-    Int vbSpw = (vbs.vb_p)->spectralWindows()(0);
-    Double vbPA = vbs.paQuant_p.getValue("rad");
-
-    Vector<Double> wVals, fVals; PolMapType mVals, mNdx, conjMVals, conjMNdx;
-    Double fIncr, wIncr;
-    cfb->getCoordList(fVals,wVals,mNdx, mVals, conjMNdx, conjMVals, fIncr, wIncr);
-    nw = wVals.nelements();
+    cacheAxisIncrements(grid.shape().asVector(), gridInc_l);
+    nw = plan.nW;
 
-    for(Int irow=rbeg; irow<rend; irow++) {
-      if(!rowFlag[irow]) {
+    //
+    // De-grid the data polarizations [ipolBeg, ipolEnd) of the sample
+    // (irow, ichan), which must be in the plan.
+    //
+    Int phaseGradRow=-1;
+    auto degridSample = [&](const Int irow, const Int ichan, const Int ipolBeg, const Int ipolEnd)
+    {
+      const AWGridPlanBucket& bucket = plan.buckets[plan.bucket(irow, ichan)];
+      if (irow != phaseGradRow)
+	{
+	  phaseGrad_l.reference((vb2CFBMap_p->vectorPhaseGradCalculator_p[vb2CFBMap_p->vbRow2BLMap_p[irow]])->field_phaseGrad_p);
+	  phaseGradRow=irow;
+	}
 
-	setFieldPhaseGrad((vb2CFBMap_p->vectorPhaseGradCalculator_p[vb2CFBMap_p->vbRow2BLMap_p[irow]])->field_phaseGrad_p);
-	cfb = (*vb2CFBMap_p)[irow];
-	
-	for (Int ichan=0; ichan < nDataChan; ichan++) {
-	  achan=chanMap_p[ichan];
-	  
-	  if((achan>=0) && (achan<nGridChan)) {
-	    Double dataWVal = (vbs.vb_p->uvw()(2,irow));
-	    Int wndx = cfb->nearestWNdx(abs(dataWVal)*freq[ichan]/C::c);
-	    Int fndx = cfb->nearestFreqNdx(vbSpw,ichan);
-	    Float s;
-
-	    cfb->getParams(cfRefFreq,s,support(0),support(1),fndx,wndx,0);
-	    sampling(0) = sampling(1) = SynthesisUtils::nint(s);
+      achan=chanMap_p[ichan];
+      Double dataWVal = vbUVW(2,irow);
+      sampling(0) = sampling(1) = bucket.sampling;
 	    
-	    sgrid(pos,loc,off,phasor,irow,uvw,dphase_p[irow],freq[ichan],
-		  uvwScale_p,offset_p,sampling);
+      sgrid(pos,loc,off,phasor,irow,uvw,dphase_p[irow],freq[ichan],
+	    uvwScale_p,offset_p,sampling);
 	    
-	    Bool isOnGrid;
-
-	    {
-	      for(Int ipol=0; ipol < nDataPol; ipol++)
-		{
-		  if(!flagCube(ipol,ichan,irow))
-		    { 
-		      apol=polMap_p[ipol];
+      for(Int ipol=ipolBeg; ipol < ipolEnd; ipol++)
+	{
+	  if(!flagCube(ipol,ichan,irow))
+	    { 
+	      apol=polMap_p[ipol];
 		  
-		      if((apol>=0) && (apol<nGridPol))
-			{
-			  igrdpos[2]=apol; igrdpos[3]=achan;
-			  nvalue=0.0;      norm(ipol)=0.0;
+	      if((apol>=0) && (apol<nGridPol))
+		{
+		  igrdpos[2]=apol; igrdpos[3]=achan;
+		  nvalue=0.0;      norm(ipol)=0.0;
 		    
-			  // With VBRow2CFMap in use, CF for each pol. plane is a separate 2D Array.  
-			  for (uInt mCol=0; mCol<conjMNdx[ipol].nelements(); mCol++)
-			    {
-			      //
-			      int visGridElement, muellerElement;
-			      // Get the pointer to the storage for the CF
-			      // indexed by the Freq, W-term and Mueller
-			      // Element.
-			      //
-			      Complex*  convFuncV=NULL;
-			      try
-				{
-				  convFuncV = getConvFunc_p(vbPA,cfShape, support, muellerElement,
-							    cfb, dataWVal, fndx, wndx, conjMNdx,mNdx,
-							    ipol, mCol);
-				}
-			      catch (SynthesisFTMachineError& x)
-				{
-				  LogIO log_l(LogOrigin("AWVisResampler[R&D]","GridToData"));
-				  log_l << x.getMesg() << LogIO::EXCEPTION;
-				}
-			      // Set the polarization plane of the gridded data to use for predicting with the CF from mCols column
-			      visGridElement=(int)(muellerElement%nDataPol);
-			      igrdpos[2]=polMap_p[visGridElement];
-			      //
-			      // Compute the incrmenets and center pixel for the current CF
-			      //
-			      if ((isOnGrid=onGrid(nx, ny, nw, loc, support))==false) break;
-			      cacheAxisIncrements(cfShape, cfInc_p);
-			      convOrigin = (cfShape)/2;
+		  // With VBRow2CFMap in use, CF for each pol. plane is a separate 2D Array.  
+		  for (Int mCol=0; mCol<plan.nMCols[ipol]; mCol++)
+		    {
+		      const AWGridPlanCF& cfp = plan.cf(bucket, ipol, mCol);
+		      // Set the polarization plane of the gridded data to use for predicting with the CF from mCols column
+		      int visGridElement=(int)(cfp.muellerElement%nDataPol);
+		      igrdpos[2]=polMap_p[visGridElement];
+
+		      if (!onGrid(nx, ny, nw, loc, cfp.support)) break;
 
 #include <synthesis/TransformMachines2/accumulateFromGrid.inc>
-			    }
-			  if (norm[ipol] != Complex(0.0)) visCube(ipol,ichan,irow)=nvalue/norm[ipol]; // Goes with FortranizedLoopsFromGrid.cc
-			}
 		    }
+		  if (norm[ipol] != Complex(0.0)) visCube(ipol,ichan,irow)=nvalue/norm[ipol]; // Goes with FortranizedLoopsFromGrid.cc
 		}
 	    }
-	  }
 	}
+    };
+
+    if (plan.sorted)
+      {
+	// Bin by bin, one data polarization at a time.  The samples of
+	// a bin are interleaved across the threads so that all threads
+	// use the same CFs at the same time.
+	for (uInt bin=0; bin<plan.binBucket.size(); bin++)
+	  for (Int ipol=0; ipol<nDataPol; ipol++)
+	    for (Int k=plan.binBegin[bin]+rowSet; k<plan.binBegin[bin+1]; k+=nRowSets)
+	      {
+		Int ichan = plan.sortedSamples[k] % nDataChan;
+		Int irow = plan.sortedSamples[k] / nDataChan + rbeg;
+		degridSample(irow, ichan, ipol, ipol+1);
+	      }
+      }
+    else
+      {
+	for(Int irow=rbeg+rowSet; irow<rend; irow+=nRowSets)
+	  {
+	    if(rowFlag[irow]) continue;
+	    for (Int ichan=0; ichan < nDataChan; ichan++)
+	      if (plan.bucket(irow, ichan) >= 0) degridSample(irow, ichan, 0, nDataPol);
+	  } // End row-loop
       }
-    } // End row-loop
   }
   //
   //-----------------------------------------------------------------------------------
@@ -578,18 +980,18 @@ void AWVisResampler::sgrid(Vector<Double>& pos, Vector<Int>& loc,
 {
   // inv_lambda float in HPG Double here
   Double phase;
-  Vector<Double> uvw_l(3,0); // This allows gridding of weights
+  Double uvw_l[3]={0.0,0.0,0.0}; // This allows gridding of weights
   // centered on the uv-origin
   if (uvw.nelements() > 0) for(Int i=0;i<3;i++) uvw_l[i]=uvw(i,irow);
   
-  pos(2)=sqrt(abs(scale[2]*uvw_l(2)*freq/C::c))+offset[2];
+  pos(2)=sqrt(abs(scale[2]*uvw_l[2]*freq/C::c))+offset[2];
   //loc(2)=SynthesisUtils::nint(pos[2]);
   loc(2)=std::lrint(pos[2]);
   off(2)=0;
   
   for(Int idim=0;idim<2;idim++)
     {
-      pos[idim]=scale[idim]*uvw_l(idim)*freq/C::c+(offset[idim]);
+      pos[idim]=scale[idim]*uvw_l[idim]*freq/C::c+(offset[idim]);
 
       loc[idim]=std::lrint(pos[idim]);
 
@@ -40,14 +40,86 @@
 #include <casacore/casa/Logging/LogSink.h>
 #include <casacore/casa/Logging/LogMessage.h>
 
+#include <vector>
+
 namespace casa { //# NAMESPACE CASA - BEGIN
   namespace refim{
+  //
+  // The per-VisBuffer gridding plan.
+  //
+  // The CF used for a sample depends only on its (CFBuffer, CF
+  // frequency index, W index, sign of W) bucket, the data
+  // polarization and the column of the Mueller matrix.  The plan
+  // resolves these once per VisBuffer so that the (de-)gridding loops
+  // only do arithmetic.  Building the plan may load (and rotate) CFs
+  // and is therefore done serially, before the loops are split
+  // across threads.
+  //
+  struct AWGridPlanCF
+  {
+    casacore::Complex* cf=NULL;          // The CF pixels
+    casacore::Int support[2]={0,0};
+    casacore::Int convOrigin[2]={0,0};
+    casacore::Int cfInc[4]={0,0,0,0};    // Axis increments of the CF
+    casacore::Int muellerElement=0;
+  };
+
+  struct AWGridPlanBucket
+  {
+    casacore::Float sampling=1.0;
+    casacore::Int cfBegin=0;              // Index of (ipol=0, mCol=0) in AWGridPlan::cfs
+  };
+
+  struct AWGridPlan
+  {
+    casacore::Int beginRow=0, nDataChan=0, nW=0;
+    // Bucket index for each (row, channel), -1 for samples that are
+    // not (de-)gridded.
+    std::vector<casacore::Int> sampleBucket;
+    std::vector<AWGridPlanBucket> buckets;
+    std::vector<AWGridPlanCF> cfs;
+    // Offset of the first Mueller column of each data polarization in
+    // a bucket, and the no. of Mueller columns.
+    std::vector<casacore::Int> polOffset, nMCols;
+    // If sorted, the samples (index (irow-beginRow)*nDataChan+ichan)
+    // in bins of the same bucket.  The bins are in the order of the
+    // bucket keys (i.e. by CF frequency index, then W index).  The
+    // samples of the i-th bin are sortedSamples[binBegin[i]] to
+    // sortedSamples[binBegin[i+1]-1] and use the bucket binBucket[i].
+    casacore::Bool sorted=false;
+    std::vector<casacore::Int> binBucket, binBegin, sortedSamples;
+
+    inline casacore::Int bucket(const casacore::Int& irow, const casacore::Int& ichan) const
+    {return sampleBucket[(irow-beginRow)*nDataChan + ichan];}
+
+    inline const AWGridPlanCF& cf(const AWGridPlanBucket& b, const casacore::Int& ipol,
+				  const casacore::Int& mCol) const
+    {return cfs[b.cfBegin + polOffset[ipol] + mCol];}
+  };
+  //
+  // A tile of the grid for the tiled gridder.  The samples (as in
+  // AWGridPlan::sortedSamples) are those of the image channel chan
+  // whose nearest grid pixel is in the tile.  They are gridded on a
+  // buffer the size of the tile plus a halo of the largest CF
+  // support on all sides.  The pixel (0,0) of the buffer is the
+  // pixel (x0,y0) of the grid.  [xMin,xMax]x[yMin,yMax] is the
+  // range of the nearest grid pixels of the samples.
+  //
+  struct AWGridTile
+  {
+    casacore::Int x0=0, y0=0, chan=0;
+    casacore::Int gridNX=0, gridNY=0;     // Shape of the full grid
+    casacore::Int xMin=0, xMax=-1, yMin=0, yMax=-1;
+    std::vector<casacore::Int> samples;
+  };
+
   class AWVisResampler: public VisibilityResampler
   {
   public: 
     AWVisResampler(): VisibilityResampler(),
 		      //		      cached_phaseGrad_p(),
-                      cached_PointingOffset_p()
+                      cached_PointingOffset_p(), nThreads_p(-1), sortByCF_p(false),
+		      gridTileSize_p(0)
     {cached_PointingOffset_p.resize(2);cached_PointingOffset_p=-1000.0;runTimeG_p=runTimeDG_p=0.0;};
     //    AWVisResampler(const CFStore& cfs): VisibilityResampler(cfs)      {}
     virtual ~AWVisResampler()                                         {};
@@ -71,6 +143,9 @@ namespace casa { //# NAMESPACE CASA - BEGIN
       VisibilityResampler::copy(other);
       SynthesisUtils::SETVEC(cached_phaseGrad_p, other.cached_phaseGrad_p);
       SynthesisUtils::SETVEC(cached_PointingOffset_p, other.cached_PointingOffset_p);
+      nThreads_p = other.nThreads_p;
+      sortByCF_p = other.sortByCF_p;
+      gridTileSize_p = other.gridTileSize_p;
     }
 
     AWVisResampler& operator=(const AWVisResampler& other) 
@@ -81,6 +156,36 @@ namespace casa { //# NAMESPACE CASA - BEGIN
       return *this;
     }
 
+    //
+    // Set the number of threads used by the CPU gridder.  A value <=
+    // 0 uses all the threads available to OpenMP.
+    //
+    virtual void setNumThreads(const casacore::Int& n) {nThreads_p=n;}
+    //
+    // If true, the samples of a VisBuffer are (de-)gridded bin by
+    // bin, where a bin is the samples that use the same CFs (same
+    // CFBuffer, frequency and W index, and the sign of W).  Within a
+    // bin, the samples are processed one data polarization (i.e. one
+    // set of Mueller elements) at a time.  The CFs are then read
+    // once per bin instead of jumping between the W-planes and
+    // frequencies sample by sample.  This helps with large-support
+    // CFs that do not fit in the CPU caches.
+    //
+    virtual void setSortByCF(const casacore::Bool& sort) {sortByCF_p=sort;}
+    //
+    // If > 0, grid in tiles of (at least) this many pixels along each
+    // axis of the grid.  The samples are binned by tile and image
+    // channel.  Each thread grids a tile at a time on a private
+    // buffer of the tile plus the CF support on each side, and adds
+    // it to the grid.  The tiles are processed in four passes such
+    // that the tiles (with the halo) in a pass never overlap, so no
+    // locking is needed to add them to the grid.  This needs only
+    // one copy of the grid and parallelizes also a single grid plane
+    // (e.g. MFS Stokes-I).  The tile size is increased to twice the
+    // largest CF support if it is smaller.
+    //
+    virtual void setGridTileSize(const casacore::Int& n) {gridTileSize_p=n;}
+
     virtual void setCFMaps(const casacore::Vector<casacore::Int>& cfMap, const casacore::Vector<casacore::Int>& conjCFMap)
     {SETVEC(cfMap_p,cfMap);SETVEC(conjCFMap_p,conjCFMap);}
     //
@@ -117,6 +222,10 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 
     casacore::Vector<casacore::Int> gridInc_p, cfInc_p;
     casacore::Vector<casacore::Double> cached_PointingOffset_p;
+    casacore::Int nThreads_p;
+    casacore::Bool sortByCF_p;
+    casacore::Int gridTileSize_p;
+    AWGridPlan gridPlan_p;
     //
     // Re-sample the griddedData on the VisBuffer (a.k.a de-gridding).
     //
@@ -124,6 +233,57 @@ namespace casa { //# NAMESPACE CASA - BEGIN
     void DataToGridImpl_p(casacore::Array<T>& griddedData, VBStore& vb,  
 			  casacore::Matrix<casacore::Double>& sumwt,const casacore::Bool& dopsf,
 			  casacore::Bool /*useConjFreqCF*/);
+    //
+    // The gridding loops.  Only the grid planes (image channel x
+    // polarization) for which (plane % nPlaneSets) == planeSet are
+    // touched.  Threads working on different planeSet therefore never
+    // write to the same grid pixel or sumwt element.  All state used
+    // in the loops is local, so this can be called concurrently.
+    //
+    // If tile is not NULL, only the samples of the tile are gridded
+    // and griddedData is the tile buffer (of one image channel).
+    //
+    template <class T>
+    void DataToGridPlanes_p(casacore::Array<T>& griddedData, VBStore& vb,
+			    casacore::Matrix<casacore::Double>& sumwt,const casacore::Bool& dopsf,
+			    const AWGridPlan& plan,
+			    const casacore::Int& nPlaneSets, const casacore::Int& planeSet,
+			    casacore::Double& nVisGridded,
+			    const AWGridTile* tile=NULL);
+    //
+    // The tiled gridder (see setGridTileSize()), using gridPlan_p.
+    //
+    template <class T>
+    void DataToGridTiled_p(casacore::Array<T>& griddedData, VBStore& vb,
+			   casacore::Matrix<casacore::Double>& sumwt,const casacore::Bool& dopsf);
+    //
+    // The de-gridding loops for the rows irow=beginRow+rowSet,
+    // beginRow+rowSet+nRowSets,... (or, if the plan is sorted, for
+    // every nRowSets-th sample of each bin).  All state used in the
+    // loops is local, so this can be called concurrently for
+    // different rowSet.
+    //
+    void GridToDataRows_p(VBStore& vbs, const casacore::Array<casacore::Complex>& griddedData,
+			  const AWGridPlan& plan,
+			  const casacore::Int& nRowSets, const casacore::Int& rowSet);
+    //
+    // Build the gridding plan for the rows of vbs and the channels
+    // [startChan, endChan).  The W-value is taken from wUVW (0.0 if
+    // it is empty).  Samples with zero imaging weight are skipped if
+    // useImgWts is true.  degrid selects the Mueller index maps as
+    // used for de-gridding.  The samples are also binned by bucket
+    // if sortByCF_p is true.
+    //
+    void makeGridPlan_p(AWGridPlan& plan, VBStore& vbs,
+			const casacore::IPosition& gridShape,
+			const casacore::Matrix<casacore::Double>& wUVW,
+			const casacore::Int& startChan, const casacore::Int& endChan,
+			const casacore::Bool& conjFreq, const casacore::Bool& useImgWts,
+			const casacore::Bool& degrid);
+    //
+    // No. of threads to use for nWork independent units of work.
+    //
+    casacore::Int nWorkerThreads_p(const casacore::Int& nWork);
 
     void sgrid(casacore::Vector<casacore::Double>& pos, casacore::Vector<casacore::Int>& loc, casacore::Vector<casacore::Double>& off, 
     	       casacore::Complex& phasor, const casacore::Int& irow, const casacore::Matrix<casacore::Double>& uvw, 
@@ -139,6 +299,14 @@ namespace casa { //# NAMESPACE CASA - BEGIN
     	      ((loc(1)-support[1]) >= 0 ) && ((loc(1)+support[1]) < ny) &&
     	      (loc(2) >= 0) && (loc(2) <= nw));
     };
+    inline casacore::Bool onGrid (const casacore::Int& nx, const casacore::Int& ny, const casacore::Int& nw, 
+    			const casacore::Vector<casacore::Int>& loc, 
+    			const casacore::Int support[2])
+    {
+      return (((loc(0)-support[0]) >= 0 ) && ((loc(0)+support[0]) < nx) &&
+    	      ((loc(1)-support[1]) >= 0 ) && ((loc(1)+support[1]) < ny) &&
+    	      (loc(2) >= 0) && (loc(2) <= nw));
+    };
 
     // casacore::Array assignment operator in CASACore requires lhs.nelements()
     // == 0 or lhs.nelements()=rhs.nelements()
@@ -33,6 +33,8 @@
 #include <casacore/coordinates/Coordinates/SpectralCoordinate.h>
 #include <casacore/coordinates/Coordinates/CoordinateSystem.h>
 #include <casacore/casa/OS/Timer.h>
+#include <casacore/casa/Utilities/COWPtr.h>
+#include <casacore/casa/Arrays/ArrayMath.h>
 #include <fstream>
 #include <iostream>
 #include <typeinfo>
@@ -242,34 +244,18 @@ namespace casa{
     LogIO log_l(LogOrigin("AWVisResamplerHPG[R&D]","finalizeToSky(DCompelx)"));
     log_l << "Finalizing gridding..." << LogIO::POST;
 
-    // Lambda function to send a partially filled bucket to the
-    // device, and print a custom message.
-    auto sendPartialBucket =
-      [&](const std::string& mesg)
+    // Send the buckets remaining in the ring.  This covers the
+    // edge-case where the last set of VBs only partially filled the
+    // bucket, or spilled over the bucket boundary to the next bucket.
+    while (!hpgVBBucket_p.isEmpty())
       {
-	if (!hpgVBBucket_p.isEmpty())
-	  {
-	    log_l << "Sending "
-		  << hpgVBBucket_p.counter()
-		  << " " << mesg.c_str() << LogIO::POST;
-	    griddingTime += sendData(hpgVBBucket_p, nVisGridded_p, nDataBytes_p,
-				     sizeofVisData_p, (HPGModelImageName_p != ""));
-	    hpgGridder_p->fence();
-	  }
-      };
-
-    // Cover the edge-case where the last set of VBs only partially
-    // filled the bucket.
-    sendPartialBucket(std::string("data points from a partially filled vis bucket"));
-
-    // Cover the edge-case where the very last of the VBs spilled over
-    // the bucket boundry.
-    //
-    // Move the contents of the spillover buffer (SOBuf) to the
-    // bucket.  SOBuf is empty after this call.
-    hpgVBBucket_p.moveSOBuf();
-
-    sendPartialBucket(std::string("data points from the spillover buffer"));
+	log_l << "Sending "
+	      << hpgVBBucket_p.counter()
+	      << " data points from a partially filled vis bucket" << LogIO::POST;
+	griddingTime += sendData(hpgVBBucket_p, nVisGridded_p, nDataBytes_p,
+				 sizeofVisData_p, (HPGModelImageName_p != ""));
+      }
+    hpgGridder_p->fence();
     
     hpgGridder_p->shift_grid(ShiftDirection::FORWARD);
     hpgGridder_p->apply_grid_fft();
@@ -304,32 +290,46 @@ namespace casa{
   //
   //-------------------------------------------------------------------------
   // Retrieve the gridded data from the device.  The grid from the
-  // device is in DP and is converted OTF to the target type.
+  // device is in DP and is converted to the target type.
+  //
+  // The grid is copied in bulk (hpg::GridValueArray::copy_to()) in
+  // the column-major (Layout::Left) order of casacore::Array.  For a
+  // DP target, the copy is made directly into the storage of
+  // griddedData.  With the OpenMP device (HPGDEVICE=libra_omp), this
+  // is a single host memory copy of the grid.
   //
   template <class T>
   void AWVisResamplerHPG::getGriddedData(casacore::Array<T>& griddedData)
   {
+    LogIO log_l(LogOrigin("AWVisResamplerHPG[R&D]","getGriddedData"));
     auto gg=hpgGridder_p->grid_values();
-    IPosition shp = griddedData.shape(),ndx(4);
+    IPosition ndx(4);
     for (size_t i = 0; i < 4; ++i)
       ndx[i]=gg->extent(i);
-    griddedData.resize(ndx);
-    shp = griddedData.shape();
-    Bool dummy;
-    T *stor = griddedData.getStorage(dummy);
-    DComplex val;
-    unsigned long k=0;
-
-    // To TEST: All the following nested loops could be replaced with
-    // gg->copy_to(hpg::Device::OpenMP, stor);
-    for(ndx[3]=0;  ndx[3]<shp[3];  ndx[3]++)
-      for(ndx[2]=0;  ndx[2]<shp[2];  ndx[2]++)
-	for(ndx[1]=0;  ndx[1]<shp[1];  ndx[1]++)
-	  for(ndx[0]=0;  ndx[0]<shp[0];  ndx[0]++)
-	    {
-	      val = (*gg)(ndx[0],ndx[1],ndx[2],ndx[3]);
-	      stor[k++] = (T)val;
-	    }
+
+    auto copyGrid = [&](casacore::Array<casacore::DComplex>& target)
+      {
+	target.resize(ndx);
+	Bool dummy;
+	casacore::DComplex *stor = target.getStorage(dummy);
+	auto err=gg->copy_to(hpg::Device::OpenMP,
+			     (hpg::GridValueArray::value_type*)stor,
+			     hpg::Layout::Left);
+	target.putStorage(stor, dummy);
+	if (err)
+	  log_l << "Failed hpg::GridValueArray::copy_to(). Error type: "
+		<< static_cast<int>(err->type()) << LogIO::EXCEPTION;
+      };
+
+    if constexpr (std::is_same<T, casacore::DComplex>::value)
+      copyGrid(griddedData);
+    else
+      {
+	casacore::Array<casacore::DComplex> tmp;
+	copyGrid(tmp);
+	griddedData.resize(ndx);
+	casacore::convertArray(griddedData, tmp);
+      }
   }
   //
   //-------------------------------------------------------------------------
@@ -342,20 +342,23 @@ namespace casa{
     LogIO log_l(LogOrigin("AWVisResamplerHPG[R&D]","GatherGrids(DCompelx)"));
     {
       std::unique_ptr<hpg::GridWeightArray> wts=hpgGridder_p->grid_weights();
-      
-      hpgSoW_p.resize(wts->extent(0));
-      for (unsigned i=0;i<hpgSoW_p.size();i++)
-	hpgSoW_p[i].resize(wts->extent(1));
-      
-      for (unsigned i=0;i<hpgSoW_p.size();i++)
-      	{
-      	  for (unsigned j=0;j<hpgSoW_p[i].size();j++)
-      	    {
-      	      hpgSoW_p[i][j]=(*wts)(i,j);
-	      //      	      cerr << (*wts)(i,j) << " ";
-      	    }
-	  //      	  cerr << endl;
-      	}
+      unsigned nMRow=wts->extent(0), nCube=wts->extent(1);
+
+      // Copy the weights in bulk (column-major), rather than
+      // element-by-element via the accessor.
+      std::vector<hpg::GridWeightArray::value_type> wtsBuf((size_t)nMRow*nCube);
+      auto err=wts->copy_to(hpg::Device::OpenMP, wtsBuf.data(), hpg::Layout::Left);
+      if (err)
+	log_l << "Failed hpg::GridWeightArray::copy_to(). Error type: "
+	      << static_cast<int>(err->type()) << LogIO::EXCEPTION;
+
+      hpgSoW_p.resize(nMRow);
+      for (unsigned i=0;i<nMRow;i++)
+	{
+	  hpgSoW_p[i].resize(nCube);
+	  for (unsigned j=0;j<nCube;j++)
+	    hpgSoW_p[i][j]=wtsBuf[i + (size_t)j*nMRow];
+	}
 
       // hpgSoW_p is of type sumofweight_fp (vector<vector<double>>).  sumWeight is a Matrix.
       // sow[i][*] is a Mueller row. i is the index for the polarization product.
@@ -444,8 +447,11 @@ namespace casa{
     // 						       (int)modelImageGrid.shape()[1],
     // 						       (int)modelImageGrid.shape()[2],
     // 						       (int)modelImageGrid.shape()[3]};
-    casacore::Array<casacore::DComplex> tarr=modelImageGrid.get();
-    casacore::DComplex *tstor = tarr.getStorage(dummy);
+    // Get a reference to the pixels of the (in-memory) model grid.
+    // Lattice::get() would return a copy of the full grid.
+    casacore::COWPtr<casacore::Array<casacore::DComplex> > tarr;
+    modelImageGrid.get(tarr);
+    const casacore::DComplex *tstor = tarr->getStorage(dummy);
     
     std::unique_ptr<hpg::GridValueArray> HPGModelImage;
     
@@ -455,6 +461,7 @@ namespace casa{
 						   hpg::Device::OpenMP,//Device host_device,
 						   (hpg::GridValueArray::value_type*)tstor,
 						   extents);
+    tarr->freeStorage(tstor, dummy);
     
     
     unsigned shape[hpg::GridValueArray::rank];
@@ -629,23 +636,13 @@ namespace casa{
 				     const bool& do_degrid)
   {
     //
-    // If the VBBucket is full, shrink() it remove any unfilled space
-    // in the bucket, send the rest of the buffer to the gridder, and
-    // reset the bucket (reset()).  std::move() empties the storage of
-    // its argument.  The emptying of the buffer may (?)  happen with
-    // the std::move(VBBucket.hpgVB_p) anyway.
+    // Send the bucket at the head of the ring to the gridder and
+    // re-arm it (release()).  The bucket holds only the filled
+    // VisData.  HPG takes the ownership of its storage with
+    // std::move().
     //
     if (!VBBucket.isEmpty())
       {
-	// Shrink the internal storage of the bucket to be length
-	// it is filled (so that unfilled content does not reach
-	// the gridder).
-	VBBucket.shrink();
-	// cout << "SendVBB: " << VBBucket.size()
-	//      << " " << VBBucket.vbbSOBuf().size()
-	//      << " " << VBBucket.counter() 
-	//      << endl;
-
 	timer_p.mark();
 	unsigned nHPGVBRows = VBBucket.counter();
 
@@ -664,8 +661,7 @@ namespace casa{
 						hpg::Device::OpenMP,
 						std::move(VBBucket.vbbBuf())
 						);
-	assert(VBBucket.size()==0);
-	VBBucket.reset();
+	VBBucket.release();
 	    
 	if (err)
 	  {
@@ -740,13 +736,9 @@ namespace casa{
 				cfsi_p);
 				
     //    cerr << "MkHPGVB: " << rbeg << " " << rend << " " << hpgVBNRows << " " << hpgVBBucket_p.filledUnits() << endl;
-    // Resize so that there are no unused VisData in the hpgVB at the end.
-    if (!hpgVBBucket_p.isFull())
-      {
-	//	cout << "########## Sending VBB: " << hpgVBBucket_p.vbbBuf().size() << " " << hpgVBBucket_p.vbbSOBuf().size() << endl;
-	//	cerr << "VisData bucket not yet full. HPGList, hpgRows: " << hpgVB_p.size() << " " << hpgVBNRows << endl;
-      }
-    else
+    // Send the full buckets.  The rest of the VB (if any) is in the
+    // bucket being filled, which is sent once full.
+    if (hpgVBBucket_p.isFull())
       {
 	std::chrono::duration<double> thisVB_duration = std::chrono::steady_clock::now() - mkHPGVB_startTime;
     
@@ -758,8 +750,9 @@ namespace casa{
 	// to receive more data.
 	//
 	//    if (hpgVBList_p.size() >= maxVBList_p)
-	griddingTime += sendData(hpgVBBucket_p, nVisGridded_p, nDataBytes_p,
-				 sizeofVisData_p, do_degrid);
+	while (hpgVBBucket_p.isFull())
+	  griddingTime += sendData(hpgVBBucket_p, nVisGridded_p, nDataBytes_p,
+				   sizeofVisData_p, do_degrid);
       }    
     return;
   }
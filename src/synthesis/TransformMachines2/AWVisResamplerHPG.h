@@ -67,7 +67,8 @@ namespace casa { //# NAMESPACE CASA - BEGIN
     std::tuple<String, hpg::Device> getHPGDevice() {return std::make_tuple(HPGDeviceName_p, HPGDevice_p);};
 
     AWVisResamplerHPG(bool hpgInitAndFin=false,
-		      int nVisPerBucket=VIS_IN_THE_BUCKET):
+		      int nVisPerBucket=VIS_IN_THE_BUCKET,
+		      int nBuckets=2):
       AWVisResampler(), hpgGridder_p(NULL), vis(),
       grid_cubes(), cf_cubes(), weights(), frequencies(),
       cf_phase_screens(), hpgPhases(), visUVW(),nVBS_p(0),
@@ -78,7 +79,7 @@ namespace casa { //# NAMESPACE CASA - BEGIN
       cfsi_p({1,false},{1,false},{1,true},{1,true}, 1),
       cfArray_p(),dcf_ptr_p(),rwdcf_ptr_p(),
       mkHPGVB_startTime(), mkHPGVB_duration(), sizeofVisData_p(0),
-      hpgVB_p(),hpgVBBucket_p(nVisPerBucket)
+      hpgVB_p(),hpgVBBucket_p(nVisPerBucket,nBuckets)
     {
       //Get the bucket size in units of the number of visibilites it
       //can hold.  The supplied size is sanatized to the [1,n] range
@@ -91,7 +92,7 @@ namespace casa { //# NAMESPACE CASA - BEGIN
       std::tie(HPGDeviceName_p, HPGDevice_p) = makeHPGDevice();
       LogIO log_l(LogOrigin("AWVRHPG", "AWVRHPG()"));
       log_l << "Using HPG device " << HPGDeviceName_p << LogIO::POST;
-      log_l << "VB Bucket size: " << nVisPerBucket_p << LogIO::POST;
+      log_l << "VB Bucket size: " << nVisPerBucket_p << " x " << hpgVBBucket_p.nBuckets() << " buckets" << LogIO::POST;
 
       //      cached_PointingOffset_p.resize(2);cached_PointingOffset_p=-1000.0;runTimeG_p=runTimeDG_p=0.0;
       hpg::VisData<HPGNPOL> vd;
@@ -0,0 +1,757 @@
+// -*- C++ -*-
+//# CFCPack.cc: Implementation of the packed (single file) CF cache
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#include <synthesis/TransformMachines2/CFCPack.h>
+#include <synthesis/TransformMachines2/ImageInformation.h>
+#include <synthesis/TransformMachines2/Utils.h>
+#include <casacore/images/Images/PagedImage.h>
+#include <casacore/casa/IO/AipsIO.h>
+#include <casacore/casa/OS/File.h>
+#include <casacore/casa/OS/Path.h>
+#include <casacore/casa/Logging/LogIO.h>
+#include <casacore/casa/Exceptions/Error.h>
+#include <casacore/casa/BasicSL/Constants.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace casacore;
+namespace casa{
+  namespace refim{
+
+    const String CFCPack::indexFileName("CFCPack.idx");
+    const String CFCPack::pixelFileName("CFCPack.pix");
+    const Int64 CFCPack::alignment=64;
+    const Float CFCPack::quant8DynamicRange=1e-6;
+
+    namespace
+    {
+      //
+      // The packed CFCs opened in this process, by the absolute
+      // name of the CFCache directory (a null pointer if the
+      // directory has no packed CFC).  The packed CFCs removed with
+      // CFCPack::remove() are kept mapped since pixel Arrays from
+      // them may still be in use.
+      //
+      std::mutex packRegistryMutex;
+      std::map<String, std::shared_ptr<CFCPack> > packRegistry;
+      std::vector<std::shared_ptr<CFCPack> > retiredPacks;
+
+      // Version 1 had no pixeltype and scale (all COMPLEX).
+      const Int packVersion=2;
+
+      String cfName(Int i) {return String("cf")+String::toString(i);}
+      //
+      // The header of the shared memory segment with the decoded
+      // pixels.  It is followed (from sharedHeaderBytes) by the
+      // decoding state of each entry and then by the pixels.  The
+      // segment is made zero-filled, so all the entries are to be
+      // decoded and no process is attached.
+      //
+      const Int maxSharedUsers=512;
+      struct SharedHeader
+      {
+	// Set last by the process that makes the segment.  Includes
+	// the version of this layout.
+	std::atomic<uInt64> magic;
+	Int64 size, nEntries;
+	// The pids of the attached processes (0 for a free slot).
+	std::atomic<Int> users[maxSharedUsers];
+      };
+      const uInt64 sharedMagic=0x4346434c41524202ULL;
+      const Int64 sharedHeaderBytes=4096;
+      static_assert(sizeof(SharedHeader) <= sharedHeaderBytes, "SharedHeader too large");
+      //
+      // The decoding state of an entry: 0 if not decoded, -1 if
+      // decoded, or the pid of the process decoding it.
+      //
+      const Int entryDecoded=-1;
+      // The max. time to wait for another process to set up the segment.
+      const Int sharedWaitSec=10;
+      //
+      // The name of the shared memory segment for the pixel file with
+      // the status st.  A pixel file re-written by pack() gets a new
+      // name.  The same pixel file (e.g. via a symbolic link to the
+      // CFCache directory) gets the same name.
+      //
+      String sharedName(const struct stat& st)
+      {
+	std::ostringstream key, name;
+	key << st.st_dev << ":" << st.st_ino << ":" << st.st_size << ":"
+	    << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec;
+	name << "/libra.cfc." << std::hex << std::hash<std::string>()(key.str())
+	     << std::dec << "." << getuid();
+	return name.str();
+      }
+      // True if the process pid (on this node) is running.
+      Bool isAlive(const Int pid)
+      {
+	return (pid > 0) && ((kill(pid, 0) == 0) || (errno == EPERM));
+      }
+      // The no. of running processes attached to the segment.
+      Int nLiveUsers(const SharedHeader* hdr)
+      {
+	Int n=0;
+	for (Int k=0; k<maxSharedUsers; k++)
+	  if (isAlive(hdr->users[k].load())) n++;
+	return n;
+      }
+      Bool waitFor(const std::function<Bool()>& done)
+      {
+	for (Int i=0; i<sharedWaitSec*100; i++)
+	  {
+	    if (done()) return true;
+	    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	  }
+	return done();
+      }
+      //
+      // Look-up tables to decode the pixels.
+      //
+      const std::vector<Float>& halfTable()
+      {
+	static const std::vector<Float> table=[]()
+	  {
+	    std::vector<Float> t(65536);
+	    for (uInt i=0; i<t.size(); i++) t[i]=SynthesisUtils::halfToFloat((uShort)i);
+	    return t;
+	  }();
+	return table;
+      }
+
+      const std::vector<Complex>& quant8AmpTable()
+      {
+	static const std::vector<Complex> table=[]()
+	  {
+	    std::vector<Complex> t(256, Complex(0.0));
+	    Double logRange=std::log((Double)CFCPack::quant8DynamicRange);
+	    for (uInt k=1; k<t.size(); k++) t[k]=Complex(std::exp(logRange*(255-k)/254.0));
+	    return t;
+	  }();
+	return table;
+      }
+
+      const std::vector<Complex>& quant8PhaseTable()
+      {
+	static const std::vector<Complex> table=[]()
+	  {
+	    std::vector<Complex> t(256);
+	    for (uInt p=0; p<t.size(); p++) t[p]=std::polar(1.0f, (Float)(2.0*C::pi*p/256.0));
+	    return t;
+	  }();
+	return table;
+      }
+      //
+      // The scale of the pixels of a CF, and the pixels encoded as
+      // type (n pixels).
+      //
+      Float pixelScale(const CFCPack::PixelType type, const Complex* pix, const size_t n)
+      {
+	Float scale=0.0;
+	for (size_t i=0; i<n; i++)
+	  if (type == CFCPack::QUANT8) scale=std::max(scale, std::abs(pix[i]));
+	  else scale=std::max(scale, std::max(std::fabs(pix[i].real()), std::fabs(pix[i].imag())));
+	return (scale > 0.0) ? scale : 1.0;
+      }
+
+      void encode(const CFCPack::PixelType type, const Complex* pix, const size_t n,
+		  const Float scale, std::vector<char>& buf)
+      {
+	buf.resize(n*CFCPack::bytesPerPixel(type));
+	if (type == CFCPack::HALF)
+	  {
+	    uShort* h=(uShort *)buf.data();
+	    for (size_t i=0; i<n; i++)
+	      {
+		h[2*i]   = SynthesisUtils::floatToHalf(pix[i].real()/scale);
+		h[2*i+1] = SynthesisUtils::floatToHalf(pix[i].imag()/scale);
+	      }
+	  }
+	else if (type == CFCPack::QUANT8)
+	  {
+	    uChar* q=(uChar *)buf.data();
+	    Double logRange=std::log((Double)CFCPack::quant8DynamicRange);
+	    for (size_t i=0; i<n; i++)
+	      {
+		Double amp=std::abs(pix[i])/scale;
+		Int k=0, p=0;
+		if (amp >= CFCPack::quant8DynamicRange)
+		  {
+		    k=(Int)std::lround(1+254*(1-std::log(amp)/logRange));
+		    k=std::min(std::max(k,1),255);
+		    p=(Int)std::lround(std::arg(pix[i])*256.0/(2.0*C::pi)) & 0xff;
+		  }
+		q[2*i]   = (uChar)k;
+		q[2*i+1] = (uChar)p;
+	      }
+	  }
+	else
+	  std::memcpy(buf.data(), pix, n*sizeof(Complex));
+      }
+
+      void decode(const CFCPack::PixelType type, const char* buf, const size_t n,
+		  const Float scale, Complex* pix)
+      {
+	if (type == CFCPack::HALF)
+	  {
+	    const std::vector<Float>& table=halfTable();
+	    const uShort* h=(const uShort *)buf;
+	    for (size_t i=0; i<n; i++)
+	      pix[i]=Complex(table[h[2*i]]*scale, table[h[2*i+1]]*scale);
+	  }
+	else if (type == CFCPack::QUANT8)
+	  {
+	    const std::vector<Complex>& amp=quant8AmpTable();
+	    const std::vector<Complex>& phase=quant8PhaseTable();
+	    const uChar* q=(const uChar *)buf;
+	    for (size_t i=0; i<n; i++)
+	      pix[i]=amp[q[2*i]]*phase[q[2*i+1]]*scale;
+	  }
+	else
+	  std::memcpy(pix, buf, n*sizeof(Complex));
+      }
+    };
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFCPack::PixelType CFCPack::pixelType(const String& name)
+    {
+      String n(name); n.downcase();
+      if (n == "complex") return COMPLEX;
+      if (n == "half") return HALF;
+      if (n == "quant8") return QUANT8;
+      throw(AipsError("Unknown CF pixel type "+name+" (use complex, half or quant8)"));
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    String CFCPack::pixelTypeName(const PixelType type)
+    {
+      return (type == HALF) ? "half" : ((type == QUANT8) ? "quant8" : "complex");
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Int64 CFCPack::bytesPerPixel(const PixelType type)
+    {
+      return (type == HALF) ? 2*sizeof(uShort) : ((type == QUANT8) ? 2*sizeof(uChar) : sizeof(Complex));
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFCPack::CFCPack(const String& cfcDir):
+      dir_p(cfcDir), pixelType_p(COMPLEX), entries_p(), nameIndex_p(), base_p(NULL), size_p(0),
+      sharedName_p(""), sharedHeader_p(NULL), shared_p(NULL), sharedSize_p(0), sharedSlot_p(-1),
+      sharedOffsets_p()
+    {
+      LogIO log_l(LogOrigin("CFCPack","CFCPack"));
+
+      Record index;
+      {
+	AipsIO indexFile(dir_p+'/'+indexFileName, ByteIO::Old);
+	indexFile >> index;
+      }
+
+      Int version, nCF;
+      Bool bigEndian;
+      Int64 align, pixelBytes;
+      index.get("version", version);
+      index.get("bigendian", bigEndian);
+      index.get("alignment", align);
+      index.get("pixelbytes", pixelBytes);
+      index.get("ncf", nCF);
+      if ((version < 1) || (version > packVersion))
+	log_l << "Unsupported version " << version << " of " << dir_p << "/" << indexFileName
+	      << LogIO::EXCEPTION;
+      if (index.isDefined("pixeltype"))
+	{
+	  Int type; index.get("pixeltype", type);
+	  if ((type < COMPLEX) || (type > QUANT8))
+	    log_l << "Unsupported pixel type " << type << " in " << dir_p << "/" << indexFileName
+		  << LogIO::EXCEPTION;
+	  pixelType_p = (PixelType)type;
+	}
+      Int64 bpp = bytesPerPixel(pixelType_p);
+#if defined(AIPS_LITTLE_ENDIAN)
+      if (bigEndian)
+#else
+      if (!bigEndian)
+#endif
+	log_l << dir_p << "/" << pixelFileName << " was written on a host with a different byte order"
+	      << LogIO::EXCEPTION;
+
+      entries_p.resize(nCF);
+      for (Int i=0; i<nCF; i++)
+	{
+	  const Record& cfRec = index.asRecord(cfName(i));
+	  Entry& e = entries_p[i];
+	  Vector<Int> shape, pixelShape;
+
+	  cfRec.get("name", e.name);
+	  cfRec.get("shape", shape);
+	  cfRec.get("pixelshape", pixelShape);
+	  cfRec.get("offset", e.offset);
+	  e.scale = 1.0;
+	  if (cfRec.isDefined("scale")) cfRec.get("scale", e.scale);
+	  e.shape = IPosition(shape);
+	  e.pixelShape = IPosition(pixelShape);
+	  std::unique_ptr<CoordinateSystem> csys(CoordinateSystem::restore(cfRec, "coordsys"));
+	  if (csys) e.coordSys = *csys;
+	  e.miscInfo = TableRecord(cfRec.asRecord("miscinfo"));
+
+	  if ((e.offset % align) ||
+	      (e.offset + (Int64)(e.pixelShape.product()*bpp) > pixelBytes))
+	    log_l << "Corrupted index for " << e.name << " in " << dir_p << "/" << indexFileName
+		  << LogIO::EXCEPTION;
+	  nameIndex_p[e.name] = i;
+	}
+
+      //
+      // Map the pixels.  The pixel Arrays use the mapping directly
+      // only for COMPLEX.  That mapping is private, so any writes to
+      // such Arrays (there should be none) are never seen in the
+      // file or by other processes.  The encoded pixels are only
+      // read (to decode them), from a read-only shared mapping.
+      //
+      String pixName = dir_p+'/'+pixelFileName;
+      int fd = ::open(pixName.c_str(), O_RDONLY);
+      if (fd < 0)
+	log_l << "Cannot open " << pixName << ": " << strerror(errno) << LogIO::EXCEPTION;
+      struct stat st;
+      if ((fstat(fd, &st) != 0) || (st.st_size != pixelBytes))
+	{
+	  ::close(fd);
+	  log_l << pixName << " is not of the size in the index (" << pixelBytes << " bytes)"
+		<< LogIO::EXCEPTION;
+	}
+      size_p = st.st_size;
+      if (size_p > 0)
+	{
+	  void* addr = (pixelType_p == COMPLEX)
+	    ? mmap(NULL, size_p, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0)
+	    : mmap(NULL, size_p, PROT_READ, MAP_SHARED, fd, 0);
+	  if (addr == MAP_FAILED)
+	    {
+	      ::close(fd);
+	      log_l << "Cannot map " << pixName << ": " << strerror(errno) << LogIO::EXCEPTION;
+	    }
+	  base_p = (char *)addr;
+	}
+      ::close(fd);
+
+      log_l << "Using the packed CFC in " << dir_p << " (" << nCF << " CFs, "
+	    << size_p/(1024*1024) << " MB, " << pixelTypeName(pixelType_p) << " pixels)"
+	    << LogIO::POST;
+
+      // The encoded pixels are decoded into the shared memory
+      // segment as the CFs are used, so the pixel file stays mapped.
+      if ((pixelType_p != COMPLEX) && (size_p > 0) &&
+	  (SynthesisUtils::getenv("CFCache.SHAREDMEM",0) > 0))
+	attachShared_p(st);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFCPack::~CFCPack()
+    {
+      detachShared_p();
+      if (base_p != NULL) munmap(base_p, size_p);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Bool CFCPack::attachShared_p(const struct stat& pixStat)
+    {
+      LogIO log_l(LogOrigin("CFCPack","attachShared"));
+
+      Int64 total=sharedHeaderBytes + entries_p.size()*sizeof(std::atomic<Int>);
+      sharedOffsets_p.resize(entries_p.size());
+      for (size_t i=0; i<entries_p.size(); i++)
+	{
+	  total += (alignment - total%alignment)%alignment;
+	  sharedOffsets_p[i] = total;
+	  total += entries_p[i].pixelShape.product()*sizeof(Complex);
+	}
+      sharedName_p = sharedName(pixStat);
+      const Int pid = getpid();
+      //
+      // A segment that is not usable is removed and made again (once).
+      // It is left behind by processes that crashed while setting it
+      // up, or is of another version of this layout (processes still
+      // using it keep their mapping).
+      //
+      for (Int attempt=0; attempt<2; attempt++)
+	{
+	  int fd = shm_open(sharedName_p.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600);
+	  Bool creator = (fd >= 0);
+	  if (!creator && (errno == EEXIST))
+	    fd = shm_open(sharedName_p.c_str(), O_RDWR, 0);
+	  if (fd < 0)
+	    {
+	      log_l << "Cannot open the shared memory segment " << sharedName_p << ": "
+		    << strerror(errno) << LogIO::WARN;
+	      break;
+	    }
+
+	  String why;
+	  struct stat st;
+	  void* addr = MAP_FAILED;
+	  if (creator && (ftruncate(fd, total) != 0))
+	    why = String("cannot size it: ")+strerror(errno);
+	  // Wait for the process that made the segment to size it.
+	  else if (!creator && !waitFor([&]() {return (fstat(fd, &st) == 0) && (st.st_size != 0);}))
+	    why = "it was not set up";
+	  else if (!creator && (st.st_size != total))
+	    why = "it is not of the size expected";
+	  else if ((addr = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	    why = String("cannot map it: ")+strerror(errno);
+
+	  SharedHeader* hdr = (addr == MAP_FAILED) ? NULL : (SharedHeader*)addr;
+	  if (hdr != NULL)
+	    {
+	      if (creator)
+		{
+		  hdr->size = total;
+		  hdr->nEntries = entries_p.size();
+		  hdr->users[0].store(pid);
+		  sharedSlot_p = 0;
+		  hdr->magic.store(sharedMagic);
+		}
+	      else if (!waitFor([&]() {return hdr->magic.load() != 0;}) ||
+		       (hdr->magic.load() != sharedMagic) || (hdr->size != total) ||
+		       (hdr->nEntries != (Int64)entries_p.size()))
+		why = "it was not set up for this packed CFC";
+	      else
+		{
+		  //
+		  // Take a free slot, or that of a process that is gone
+		  // (e.g. crashed without detaching).
+		  //
+		  for (Int k=0; (k<maxSharedUsers) && (sharedSlot_p < 0); k++)
+		    {
+		      Int user = hdr->users[k].load();
+		      if (((user == 0) || !isAlive(user)) &&
+			  hdr->users[k].compare_exchange_strong(user, pid))
+			sharedSlot_p = k;
+		    }
+		  if (sharedSlot_p < 0) why = "too many processes use it";
+		}
+	    }
+
+	  if (why.empty())
+	    {
+	      //
+	      // The pixel Arrays use a private mapping, so any writes to
+	      // them (there should be none) are never seen by other
+	      // processes.  The pages of the entries decoded (via the
+	      // shared mapping) by this or other processes are seen in
+	      // it, since they are never written to through it.
+	      //
+	      void* pixAddr = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	      ::close(fd);
+	      if (pixAddr != MAP_FAILED)
+		{
+		  shared_p = (char *)pixAddr;
+		  sharedSize_p = total;
+		  sharedHeader_p = hdr;
+		  log_l << "Using the CF pixels in the shared memory segment " << sharedName_p << " ("
+			<< total/(1024*1024) << " MB, " << nLiveUsers(hdr) << " processes)" << LogIO::POST;
+		  return true;
+		}
+	      log_l << "Not using the shared memory segment " << sharedName_p
+		    << " (cannot map it: " << strerror(errno) << ")" << LogIO::WARN;
+	      hdr->users[sharedSlot_p].store(0);
+	      sharedSlot_p = -1;
+	      munmap(hdr, total);
+	      break;
+	    }
+
+	  Bool stale = (!creator && ((hdr == NULL) || (nLiveUsers(hdr) == 0)));
+	  if (hdr != NULL) munmap(hdr, total);
+	  ::close(fd);
+	  if (creator || stale) shm_unlink(sharedName_p.c_str());
+	  log_l << (stale ? "Removed" : "Not using") << " the shared memory segment "
+		<< sharedName_p << " (" << why << ")" << (stale ? LogIO::NORMAL : LogIO::WARN);
+	  if (!stale) break;
+	}
+      sharedOffsets_p.clear();
+      sharedName_p = "";
+      return false;
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Decode the pixels of the entry ndx into the shared memory
+    // segment, unless they are already.  One process decodes each
+    // entry, while the others wait for it.  The entry being decoded
+    // by a process that is gone is decoded again.
+    //
+    void CFCPack::decodeShared_p(const size_t ndx) const
+    {
+      std::atomic<Int>* state =
+	(std::atomic<Int>*)((char *)sharedHeader_p + sharedHeaderBytes) + ndx;
+      const Int pid = getpid();
+      const Entry& e = entries_p[ndx];
+      for (;;)
+	{
+	  Int s = state->load();
+	  if (s == entryDecoded) return;
+	  if (((s == 0) || !isAlive(s)) && state->compare_exchange_strong(s, pid))
+	    {
+	      decode(pixelType_p, base_p + e.offset, e.pixelShape.product(), e.scale,
+		     (Complex *)((char *)sharedHeader_p + sharedOffsets_p[ndx]));
+	      state->store(entryDecoded);
+	      return;
+	    }
+	  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+    }
+    //
+    //-----------------------------------------------------------------------
+    // The last process to detach removes the segment.
+    //
+    void CFCPack::detachShared_p()
+    {
+      if (shared_p != NULL) munmap(shared_p, sharedSize_p);
+      if (sharedHeader_p != NULL)
+	{
+	  SharedHeader* hdr = (SharedHeader*)sharedHeader_p;
+	  hdr->users[sharedSlot_p].store(0);
+	  if (nLiveUsers(hdr) == 0) shm_unlink(sharedName_p.c_str());
+	  munmap(sharedHeader_p, sharedSize_p);
+	}
+      shared_p = NULL;
+      sharedHeader_p = NULL;
+      sharedSlot_p = -1;
+      sharedName_p = "";
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Int CFCPack::nSharedUsers() const
+    {
+      return (sharedHeader_p == NULL) ? 0 : nLiveUsers((const SharedHeader*)sharedHeader_p);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    std::shared_ptr<CFCPack> CFCPack::open(const String& cfcDir)
+    {
+      String key = Path(cfcDir).absoluteName();
+
+      std::lock_guard<std::mutex> lock(packRegistryMutex);
+      auto itr = packRegistry.find(key);
+      if (itr != packRegistry.end()) return itr->second;
+
+      std::shared_ptr<CFCPack> pack;
+      File indexFile(key+'/'+indexFileName);
+      if (indexFile.exists()) pack.reset(new CFCPack(key));
+      packRegistry[key] = pack;
+      return pack;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFCPack::close(const String& cfcDir)
+    {
+      String key = Path(cfcDir).absoluteName();
+
+      std::lock_guard<std::mutex> lock(packRegistryMutex);
+      packRegistry.erase(key);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Bool CFCPack::remove(const String& cfcDir)
+    {
+      String key = Path(cfcDir).absoluteName();
+
+      std::lock_guard<std::mutex> lock(packRegistryMutex);
+      auto itr = packRegistry.find(key);
+      if (itr != packRegistry.end())
+	{
+	  if (itr->second) retiredPacks.push_back(itr->second);
+	  packRegistry.erase(itr);
+	}
+      // Remove the index first: without it, the pixel file is not used.
+      Bool found = (::unlink((key+'/'+indexFileName).c_str()) == 0);
+      ::unlink((key+'/'+pixelFileName).c_str());
+      return found;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    const CFCPack::Entry* CFCPack::find(const String& name) const
+    {
+      auto itr = nameIndex_p.find(name);
+      return (itr == nameIndex_p.end()) ? NULL : &entries_p[itr->second];
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Array<Complex> CFCPack::pixels(const Entry& entry) const
+    {
+      if (entry.pixelShape.product() == 0) return Array<Complex>();
+      if (shared_p != NULL)
+	{
+	  size_t ndx = &entry - entries_p.data();
+	  decodeShared_p(ndx);
+	  return Array<Complex>(entry.pixelShape, (Complex *)(shared_p + sharedOffsets_p[ndx]), SHARE);
+	}
+      if (pixelType_p == COMPLEX)
+	return Array<Complex>(entry.pixelShape, (Complex *)(base_p + entry.offset), SHARE);
+
+      Array<Complex> pix(entry.pixelShape);
+      Bool deleteIt;
+      Complex* pixStore = pix.getStorage(deleteIt);
+      decode(pixelType_p, base_p + entry.offset, pix.nelements(), entry.scale, pixStore);
+      pix.putStorage(pixStore, deleteIt);
+      return pix;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Int64 CFCPack::pack(const String& cfcDir, const std::vector<String>& cfNames,
+			const PixelType type)
+    {
+      LogIO log_l(LogOrigin("CFCPack","pack"));
+      String dir = Path(cfcDir).absoluteName();
+      String pixName = dir+'/'+pixelFileName, indexName = dir+'/'+indexFileName;
+
+      // Any existing packed CFC is replaced.
+      remove(dir);
+
+      Record index;
+      Int64 offset=0, bpp=bytesPerPixel(type);
+      Int nUnfilled=0;
+      std::vector<char> buf;
+      {
+	std::ofstream pixFile((pixName+".tmp").c_str(), std::ios::binary|std::ios::trunc);
+	if (!pixFile.good())
+	  log_l << "Cannot create " << pixName << ".tmp" << LogIO::EXCEPTION;
+
+	const char zeros[alignment]={0};
+	for (uInt i=0; i<cfNames.size(); i++)
+	  {
+	    String name = dir+'/'+cfNames[i];
+	    PagedImage<Complex> thisCF(name);
+
+	    //
+	    // Use the same meta information as CFCache: from the
+	    // Records saved with the CF, or from the image for an
+	    // old-format CFC.
+	    //
+	    IPosition shape;
+	    CoordinateSystem coordSys;
+	    TableRecord miscInfo;
+	    try
+	      {
+		SynthesisUtils::ImageInformation<Complex> imInfo(name);
+		shape = IPosition(imInfo.getImShape());
+		coordSys = imInfo.getCoordinateSystem();
+		miscInfo = imInfo.getMiscInfo();
+	      }
+	    catch (AipsError &)
+	      {
+		shape = thisCF.shape();
+		coordSys = thisCF.coordinates();
+		miscInfo = thisCF.miscInfo();
+	      }
+
+	    Int isFilled=1;
+	    if (miscInfo.isDefined("IsFilled")) miscInfo.get("IsFilled", isFilled);
+	    if (isFilled == 0) nUnfilled++;
+
+	    Array<Complex> pix = thisCF.get();
+	    Int64 pad = (alignment - offset%alignment)%alignment;
+	    pixFile.write(zeros, pad);
+	    offset += pad;
+
+	    Bool deleteIt;
+	    const Complex* pixStore = pix.getStorage(deleteIt);
+	    Float scale = (type == COMPLEX) ? 1.0 : pixelScale(type, pixStore, pix.nelements());
+	    encode(type, pixStore, pix.nelements(), scale, buf);
+	    pix.freeStorage(pixStore, deleteIt);
+	    pixFile.write(buf.data(), buf.size());
+
+	    Record cfRec;
+	    cfRec.define("name", cfNames[i]);
+	    cfRec.define("shape", shape.asVector());
+	    cfRec.define("pixelshape", pix.shape().asVector());
+	    cfRec.define("offset", offset);
+	    cfRec.define("scale", scale);
+	    coordSys.save(cfRec, "coordsys");
+	    cfRec.defineRecord("miscinfo", miscInfo.toRecord());
+	    index.defineRecord(cfName(i), cfRec);
+
+	    offset += pix.nelements()*bpp;
+	    if (!pixFile.good())
+	      log_l << "Error writing " << pixName << ".tmp" << LogIO::EXCEPTION;
+	  }
+      }
+
+#if defined(AIPS_LITTLE_ENDIAN)
+      Bool bigEndian=false;
+#else
+      Bool bigEndian=true;
+#endif
+      index.define("version", packVersion);
+      index.define("bigendian", bigEndian);
+      index.define("alignment", alignment);
+      index.define("pixeltype", (Int)type);
+      index.define("pixelbytes", offset);
+      index.define("ncf", (Int)cfNames.size());
+
+      if (std::rename((pixName+".tmp").c_str(), pixName.c_str()) != 0)
+	log_l << "Cannot rename " << pixName << ".tmp: " << strerror(errno) << LogIO::EXCEPTION;
+      {
+	AipsIO indexFile(indexName+".tmp", ByteIO::New);
+	indexFile << index;
+      }
+      if (std::rename((indexName+".tmp").c_str(), indexName.c_str()) != 0)
+	log_l << "Cannot rename " << indexName << ".tmp: " << strerror(errno) << LogIO::EXCEPTION;
+
+      if (nUnfilled > 0)
+	log_l << nUnfilled << " of the " << cfNames.size() << " CFs packed are not filled yet"
+	      << LogIO::WARN;
+      return offset;
+    }
+  };
+};
@@ -0,0 +1,205 @@
+// -*- C++ -*-
+//# CFCPack.h: Definition of the packed (single file) CF cache
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#ifndef SYNTHESIS_TRANSFORM2_CFCPACK_H
+#define SYNTHESIS_TRANSFORM2_CFCPACK_H
+
+#include <casacore/casa/Arrays/Array.h>
+#include <casacore/casa/Arrays/IPosition.h>
+#include <casacore/casa/BasicSL/String.h>
+#include <casacore/casa/BasicSL/Complex.h>
+#include <casacore/coordinates/Coordinates/CoordinateSystem.h>
+#include <casacore/tables/Tables/TableRecord.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <sys/stat.h>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // The packed CF cache.
+    //
+    // In the directory layout of a CFCache, each CF (CFS_* and
+    // WTCFS_*) is a PagedImage with its meta information in a few
+    // Records.  Loading a CFC therefore opens many small tables.
+    // The packed CFC is two files in the CFCache directory:
+    //
+    //   CFCPack.idx: An AipsIO Record with, for each CF, its name,
+    //                shape, CoordinateSystem, miscInfo and the offset
+    //                of its pixels in CFCPack.pix.
+    //   CFCPack.pix: The pixels of all the CFs, one after the other,
+    //                each starting at a multiple of CFCPack::alignment
+    //                bytes.
+    //
+    // The pixels are stored with one of the PixelTypes:
+    //
+    //   COMPLEX: As Complex (8 bytes per pixel), without loss.
+    //   HALF:    The real and imaginary parts as IEEE half-precision
+    //            floats (4 bytes per pixel), scaled by the largest
+    //            of them in the CF.  The relative error of each
+    //            part is < 5e-4 (the absolute error is < 3e-8 of the
+    //            largest value for parts below 6e-5 of it).
+    //   QUANT8:  The amplitude and phase in a byte each (2 bytes per
+    //            pixel).  The amplitude is quantized logarithmically
+    //            over quant8DynamicRange below the peak of the CF
+    //            (smaller amplitudes are set to 0), with a relative
+    //            error < 3%.  The phase is quantized in steps of
+    //            1.41 deg (the max. error is 0.70 deg).
+    //
+    // The pixel file is memory mapped (private, copy-on-write).  For
+    // COMPLEX, the pixel Arrays returned by pixels() use the mapped
+    // memory directly.  Such Arrays must not be modified in place.
+    // For the other types, pixels() decodes the pixels into a new
+    // Array, so only the CFs in use take 8 bytes per pixel in memory
+    // (see CFResidency).  The mapping is shared by all users of the
+    // same directory in the process (see open()) and is kept for as
+    // long as it is in use.
+    //
+    // The processes on a node that use the same packed CFC share the
+    // pages of the mapped pixel file via the page cache, so COMPLEX
+    // pixels are in memory (and read from the disk) once per node.
+    // With CFCache.SHAREDMEM=1, the pixels of the other types are
+    // also decoded once per node, into a POSIX shared memory segment
+    // (/dev/shm/libra.cfc.*) used by all the processes that use the
+    // packed CFC.  Each CF is decoded into it by the first process
+    // that uses the CF, while the others wait for it.  The segment
+    // records the pids of the processes attached to it, and is
+    // removed when the last of them is done with it.  The slots of
+    // processes that are gone (e.g. crashed) are re-used, the CFs
+    // they were decoding are decoded again, and a segment that was
+    // never set up, or is of another version, is made again.  If the
+    // segment cannot be made or used, the pixels are decoded by each
+    // process as before.
+    //
+    // The packed CFC is made from the directory layout with pack()
+    // (coyote mode=packcf).  The CFs in the directory layout are not
+    // removed.  CFCache, SynthesisUtils::getCFPixels() and
+    // SynthesisUtils::getCFShape() use the packed CFC, if present,
+    // for the CFs found in it.
+    //
+    class CFCPack
+    {
+    public:
+      struct Entry
+      {
+	casacore::String name;
+	// The shape from the meta information of the CF, and the shape
+	// of the pixels as stored (these differ for blank CFs).
+	casacore::IPosition shape, pixelShape;
+	casacore::Int64 offset;
+	// The scale of the stored pixels (1 for COMPLEX).
+	casacore::Float scale;
+	casacore::CoordinateSystem coordSys;
+	casacore::TableRecord miscInfo;
+      };
+
+      enum PixelType {COMPLEX=0, HALF, QUANT8};
+
+      static const casacore::String indexFileName, pixelFileName;
+      static const casacore::Int64 alignment;
+      static const casacore::Float quant8DynamicRange;
+
+      // The PixelType named name ("complex", "half" or "quant8").
+      static PixelType pixelType(const casacore::String& name);
+      static casacore::String pixelTypeName(const PixelType type);
+      static casacore::Int64 bytesPerPixel(const PixelType type);
+
+      ~CFCPack();
+      //
+      // The packed CFC in the CFCache directory cfcDir, or a null
+      // pointer if there is none.  The packed CFC is opened and
+      // mapped once per process.
+      //
+      static std::shared_ptr<CFCPack> open(const casacore::String& cfcDir);
+      //
+      // Write the packed CFC for the CFs named in cfNames, in the
+      // CFCache directory cfcDir, with the pixels stored as type.
+      // The index is written last, so a partially written packed CFC
+      // is never used.  Returns the no. of bytes of pixels written.
+      //
+      static casacore::Int64 pack(const casacore::String& cfcDir,
+				  const std::vector<casacore::String>& cfNames,
+				  const PixelType type=COMPLEX);
+      //
+      // Remove the packed CFC from cfcDir (e.g. when the CFs in the
+      // directory layout are changed).  Returns true if there was
+      // one.
+      //
+      static casacore::Bool remove(const casacore::String& cfcDir);
+      //
+      // Forget the packed CFC opened for cfcDir, so that it is
+      // unmapped (and detached from the shared memory segment) once
+      // the last pointer to it is released.  The pixel Arrays from
+      // it must no longer be in use then.
+      //
+      static void close(const casacore::String& cfcDir);
+
+      const std::vector<Entry>& entries() const {return entries_p;}
+      PixelType getPixelType() const {return pixelType_p;}
+      // The entry for the CF named name, or NULL.
+      const Entry* find(const casacore::String& name) const;
+      // The pixels of the CF.  For COMPLEX, these use the mapped
+      // memory (no copy).  Otherwise they are decoded into a new
+      // Array.
+      casacore::Array<casacore::Complex> pixels(const Entry& entry) const;
+      // The name of the shared memory segment in use (empty if none),
+      // and the no. of processes attached to it.
+      const casacore::String& sharedSegment() const {return sharedName_p;}
+      casacore::Int nSharedUsers() const;
+
+    private:
+      CFCPack(const casacore::String& cfcDir);
+      //
+      // Attach to (or make and fill) the shared memory segment with
+      // the decoded pixels for the pixel file with the status
+      // pixStat.  Returns false if it could not be used.
+      //
+      casacore::Bool attachShared_p(const struct stat& pixStat);
+      void detachShared_p();
+      // Decode the pixels of the entry ndx into the shared memory
+      // segment, if not already done.
+      void decodeShared_p(const size_t ndx) const;
+
+      casacore::String dir_p;
+      PixelType pixelType_p;
+      std::vector<Entry> entries_p;
+      std::map<casacore::String, size_t> nameIndex_p;
+      char* base_p;
+      size_t size_p;
+      // The shared memory segment: its name, its shared and private
+      // mappings, the slot of this process in its header and the
+      // offsets of the pixels of the entries in it.
+      casacore::String sharedName_p;
+      void* sharedHeader_p;
+      char* shared_p;
+      size_t sharedSize_p;
+      casacore::Int sharedSlot_p;
+      std::vector<casacore::Int64> sharedOffsets_p;
+    };
+  };
+};
+#endif
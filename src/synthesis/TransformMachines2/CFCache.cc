@@ -29,6 +29,8 @@
 #include <synthesis/TransformMachines2/CFCache.h>
 #include <synthesis/TransformMachines2/Utils.h>
 #include <synthesis/TransformMachines2/ImageInformation.h>
+#include <synthesis/TransformMachines2/CFCPack.h>
+#include <synthesis/TransformMachines2/CFCacheIndex.h>
 #include <synthesis/TransformMachines2/ParallelFor.h>
 #include <imageanalysis/Utilities/SpectralImageUtil.h>
 #include <casacore/lattices/LEL/LatticeExpr.h>
@@ -37,6 +39,8 @@
 #include <casacore/casa/Utilities/Regex.h>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 // #include <tables/Tables/TableDesc.h>
 // #include <tables/Tables/SetupNewTab.h>
 // #include <tables/Tables/Table.h>
@@ -325,6 +329,18 @@ namespace casa{
   }
   //
   //-----------------------------------------------------------------------
+  //
+  void CFCache::initInMemory()
+  {
+    LogIO log_l(LogOrigin("CFCache2", "initInMemory"));
+
+    Dir = cfPrefix = "";
+    memCache2_p.resize(1);
+    memCacheWt2_p.resize(1);
+    log_l << "CFs will be computed on the fly (no disk cache)" << LogIO::POST;
+  }
+  //
+  //-----------------------------------------------------------------------
   // If the value of selectPAVal > 360.0, dPA is ignored and CFS in
   // the fileNames list are all selected.
   //
@@ -349,6 +365,11 @@ namespace casa{
 	CFCacheTableType cfCacheTable_l;
 
 	std::vector<SynthesisUtils::ImageInformation<Complex>> imInfoList(fileNames.nelements());
+	//
+	// Use the packed CFC, if there is one, for the meta
+	// information and the pixels of the CFs found in it.
+	//
+	std::shared_ptr<CFCPack> pack=CFCPack::open(CFCDir);
 	if (fileNames.nelements() > 0)
 	  {
 	    //
@@ -369,51 +390,90 @@ namespace casa{
 	      ProgressMeter pm(1.0, double(fileNames.nelements()),
 			       "Reading CFCache aux. info.", "","","",true);
 
-	      bool useThreads=false;
+	      //
+	      // The meta information of the CFs is read in threads
+	      // (each CF is a separate set of Tables).  Set
+	      // CFCache.THREADEDLOAD=0 to read it sequentially.
+	      //
+	      bool useThreads=(SynthesisUtils::getenv("CFCache.THREADEDLOAD",1)==1);
+	      //
+	      // The consolidated index of the meta information, used
+	      // for the CFs not modified since it was written.
+	      //
+	      CFCacheIndex cfcIndex(CFCDir);
+	      std::atomic<int> nFromIndex(0);
+	      std::once_flag oldFormatMesg;
+	      // Converting an old-format CF writes Tables.  Do one at a time.
+	      std::mutex convertMutex;
+	      std::mutex excptMutex;
+	      std::exception_ptr excpt=nullptr;
 
 	      auto makeImInfoList = [this,&fileNames,&pm,&CFCDir,&imInfoList,&log_l,
-				     &useThreads](int ibegin, int iend)
+				     &useThreads,&pack,&cfcIndex,&nFromIndex,&oldFormatMesg,
+				     &convertMutex,&excptMutex,&excpt](int ibegin, int iend)
 	      {
-		bool oto=true;
-
 		for (uint i=(uint)ibegin; i < (uint)iend; i++)
 		  {
-		    String cfName=CFCDir+'/'+fileNames[i];
-		    SynthesisUtils::ImageInformation<Complex> imInfo;
 		    try
 		      {
-			imInfo=SynthesisUtils::ImageInformation<Complex>(cfName);
-		      }
-		    catch (AipsError &e)
-		      {
-			//
-			// In case of any error in reading the miscInfo
-			// from a saved record (e.g. if this is an old
-			// CFC where this file does not exist), resort
-			// to getting the miscInfo via the ImageInterfnace.
-			//
-			if (oto)
+			String cfName=CFCDir+'/'+fileNames[i];
+			SynthesisUtils::ImageInformation<Complex> imInfo;
+			const CFCPack::Entry* packEntry = pack ? pack->find(fileNames[i]) : NULL;
+			try
 			  {
-                            std::string mesg="Old-format CFC detected. "
-                              "Successful loading of it will also convert it to the new format.";
-                            if (useThreads) cerr << mesg << endl;
-                            else            log_l << mesg << LogIO::POST;
-			    oto=false;
+			    if (packEntry != NULL)
+			      imInfo=SynthesisUtils::ImageInformation<Complex>(packEntry->shape.asVector(),
+									       packEntry->coordSys,
+									       packEntry->miscInfo);
+			    else if (cfcIndex.get(fileNames[i], imInfo))
+			      nFromIndex++;
+			    else
+			      {
+				imInfo=SynthesisUtils::ImageInformation<Complex>(cfName);
+				cfcIndex.put(fileNames[i], imInfo);
+			      }
+			  }
+			catch (AipsError &e)
+			  {
+			    //
+			    // In case of any error in reading the miscInfo
+			    // from a saved record (e.g. if this is an old
+			    // CFC where this file does not exist), resort
+			    // to getting the miscInfo via the ImageInterfnace.
+			    //
+			    std::call_once(oldFormatMesg, [&useThreads,&log_l]()
+			    {
+			      std::string mesg="Old-format CFC detected. "
+				"Successful loading of it will also convert it to the new format.";
+			      if (useThreads) cerr << mesg << endl;
+			      else            log_l << mesg << LogIO::POST;
+			    });
+
+			    std::lock_guard<std::mutex> lock(convertMutex);
+			    PagedImage<Complex> thisCF(cfName);
+
+			    // Construct ImageInformation from thisCF.
+			    imInfo = SynthesisUtils::ImageInformation<Complex>(thisCF, cfName);
+			    imInfo.save(cfName);
+			    cfcIndex.put(fileNames[i], imInfo);
 			  }
 
-			PagedImage<Complex> thisCF(cfName);
+			imInfoList[i] = imInfo;
+			//imInfoList[i].getMiscInfo().print(cerr);
 
-			// Construct ImageInformation from thisCF.
-			imInfo = SynthesisUtils::ImageInformation<Complex>(thisCF, cfName);
-			imInfo.save(cfName);
+			double  paVal;
+			imInfoList[i].getMiscInfo().get("ParallacticAngle",paVal);
+			paList_p[i]=paVal;
+		      }
+		    catch (...)
+		      {
+			// Exceptions can't leave a thread.  Keep the
+			// first one and re-throw it after the threads
+			// are done.
+			std::lock_guard<std::mutex> lock(excptMutex);
+			if (excpt == nullptr) excpt=std::current_exception();
+			return;
 		      }
-
-		    imInfoList[i] = imInfo;
-		    //imInfoList[i].getMiscInfo().print(cerr);
-
-		    double  paVal;
-		    imInfoList[i].getMiscInfo().get("ParallacticAngle",paVal);
-		    paList_p[i]=paVal;
 
 		    if (!useThreads) pm.update(double(i));
 		  };
@@ -427,6 +487,12 @@ namespace casa{
 	      // for-loop.
 	      //
 	      parallel_for(fileNames.nelements(),makeImInfoList,useThreads);
+	      if (excpt != nullptr) std::rethrow_exception(excpt);
+
+	      if (nFromIndex > 0)
+		log_l << "Meta information of " << nFromIndex << " of the " << fileNames.nelements()
+		      << " CFs read from " << CFCacheIndex::fileName << LogIO::POST;
+	      if (!SynthesisUtils::getenv("CFCache.READONLY",0)) cfcIndex.save();
 	    }
 	    //
 	    // Make the PA-value list unique
@@ -606,17 +672,26 @@ namespace casa{
 		    if (loadPixBuf_p)
 		      {
 			Array<Complex> pixBuf;
-
-			casacore::PagedImage<casacore::Complex> thisCF(CFCDir+'/'+thisCFFileName);
-			pixBuf.assign(thisCF.get());
-
 			Array<Complex> &cfBuf=(*(cfb->getCFCellPtr(fVal, wVal,mVal)->storage_p));
-			//
-			// Fill the cfBuf with the pixel array from the
-			// disk file.  Add it, along with the extracted CF
-			// parameters to the CFBuffer.
-			//
-			cfBuf.assign(pixBuf);
+			const CFCPack::Entry* packEntry = pack ? pack->find(thisCFFileName) : NULL;
+
+			if (packEntry != NULL)
+			  {
+			    // Use the mapped pixels, without a copy.
+			    pixBuf.reference(pack->pixels(*packEntry));
+			    cfBuf.reference(pixBuf);
+			  }
+			else
+			  {
+			    casacore::PagedImage<casacore::Complex> thisCF(CFCDir+'/'+thisCFFileName);
+			    pixBuf.assign(thisCF.get());
+			    //
+			    // Fill the cfBuf with the pixel array from the
+			    // disk file.  Add it, along with the extracted CF
+			    // parameters to the CFBuffer.
+			    //
+			    cfBuf.assign(pixBuf);
+			  }
 		      }
 
 		    //cfb->addCF(&cfBuf,coordSys,fsampling,xSupport,ySupport,fVal,wVal,mVal);
@@ -1120,8 +1195,8 @@ namespace casa{
 	return loadWtImage(avgPB, qualifier, cubeinfo);
       }
 
-    if (Dir.length() == 0) 
-      throw(SynthesisFTMachineError("Cache dir. name null"));
+    // Without a disk cache, there is no avgPB to load.
+    if (Dir.length() == 0) return NOTCACHED;
 
 
     ostringstream name;
@@ -207,6 +207,13 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 			    const casacore::Vector<casacore::String>& cfWtFileNames, 
 			    casacore::Float selectedPA, casacore::Float dPA,
 			    const casacore::Int verbose=1);
+    //
+    // Initialize an empty memory cache, without a disk cache.  The
+    // CFs are then computed on the fly by the FTMachine, and are
+    // never written to (or searched for on) the disk.
+    //
+    void initInMemory();
+    casacore::Bool isInMemory() {return (Dir.length() == 0);};
     void initPolMaps(PolMapType& polMap, PolMapType& conjPolMap);
     inline casacore::Bool OTODone() {return OTODone_p;}
     //
@@ -26,6 +26,9 @@
 
 #include <casacore/coordinates/Coordinates/CoordinateSystem.h>
 #include <synthesis/TransformMachines2/CFCacheHelper.h>
+#include <casacore/casa/BasicSL/Constants.h>
+#include <map>
+#include <set>
 //
 //--------------------------------------------------------------------------
 //
@@ -77,7 +80,8 @@ namespace casa
 			    const bool& psTerm,
 			    const bool& aTerm,
 			    const bool& conjBeams,
-			    ImageInformation<Complex> imInfo)
+			    ImageInformation<Complex> imInfo,
+			    const int& nThreads)
       {
 	//
 	// mode="fillcf" case.  The list of CFs in the CFC are
@@ -85,7 +89,7 @@ namespace casa
 	// information to fill them.  Nothing else other than the
 	// CFC and the list of CFs is necessary.  An already filled
 	// CF (the IsFilled=1 entry in CFS*/miscInfo.rec) will be
-	// left untouched.
+	// left untouched.  The CFs are filled on nThreads threads.
 	//
 	Vector<double> dummyUVScale;
 	Matrix<double> dummyvbFreqSel;
@@ -96,7 +100,7 @@ namespace casa
 				      *cfs2_l,*cfswt2_l,
 				      psTerm,aTerm, conjBeams,
 				      imInfo,
-				      makePersistent);
+				      makePersistent, nThreads);
 
 	// Report some stats.
 	double memUsed=cfs2_l->memUsage();
@@ -285,6 +289,101 @@ namespace casa
 	return std::make_tuple(cfs2_l, cfswt2_l,CFCIsEmptyPtr_l);
       }
 
+      //
+      //--------------------------------------------------------------------------
+      //
+      std::vector<std::string> listCFs(DataBase& db,
+				       CFStore2& cfs,
+				       const double& dpa,
+				       const double& imRefFreq,
+				       const bool& conjBeams)
+      {
+	LogIO log_l(LogOrigin("CFCacheHelper","listCFs"));
+	Quantity dPA(dpa,"deg");
+	//
+	// The largest W-plane needed for each (CFBuffer, frequency
+	// index), in the order they are first needed.  Only the
+	// meta data of the MS (UVW, PA, frequencies) is read.
+	//
+	typedef std::pair<CFBuffer*, Int> CFBFreq;
+	std::vector<CFBFreq> order;
+	std::map<CFBFreq, Int> maxWNdx;
+	Int nNotCached=0;
+
+	vi::VisibilityIterator2& vi2 = *(db.vi2_l);
+	vi::VisBuffer2& vb = *(db.vb_l);
+	for (vi2.originChunks(); vi2.moreChunks(); vi2.nextChunk())
+	  for (vi2.origin(); vi2.more(); vi2.next())
+	    {
+	      CountedPtr<CFBuffer> cfb;
+	      try
+		{
+		  cfb = cfs.getCFBuffer(Quantity(getPA(vb),"rad"), dPA, 0, 0);
+		}
+	      catch (CFNotCached& x)
+		{
+		  nNotCached++;
+		  continue;
+		}
+
+	      Vector<Double> freq = vb.getFrequencies(0);
+	      const Matrix<Double>& uvw = vb.uvw();
+	      const Vector<Bool>& flagRow = vb.flagRow();
+	      Int nRow = vb.nRows(), nChan = freq.nelements();
+
+	      std::vector<Int> fNdx(nChan), conjFNdx(nChan);
+	      for (Int ichan=0; ichan<nChan; ichan++)
+		{
+		  fNdx[ichan] = cfb->nearestFreqNdx(freq[ichan]);
+		  conjFNdx[ichan] = conjBeams ? cfb->nearestFreqNdx(SynthesisUtils::conjFreq(freq[ichan], imRefFreq))
+		    : fNdx[ichan];
+		}
+
+	      for (Int irow=0; irow<nRow; irow++)
+		{
+		  if (flagRow[irow]) continue;
+		  Double wVal = fabs(uvw(2,irow));
+		  for (Int ichan=0; ichan<nChan; ichan++)
+		    {
+		      Int wndx = cfb->nearestWNdx(wVal*freq[ichan]/C::c);
+		      for (Int fndx : {fNdx[ichan], conjFNdx[ichan]})
+			{
+			  CFBFreq key(&(*cfb), fndx);
+			  auto itr = maxWNdx.find(key);
+			  if (itr == maxWNdx.end())
+			    {
+			      maxWNdx[key] = wndx;
+			      order.push_back(key);
+			    }
+			  else if (wndx > itr->second) itr->second = wndx;
+			}
+		    }
+		}
+	    }
+	if (nNotCached > 0)
+	  log_l << nNotCached << " data buffers have no CFs in the CFCache for their PA (dpa = "
+		<< dpa << " deg)" << LogIO::WARN;
+	//
+	// The gridder computes the W-plane index from the W-increment
+	// of the CFBuffer.  So all the W-planes up to the largest one
+	// needed are listed, so that a CFC made of the listed CFs
+	// indexes the same way.
+	//
+	std::vector<std::string> cfNames;
+	std::set<std::string> seen;
+	for (auto& key : order)
+	  {
+	    IPosition shp = key.first->storageShape();
+	    for (Int iW=0; iW<=maxWNdx[key]; iW++)
+	      for (Int iPol=0; iPol<shp(2); iPol++)
+		{
+		  std::string name = key.first->getCFCellPtr(key.second, iW, iPol)->fileName_p;
+		  if (!name.empty() && seen.insert(name).second) cfNames.push_back(name);
+		}
+	  }
+	return cfNames;
+      }
+
     }; // End SynthesisUtils namespace
   }; // End refim namespace
 }; // End casa namespace
@@ -65,7 +65,8 @@ namespace casa
 			    const bool& psTerm,
 			    const bool& aTerm,
 			    const bool& conjBeams,
-			    ImageInformation<Complex> imInfo=ImageInformation<Complex>());
+			    ImageInformation<Complex> imInfo=ImageInformation<Complex>(),
+			    const int& nThreads=1);
 
       void makeCFS_inmemory(DataBase& db,
 			    CountedPtr<casa::refim::CFStore2> cfs2_l,
@@ -89,6 +90,22 @@ namespace casa
 		   const double& pa,
 		   const double& dpa,
 		   const CFCHelperCodes whichCFS=MAKE_BOTHCFS);
+
+      //
+      // The names of the CFs in cfs needed to grid the data selected
+      // in db, in the order they are first needed.  The CFs are
+      // looked up the way the gridder does (the PA of the data with
+      // the tolerance dpa in degrees, and the frequency and W of
+      // each channel), and include all the Mueller elements and all
+      // the W-planes up to the largest one needed.  With conjBeams,
+      // the CFs for the conjugate frequency about imRefFreq (Hz) are
+      // included as well.
+      //
+      std::vector<std::string> listCFs(DataBase& db,
+				       CFStore2& cfs,
+				       const double& dpa,
+				       const double& imRefFreq,
+				       const bool& conjBeams);
     }
   }
 }
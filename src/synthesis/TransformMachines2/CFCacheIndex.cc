@@ -0,0 +1,207 @@
+// -*- C++ -*-
+//# CFCacheIndex.cc: Implementation of the consolidated meta information index of a CFCache
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#include <synthesis/TransformMachines2/CFCacheIndex.h>
+#include <casacore/casa/IO/AipsIO.h>
+#include <casacore/casa/OS/File.h>
+#include <casacore/casa/Logging/LogIO.h>
+#include <casacore/casa/Exceptions/Error.h>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace casacore;
+namespace casa{
+  namespace refim{
+
+    const String CFCacheIndex::fileName("CFCache.idx");
+
+    namespace
+    {
+      const Int indexVersion=1;
+
+      String cfKey(Int i) {return String("cf")+String::toString(i);}
+
+      // The modification time (ns) of path, or 0 if it does not exist.
+      Int64 mtime(const String& path)
+      {
+	struct stat st;
+	if (::stat(path.c_str(), &st) != 0) return 0;
+	return (Int64)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec;
+      }
+    };
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFCacheIndex::CFCacheIndex(const String& cfcDir):
+      dir_p(cfcDir), entries_p(), mutex_p(), dirty_p(false)
+    {
+      if (!File(dir_p+'/'+fileName).exists()) return;
+
+      try
+	{
+	  Record index;
+	  {
+	    AipsIO indexFile(dir_p+'/'+fileName, ByteIO::Old);
+	    indexFile >> index;
+	  }
+	  Int version, nCF;
+	  index.get("version", version);
+	  if (version != indexVersion) return;
+	  index.get("ncf", nCF);
+
+	  for (Int i=0; i<nCF; i++)
+	    {
+	      const Record& cfRec = index.asRecord(cfKey(i));
+	      String name;
+	      Entry e;
+	      cfRec.get("name", name);
+	      cfRec.get("shape", e.shape);
+	      cfRec.get("stamp", e.stamp);
+	      std::unique_ptr<CoordinateSystem> csys(CoordinateSystem::restore(cfRec, "coordsys"));
+	      if (csys) e.coordSys = *csys;
+	      e.miscInfo = TableRecord(cfRec.asRecord("miscinfo"));
+	      entries_p[name] = e;
+	    }
+	}
+      catch (AipsError &x)
+	{
+	  LogIO log_l(LogOrigin("CFCacheIndex","CFCacheIndex"));
+	  log_l << "Ignoring the unreadable " << dir_p << "/" << fileName << ": "
+		<< x.getMesg() << LogIO::WARN;
+	  entries_p.clear();
+	}
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Int64 CFCacheIndex::stamp_p(const String& cfName) const
+    {
+      // The Records are saved as Tables (a directory with table.dat)
+      // in new CFs, or as AipsIO files.
+      Int64 stamp=0;
+      for (auto rec : {"cgrid_csys.rec", "iminfo.rec", "miscInfo.rec"})
+	{
+	  String path = dir_p+'/'+cfName+'/'+rec;
+	  stamp = std::max(stamp, mtime(path));
+	  stamp = std::max(stamp, mtime(path+"/table.dat"));
+	}
+      return stamp;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Bool CFCacheIndex::get(const String& cfName,
+			   SynthesisUtils::ImageInformation<Complex>& imInfo)
+    {
+      const Entry* e;
+      {
+	std::lock_guard<std::mutex> lock(mutex_p);
+	auto itr = entries_p.find(cfName);
+	if (itr == entries_p.end()) return false;
+	e = &(itr->second);
+      }
+      // Entries are never erased, so e remains valid.
+      Int64 stamp = stamp_p(cfName);
+      if ((stamp == 0) || (stamp != e->stamp)) return false;
+
+      imInfo = SynthesisUtils::ImageInformation<Complex>(e->shape, e->coordSys, e->miscInfo);
+      return true;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFCacheIndex::put(const String& cfName,
+			   SynthesisUtils::ImageInformation<Complex>& imInfo)
+    {
+      Entry e;
+      e.shape = imInfo.getImShape();
+      e.coordSys = imInfo.getCoordinateSystem();
+      e.miscInfo = imInfo.getMiscInfo();
+      e.stamp = stamp_p(cfName);
+      if (e.stamp == 0) return;
+
+      std::lock_guard<std::mutex> lock(mutex_p);
+      auto itr = entries_p.find(cfName);
+      if (itr == entries_p.end()) entries_p[cfName] = e;
+      else
+	{
+	  itr->second.shape.reference(e.shape);
+	  itr->second.coordSys = e.coordSys;
+	  itr->second.miscInfo = e.miscInfo;
+	  itr->second.stamp = e.stamp;
+	}
+      dirty_p = true;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Bool CFCacheIndex::save()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      if (!dirty_p) return true;
+
+      Record index;
+      Int i=0;
+      for (auto& x : entries_p)
+	{
+	  Record cfRec;
+	  cfRec.define("name", x.first);
+	  cfRec.define("shape", x.second.shape);
+	  cfRec.define("stamp", x.second.stamp);
+	  x.second.coordSys.save(cfRec, "coordsys");
+	  cfRec.defineRecord("miscinfo", x.second.miscInfo.toRecord());
+	  index.defineRecord(cfKey(i++), cfRec);
+	}
+      index.define("version", indexVersion);
+      index.define("ncf", i);
+
+      //
+      // Write a temporary file and rename it, so that concurrent
+      // readers (e.g. other processes) never see a partial index.
+      //
+      String name = dir_p+'/'+fileName, tmpName = name+".tmp."+String::toString(getpid());
+      try
+	{
+	  {
+	    AipsIO indexFile(tmpName, ByteIO::New);
+	    indexFile << index;
+	  }
+	  if (std::rename(tmpName.c_str(), name.c_str()) != 0)
+	    throw(AipsError("Cannot rename "+tmpName));
+	}
+      catch (AipsError &x)
+	{
+	  ::unlink(tmpName.c_str());
+	  LogIO log_l(LogOrigin("CFCacheIndex","save"));
+	  log_l << "Could not write " << name << ": " << x.getMesg() << LogIO::NORMAL;
+	  return false;
+	}
+      dirty_p = false;
+      return true;
+    }
+  };
+};
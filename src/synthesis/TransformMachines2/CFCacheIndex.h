@@ -0,0 +1,101 @@
+// -*- C++ -*-
+//# CFCacheIndex.h: Definition of the consolidated meta information index of a CFCache
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#ifndef SYNTHESIS_TRANSFORM2_CFCACHEINDEX_H
+#define SYNTHESIS_TRANSFORM2_CFCACHEINDEX_H
+
+#include <synthesis/TransformMachines2/ImageInformation.h>
+#include <casacore/casa/BasicSL/String.h>
+#include <casacore/casa/BasicSL/Complex.h>
+#include <casacore/coordinates/Coordinates/CoordinateSystem.h>
+#include <casacore/tables/Tables/TableRecord.h>
+
+#include <map>
+#include <mutex>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // The meta information of all the CFs of a CFCache, in one file
+    // (CFCache.idx, an AipsIO Record) in the CFCache directory.
+    //
+    // The meta information of each CF is otherwise read from three
+    // Records (cgrid_csys.rec, iminfo.rec and miscInfo.rec) saved as
+    // Tables in the CF, which makes loading a large CFCache slow.  An
+    // entry in the index is used only if the files of these Records
+    // have not been modified since the entry was made (e.g. by
+    // coyote mode=fillcf).  Otherwise the Records are read as before
+    // and the index is updated.
+    //
+    // get() and put() can be called from multiple threads, but not
+    // for the same CF at the same time.
+    //
+    class CFCacheIndex
+    {
+    public:
+      static const casacore::String fileName;
+
+      // Load the index from the CFCache directory cfcDir, if there is
+      // one (an unreadable index is ignored).
+      CFCacheIndex(const casacore::String& cfcDir);
+      //
+      // The meta information of the CF named cfName from the index.
+      // Returns false if the CF is not in the index, or is modified
+      // since.
+      //
+      casacore::Bool get(const casacore::String& cfName,
+			 SynthesisUtils::ImageInformation<casacore::Complex>& imInfo);
+      //
+      // Add (or replace) the meta information of the CF named cfName.
+      //
+      void put(const casacore::String& cfName,
+	       SynthesisUtils::ImageInformation<casacore::Complex>& imInfo);
+      //
+      // Write the index, if entries were added by put().  Returns
+      // false if it could not be written (e.g. for a read-only
+      // CFCache).
+      //
+      casacore::Bool save();
+
+    private:
+      struct Entry
+      {
+	casacore::Vector<casacore::Int> shape;
+	casacore::CoordinateSystem coordSys;
+	casacore::TableRecord miscInfo;
+	casacore::Int64 stamp;
+      };
+      // The latest modification time (ns) of the meta information
+      // files of the CF.
+      casacore::Int64 stamp_p(const casacore::String& cfName) const;
+
+      casacore::String dir_p;
+      std::map<casacore::String, Entry> entries_p;
+      std::mutex mutex_p;
+      casacore::Bool dirty_p;
+    };
+  };
+};
+#endif
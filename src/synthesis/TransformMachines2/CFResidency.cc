@@ -0,0 +1,198 @@
+// -*- C++ -*-
+//# CFResidency.cc: Implementation of the residency manager for lazily loaded CFs
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#include <synthesis/TransformMachines2/CFResidency.h>
+#include <synthesis/TransformMachines2/CFRotationCache.h>
+#include <casacore/casa/Logging/LogIO.h>
+
+using namespace casacore;
+namespace casa{
+  namespace refim{
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFResidency::CFResidency():
+      mutex_p(), lru_p(), index_p(), budget_p(0), epoch_p(0), warned_p(false)
+    {
+      stats_p = Stats{0,0,0,0,0,0};
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFResidency& CFResidency::instance()
+    {
+      static CFResidency residency;
+      return residency;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::setBudget(const Int64& bytes)
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      budget_p = (bytes > 0) ? bytes : 0;
+      warned_p = false;
+      if (budget_p > 0)
+	{
+	  LogIO log_l(LogOrigin("CFResidency","setBudget"));
+	  log_l << "Memory budget for the CF pixels: " << budget_p/(1024*1024) << " MB" << LogIO::POST;
+	}
+      evict_p();
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    Int64 CFResidency::getBudget()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      return budget_p;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::newEpoch()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      epoch_p++;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::touch(const CountedPtr<CFCell>& cell)
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      stats_p.hits++;
+      auto itr = index_p.find(&(*cell));
+      if (itr != index_p.end())
+	{
+	  itr->second->epoch = epoch_p;
+	  lru_p.splice(lru_p.begin(), lru_p, itr->second);
+	}
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::admit(const CountedPtr<CFCell>& cell, const Quantity& pa)
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      stats_p.misses++;
+      // Without a budget, there is nothing to track.
+      if (budget_p == 0) return;
+
+      Int64 bytes = cell->getStorage()->nelements()*sizeof(Complex);
+      auto itr = index_p.find(&(*cell));
+      if (itr != index_p.end())
+	{
+	  // Loaded again after its pixels were released outside of
+	  // this class (e.g. CFBuffer::clear()).
+	  stats_p.residentBytes -= itr->second->bytes;
+	  stats_p.nResident--;
+	  lru_p.erase(itr->second);
+	  index_p.erase(itr);
+	}
+
+      lru_p.push_front(Entry{cell, bytes, pa, epoch_p});
+      index_p[&(*cell)] = lru_p.begin();
+      stats_p.residentBytes += bytes;
+      stats_p.nResident++;
+      if (stats_p.residentBytes > stats_p.peakBytes) stats_p.peakBytes = stats_p.residentBytes;
+
+      evict_p();
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Release the least recently used CFCells till the pixels in
+    // memory are within the budget.  The caller holds the mutex.
+    //
+    void CFResidency::evict_p()
+    {
+      if (budget_p == 0) return;
+
+      auto itr = lru_p.end();
+      while ((stats_p.residentBytes > budget_p) && (itr != lru_p.begin()))
+	{
+	  --itr;
+	  // The CFCells in use in this epoch, and all more recently
+	  // used ones, are kept.
+	  if (itr->epoch == epoch_p) break;
+
+	  // If only this class refers to the CFCell (its CFStore is
+	  // gone), just forget it.
+	  if (itr->cell.nrefs() > 1)
+	    {
+	      //
+	      // Release the pixels.  The CFCell is loaded again from
+	      // the CFCache when next used, and must then be rotated
+	      // from the PA of the CF on the disk.
+	      //
+	      itr->cell->getStorage()->resize();
+	      itr->cell->pa_p = itr->pa;
+	      CFRotationCache::instance().forget(&(*(itr->cell)));
+	      stats_p.evictions++;
+	    }
+	  stats_p.residentBytes -= itr->bytes;
+	  stats_p.nResident--;
+	  index_p.erase(&(*(itr->cell)));
+	  itr = lru_p.erase(itr);
+	}
+
+      if ((stats_p.residentBytes > budget_p) && !warned_p)
+	{
+	  LogIO log_l(LogOrigin("CFResidency","evict"));
+	  log_l << "The CFs in use need " << stats_p.residentBytes/(1024*1024)
+		<< " MB, which is more than the memory budget for the CF pixels ("
+		<< budget_p/(1024*1024) << " MB)" << LogIO::WARN;
+	  warned_p = true;
+	}
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      lru_p.clear();
+      index_p.clear();
+      stats_p.residentBytes = stats_p.nResident = 0;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFResidency::Stats CFResidency::getStats()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      return stats_p;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFResidency::resetStats()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      stats_p.hits = stats_p.misses = stats_p.evictions = 0;
+      stats_p.peakBytes = stats_p.residentBytes;
+    }
+  };
+};
@@ -0,0 +1,123 @@
+// -*- C++ -*-
+//# CFResidency.h: Definition of the residency manager for lazily loaded CFs
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#ifndef SYNTHESIS_TRANSFORM2_CFRESIDENCY_H
+#define SYNTHESIS_TRANSFORM2_CFRESIDENCY_H
+
+#include <synthesis/TransformMachines/CFCell.h>
+#include <casacore/casa/Utilities/CountedPtr.h>
+#include <casacore/casa/Quanta/Quantum.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // Residency of the pixels of lazily loaded CFs.
+    //
+    // With lazy fill (CFCache.LAZYFILL=1), the pixels of a CFCell are
+    // loaded from the CFCache when first used and, without this
+    // class, are then kept for the life of the CFStore.  CFResidency
+    // keeps the total size of the pixels loaded this way within a
+    // budget, by releasing the pixels of the least recently used
+    // CFCells.  A released CFCell is loaded again (and rotated for the
+    // PA, if required) when next used.  The CFCells with the pixels in
+    // memory for other reasons (e.g. loaded eagerly, or made in
+    // memory) are never released.
+    //
+    // The pixels of the CFCells used since the last call to
+    // newEpoch() are never released, since the gridders hold pointers
+    // to them (e.g. in the AWVisResampler grid plan).  The budget can
+    // therefore be exceeded by the CFs used for a single VisBuffer.
+    //
+    // There is one instance per process.  A budget of 0 (the
+    // default) is no limit.
+    //
+    class CFResidency
+    {
+    public:
+      struct Stats
+      {
+	casacore::Int64 hits, misses, evictions;
+	casacore::Int64 residentBytes, peakBytes, nResident;
+      };
+
+      static CFResidency& instance();
+
+      // The budget in bytes (0 for no limit).
+      void setBudget(const casacore::Int64& bytes);
+      casacore::Int64 getBudget();
+      //
+      // Start a new epoch.  Call this before the CFs for a new set of
+      // data are looked up.
+      //
+      void newEpoch();
+      //
+      // Record the use of the already loaded CFCell.
+      //
+      void touch(const casacore::CountedPtr<CFCell>& cell);
+      //
+      // Record the CFCell just loaded from the CFCache, and release
+      // other CFCells if the budget is exceeded.  pa is the PA of the
+      // CF as loaded (before any rotation).
+      //
+      void admit(const casacore::CountedPtr<CFCell>& cell, const casacore::Quantity& pa);
+      //
+      // Forget all the CFCells (their pixels are left as they are).
+      //
+      void clear();
+
+      Stats getStats();
+      void resetStats();
+
+    private:
+      struct Entry
+      {
+	casacore::CountedPtr<CFCell> cell;
+	casacore::Int64 bytes;
+	casacore::Quantity pa;
+	casacore::uInt64 epoch;
+      };
+
+      CFResidency();
+      CFResidency(const CFResidency&)=delete;
+      CFResidency& operator=(const CFResidency&)=delete;
+
+      void evict_p();
+
+      std::mutex mutex_p;
+      // Most recently used first.
+      std::list<Entry> lru_p;
+      std::unordered_map<const CFCell*, std::list<Entry>::iterator> index_p;
+      casacore::Int64 budget_p;
+      casacore::uInt64 epoch_p;
+      casacore::Bool warned_p;
+      Stats stats_p;
+    };
+  };
+};
+#endif
@@ -0,0 +1,211 @@
+// -*- C++ -*-
+//# CFRotationCache.cc: Implementation of the cache of CFs rotated for the PA
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#include <synthesis/TransformMachines2/CFRotationCache.h>
+#include <synthesis/TransformMachines2/Utils.h>
+#include <casacore/casa/Logging/LogIO.h>
+#include <casacore/casa/Exceptions/Error.h>
+#include <cmath>
+#include <iterator>
+
+using namespace casacore;
+namespace casa{
+  namespace refim{
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFRotationCache::CFRotationCache():
+      mutex_p(), lru_p(), cells_p(), budget_p(0)
+    {
+      budget_p = (Int64)(SynthesisUtils::getenv("CFCache.ROTCACHEMB",512.0)*1024.0*1024.0);
+      stats_p = Stats{0,0,0,0,0,0};
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFRotationCache& CFRotationCache::instance()
+    {
+      static CFRotationCache cache;
+      return cache;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::setBudget(const Int64& bytes)
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      budget_p = (bytes > 0) ? bytes : 0;
+      evict_p();
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::rotate(const Double& pa, const CountedPtr<CFCell>& cell,
+				 const Double& paTolerance)
+    {
+      if (paTolerance <= 0.0) return;
+
+      std::lock_guard<std::mutex> lock(mutex_p);
+      if (fabs(cell->pa_p.getValue("rad") - pa) <= paTolerance)
+	{
+	  stats_p.unchanged++;
+	  return;
+	}
+
+      //
+      // The first time the CF is rotated, its current pixels are
+      // the un-rotated ones.
+      //
+      auto citr = cells_p.find(&(*cell));
+      if (citr == cells_p.end())
+	{
+	  CellEntry ce;
+	  ce.cell = cell;
+	  ce.base.reference(*(cell->getStorage()));
+	  ce.basePA = cell->pa_p;
+	  citr = cells_p.emplace(&(*cell), ce).first;
+	}
+      CellEntry& ce = citr->second;
+
+      Int64 bin = (Int64)std::llround(pa/paTolerance);
+      Double binPA = bin*paTolerance;
+      Double dPA = ce.basePA.getValue("rad") - binPA;
+
+      auto bitr = ce.bins.find(bin);
+      if (bitr != ce.bins.end())
+	{
+	  stats_p.hits++;
+	  lru_p.splice(lru_p.begin(), lru_p, bitr->second);
+	  cell->getStorage()->reference(bitr->second->pixels);
+	}
+      else if (fabs(dPA) <= paTolerance)
+	{
+	  // The un-rotated CF is good for this bin.
+	  stats_p.hits++;
+	  cell->getStorage()->reference(ce.base);
+	}
+      else
+	{
+	  stats_p.misses++;
+	  LogIO log_l(LogOrigin("CFRotationCache", "rotate"));
+	  Array<Complex> rotated;
+	  // rotateComplexArray() sets the reference pixel of the
+	  // CoordinateSystem.  Leave the one of the CFCell as it is.
+	  CoordinateSystem cs(cell->coordSys_p);
+	  try
+	    {
+	      SynthesisUtils::rotateComplexArray(log_l, ce.base, cs, rotated, dPA);
+	    }
+	  catch (AipsError &x)
+	    {
+	      log_l << x.getMesg() << LogIO::EXCEPTION;
+	    }
+
+	  Int64 bytes = rotated.nelements()*sizeof(Complex);
+	  lru_p.push_front(Rotated{&(*cell), bin, rotated, bytes});
+	  ce.bins[bin] = lru_p.begin();
+	  stats_p.cachedBytes += bytes;
+	  if (stats_p.cachedBytes > stats_p.peakBytes) stats_p.peakBytes = stats_p.cachedBytes;
+
+	  cell->getStorage()->reference(rotated);
+	  evict_p();
+	}
+      cell->pa_p = Quantity(binPA, "rad");
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Drop the least recently used rotated CFs till the cache is
+    // within the budget, and forget the CFCells no longer in use
+    // elsewhere.  The caller holds the mutex.
+    //
+    void CFRotationCache::evict_p()
+    {
+      while ((stats_p.cachedBytes > budget_p) && !lru_p.empty())
+	{
+	  Rotated& r = lru_p.back();
+	  cells_p[r.cell].bins.erase(r.bin);
+	  stats_p.cachedBytes -= r.bytes;
+	  stats_p.evictions++;
+	  lru_p.pop_back();
+	}
+
+      for (auto itr = cells_p.begin(); itr != cells_p.end(); )
+	{
+	  auto next = std::next(itr);
+	  if (itr->second.cell.nrefs() == 1) forget_p(itr->first);
+	  itr = next;
+	}
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::forget_p(const CFCell* cell)
+    {
+      auto citr = cells_p.find(cell);
+      if (citr == cells_p.end()) return;
+      for (auto& b : citr->second.bins)
+	{
+	  stats_p.cachedBytes -= b.second->bytes;
+	  lru_p.erase(b.second);
+	}
+      cells_p.erase(citr);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::forget(const CFCell* cell)
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      forget_p(cell);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      lru_p.clear();
+      cells_p.clear();
+      stats_p.cachedBytes = 0;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    CFRotationCache::Stats CFRotationCache::getStats()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      return stats_p;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void CFRotationCache::resetStats()
+    {
+      std::lock_guard<std::mutex> lock(mutex_p);
+      stats_p.unchanged = stats_p.hits = stats_p.misses = stats_p.evictions = 0;
+      stats_p.peakBytes = stats_p.cachedBytes;
+    }
+  };
+};
@@ -0,0 +1,128 @@
+// -*- C++ -*-
+//# CFRotationCache.h: Definition of the cache of CFs rotated for the PA
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#ifndef SYNTHESIS_TRANSFORM2_CFROTATIONCACHE_H
+#define SYNTHESIS_TRANSFORM2_CFROTATIONCACHE_H
+
+#include <synthesis/TransformMachines/CFCell.h>
+#include <casacore/casa/Arrays/Array.h>
+#include <casacore/casa/Utilities/CountedPtr.h>
+#include <casacore/casa/Quanta/Quantum.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // Cache of the CFs rotated for the parallactic angle (PA).
+    //
+    // A CF that is not rotationally symmetric is rotated to the PA of
+    // the data when the two differ by more than the PA tolerance.  The
+    // PA is binned in steps of the tolerance, and the CF is rotated
+    // (from its un-rotated pixels) to the center of the bin.  The
+    // rotated pixels are kept, so each (CF, PA bin) is rotated once
+    // for as long as it stays in the cache.  The cache is bounded in
+    // size (the least recently used rotated CFs are dropped first).
+    //
+    // The un-rotated pixels of each CF rotated at least once are also
+    // kept (not counted in the size of the cache).  These are
+    // released with forget(), which CFResidency calls when it
+    // releases the CF.
+    //
+    // There is one instance per process.  The size of the cache (in
+    // MB) is set with CFCache.ROTCACHEMB (default 512).
+    //
+    class CFRotationCache
+    {
+    public:
+      struct Stats
+      {
+	// Lookups within the tolerance of the current PA of the CF.
+	casacore::Int64 unchanged;
+	// Lookups that found the rotated CF in the cache, and those
+	// that rotated it.
+	casacore::Int64 hits, misses, evictions;
+	casacore::Int64 cachedBytes, peakBytes;
+      };
+
+      static CFRotationCache& instance();
+
+      // Set the size of the cache in bytes.
+      void setBudget(const casacore::Int64& bytes);
+      //
+      // Make the pixels of cell those of the CF rotated to the PA bin
+      // of pa (in radians).  Does nothing if the CF is already within
+      // paTolerance of pa, or if paTolerance <= 0.
+      //
+      void rotate(const casacore::Double& pa, const casacore::CountedPtr<CFCell>& cell,
+		  const casacore::Double& paTolerance);
+      //
+      // Drop the rotated and un-rotated pixels kept for the CF.
+      //
+      void forget(const CFCell* cell);
+      // Drop all the CFs.  A CF rotated before this is then rotated
+      // from its rotated pixels.
+      void clear();
+
+      Stats getStats();
+      void resetStats();
+
+    private:
+      struct Rotated
+      {
+	const CFCell* cell;
+	casacore::Int64 bin;
+	casacore::Array<casacore::Complex> pixels;
+	casacore::Int64 bytes;
+      };
+      struct CellEntry
+      {
+	casacore::CountedPtr<CFCell> cell;
+	// The un-rotated pixels and their PA.
+	casacore::Array<casacore::Complex> base;
+	casacore::Quantity basePA;
+	std::map<casacore::Int64, std::list<Rotated>::iterator> bins;
+      };
+
+      CFRotationCache();
+      CFRotationCache(const CFRotationCache&)=delete;
+      CFRotationCache& operator=(const CFRotationCache&)=delete;
+
+      void evict_p();
+      void forget_p(const CFCell* cell);
+
+      std::mutex mutex_p;
+      // Most recently used first.
+      std::list<Rotated> lru_p;
+      std::unordered_map<const CFCell*, CellEntry> cells_p;
+      casacore::Int64 budget_p;
+      Stats stats_p;
+    };
+  };
+};
+#endif
@@ -37,17 +37,30 @@
 
 #include <hpg/hpg.hpp>
 // #include <hpg/hpg_indexing.hpp>
+#include <algorithm>
+#include <vector>
 using namespace hpg;
 //
 // -------------------------------------------------------------------------------
-// A class to hold a fixed number of visibilities (as hpg::VisData).
-// Fractions of the input source, e.g., casa::VisBuffer that don't fit
-// in the container are held intenrally in a spill-over (SOBuf) buffer
-// and transferred to the main buffer before the start of the next
-// iteration of filling new data.  Client code can use a combination
-// of isFull() and isEmpty() methods to consume partially filled
-// buffer and copy from the SOBuf to the main buffer using the
-// moveSOBuf() method.
+// A class to hold visibilities (as hpg::VisData) in a ring of
+// buckets of a fixed capacity.  The buckets are allocated once (see
+// resize()) and reused.  Visibilities that don't fit in the bucket
+// being filled roll over to the next bucket in the ring.  The ring
+// grows by a bucket only if all the buckets are full, e.g., when a
+// single casa::VisBuffer has more visibilities than a bucket.
+//
+// The bucket at the head of the ring is the one to be sent to HPG
+// next.  Client code checks isFull() to send the full buckets as they
+// become available, sends the bucket via std::move(vbbBuf()), and
+// calls release() to re-arm the storage and advance the head.  The
+// next bucket in the ring is filled while the earlier one is being
+// consumed by HPG.  At the end of the data, the client sends the
+// buckets for as long as isEmpty() is false.
+//
+// HPG takes ownership of the vector that is sent.  release()
+// therefore reserves new storage for the bucket that was sent (a
+// single allocation of the bucket capacity).  All other appends are
+// made in the pre-allocated storage.
 //
 // The ordering in the input data is preserved.
 //
@@ -55,79 +68,53 @@ template <unsigned NCorr>
 class HPGVisBufferBucket
 {
 public:
-  HPGVisBufferBucket(const int& nVis)
-    :VBB_p(), VBB_SOBuf_p(),nFills_p(0), rowCounter_p(0), nVis_p(nVis)
+  HPGVisBufferBucket(const int& nVis, const int& nBuckets=2)
+    :ring_p(std::max(nBuckets,2)), head_p(0), fill_p(0), nFills_p(0), nVis_p(nVis)
   {
     resize(nVis_p);
   };
 
   // Move constructor
   HPGVisBufferBucket(HPGVisBufferBucket&& other) noexcept
-  {
-    VBB_p=std::move(other.VBB_p);
-    //    VBB_SOBuf_p = std::move(other.VBB_SOBuf_p);
-    //    cout << "HPGVBB.move constructor\n";
-  }
-
-  // assignment operator
-  // HPGVisBufferBucket& operator=(const HPGVisBufferBucket& rhs)
-  // {
-  //   cout << "HPGVBB.copy operator\n";
-  //   if (&rhs != this) {
-  //     HPGVisBufferBucket tmp(rhs);
-  //     this->hpgVB_p.swap(rhs);
-  //   }
-  //   return *this;
-  // }
-  
-  // move assignment operator
-  std::vector<hpg::VisData<NCorr>>& operator=(HPGVisBufferBucket&& rhs) noexcept
-  {
-    //    cout << "HPGVBB.move= operator\n";
-    std::swap(VBB_p, rhs.VBB_p);
-    //    this->VBB_SOBuf_p.swap(rhs.VBB_SOBuf_p);
-    return VBB_p;
-  }
-
+    :ring_p(std::move(other.ring_p)), head_p(other.head_p), fill_p(other.fill_p),
+     nFills_p(other.nFills_p), nVis_p(other.nVis_p)
+  {}
 
   ~HPGVisBufferBucket() {};
   //
   // -------------------------------------------------------------------------------
   //
-  //  template <unsigned NCorr>
-  inline
-  void create_blank_vis_data_vector(const unsigned nPol,
-				    const unsigned nChan,
-				    const unsigned nRow)
-  {
-    (void)nPol; // Just to remove an annoying compile-time warning ("unused parameter").
-    assert(nPol == NCorr);
-    VBB_p.resize(nRow*nChan);
-  }
-  //
-  // -------------------------------------------------------------------------------
+  // Set the capacity of the buckets to n (if n != -1) and empty all
+  // the buckets.
   //
   inline int resize(const int n=-1)
   {
-    if (n != -1)
+    if (n != -1) nVis_p=n;
+
+    for (auto& b : ring_p)
       {
-	VBB_p.resize(n);
-	nVis_p=n;
+	b.clear();
+	b.reserve(nVis_p);
       }
-
-    rowCounter_p=0;
+    head_p=fill_p=0;
     nFills_p=0;
 
-    return VBB_p.size();
+    return nVis_p;
   }
   //
   // -------------------------------------------------------------------------------
   //
+  // The capacity of a bucket.
   inline unsigned size()
-  {return VBB_p.size();}
+  {return nVis_p;}
 
+  // No. of visibilities in the bucket at the head of the ring.
   inline unsigned counter()
-  {return rowCounter_p;}
+  {return ring_p[head_p].size();}
+
+  // No. of buckets in the ring.
+  inline unsigned nBuckets()
+  {return ring_p.size();}
 
   inline unsigned filledUnits()
   {return nFills_p;}
@@ -135,74 +122,63 @@ public:
   inline unsigned incrementFills()
   {return nFills_p++;}
 
+  // Is the bucket at the head of the ring full?
   inline bool isFull()
-  {return (rowCounter_p >= size());}
+  {return (counter() >= size());}
 
+  // Is the bucket at the head of the ring empty?  If so, all the
+  // buckets are empty.
   inline bool isEmpty() {return counter()==0;}
-
-  // Copy the contents of the over flow buffer
-  inline uint moveSOBuf()
-  {
-    uint n=vbbSOBuf().size();
-
-    // vbbBuf().insert(vbbBuf().begin(),
-    // 		    std::make_move_iterator(vbbSOBuf().begin()),
-    //                 std::make_move_iterator(vbbSOBuf().end()));
-    // //    vbbSOBuf().erase(vbbSOBuf().begin(),vbbSOBuf().end());
-    // rowCounter_p=n;
-
-    // cout << "moveSOBuf(): "
-    // 	 << nVis_p << " "
-    // 	 << size() << " "
-    // 	 << vbbSOBuf().size() << " "
-    // 	 << counter() << " "
-    // 	 << endl;
-    for (auto v : vbbSOBuf()) append(v);
-    vbbSOBuf().resize(0);
-
-    return n;
-  }
-
-  inline unsigned reset()
+  //
+  // -------------------------------------------------------------------------------
+  //
+  inline bool append(const hpg::VisData<NCorr>& visData)
   {
-    // Resize internal storage. Copy the overflow buffer to the main storage.
-    resize(nVis_p);
-    moveSOBuf();
-    return size();
-  }
+    if (ring_p[fill_p].size() >= nVis_p)
+      {
+	fill_p = (fill_p+1) % ring_p.size();
+	if (fill_p == head_p)
+	  {
+	    // All buckets are full.  Add a bucket to the ring, before
+	    // the head.
+	    ring_p.insert(ring_p.begin()+fill_p, std::vector<hpg::VisData<NCorr>>());
+	    ring_p[fill_p].reserve(nVis_p);
+	    head_p++;
+	  }
+      }
+    ring_p[fill_p].push_back(visData);
 
-  inline unsigned shrink()
-  {
-    if (rowCounter_p > 0) VBB_p.resize(rowCounter_p);
-    return VBB_p.size();
+    return isFull();
   }
   //
   // -------------------------------------------------------------------------------
   //
-  inline bool append(const hpg::VisData<NCorr>& visData)
+  // Re-arm the bucket at the head of the ring after its contents were
+  // sent (moved out), and advance the head to the next filled bucket.
+  //
+  inline unsigned release()
   {
-    //    cout << size() << " " << rowCounter_p << " " << VBB_SOBuf_p.size() << " " << isFull() << endl;
-    if (isFull())
-      VBB_SOBuf_p.push_back(visData); //!! Optimization required?
-    else
-      VBB_p[rowCounter_p++]=visData;
+    std::vector<hpg::VisData<NCorr>>& b = ring_p[head_p];
+    b.clear();
+    if (b.capacity() < nVis_p) b.reserve(nVis_p);
+
+    if (head_p != fill_p) head_p = (head_p+1) % ring_p.size();
 
-    return rowCounter_p==size();
+    return counter();
   }
   //
   // -------------------------------------------------------------------------------
   //
-  std::vector<hpg::VisData<NCorr>>& vbbBuf() {return VBB_p;}
-  std::vector<hpg::VisData<NCorr>>& vbbSOBuf() {return VBB_SOBuf_p;}
+  // The bucket at the head of the ring.
+  std::vector<hpg::VisData<NCorr>>& vbbBuf() {return ring_p[head_p];}
   //
   // -------------------------------------------------------------------------------
   //
 
-  std::vector<hpg::VisData<NCorr>> VBB_p;  
-  std::vector<hpg::VisData<NCorr>> VBB_SOBuf_p;  
 private:
+  std::vector<std::vector<hpg::VisData<NCorr>>> ring_p;
+  unsigned int head_p, fill_p;
   unsigned int nFills_p;
-  unsigned int rowCounter_p;
   uint nVis_p;
 };
 #endif
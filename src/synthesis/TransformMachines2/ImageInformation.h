@@ -106,6 +106,21 @@ namespace casa
 	  isCached_p=true;
 	};
 	//------------------------------------------------------------------------
+	// Constructor from the meta information already at hand (e.g. from
+	// the index of a packed CFC).  This creates an in-memory-only
+	// object.
+	ImageInformation(const casacore::Vector<int>& imShape,
+			 const casacore::CoordinateSystem& csys,
+			 const casacore::TableRecord& miscInfo):
+	  cimg_p(NULL),
+	  coordSysFileName("cgrid_csys.rec"),coordSysKey("cgrid_csys"),
+	  imInfoFileName("iminfo.rec"), imShapeKey("imshape"),
+	  miscInfoFileName("miscInfo.rec"), miscInfoKey("miscInfo"),
+	  coordSysRecFileName(), imInfoRecFileName(), miscInfoRecFileName(),
+	  inMemory_p(true),isPersistent_p(false),isCached_p(true),
+	  imShape_p(imShape.copy()), coordinateSystem_p(csys), miscInfo_p(miscInfo)
+	{};
+	//------------------------------------------------------------------------
 	// Constructor to write and read records saved by this class
 	// This creates an in-memory-only object
 	ImageInformation(casacore::ImageInterface<T>& cimg):
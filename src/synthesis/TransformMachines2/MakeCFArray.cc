@@ -90,7 +90,7 @@ namespace casa{
       if (convFuncV->shape().product() == 0)
 	{
 	  Array<Complex>  tt=SynthesisUtils::getCFPixels(cfb.getCFCacheDir(), cfcell->fileName_p);
-	  cfcell->setStorage(tt);
+	  cfcell->referenceStorage(tt);
 
 	  //cerr << (cfcell->isRotationallySymmetric_p?"o":"+");
 
@@ -168,7 +168,9 @@ namespace casa{
 			     CountedPtr<casa::refim::CFStore2> cfs2_l,
 			     const int& vbSpw_l, const double& spwRefFreq,
 			     const int& nDataPol,
-			     Vector<Int>& wNdxList, Vector<Int>& spwNdxList)
+			     Vector<Int>& wNdxList, Vector<Int>& spwNdxList,
+			     const double& maxW,
+			     const double& minPA, const double& maxPA)
     {
       bool reloadCFs = SynthesisUtils::needNewCF(cachedVBSpw_p, vbSpw_l, user_wprojplanes, wbAWP,initialized_p==false);
       hpg::CFSimpleIndexer cfsi({1,false},{1,false},{1,true},{1,true}, 1);
@@ -192,7 +194,20 @@ namespace casa{
 	  Quantity dPA(360.0,"deg");
 	  int a1=0, a2=0;
 
-	  casa::refim::CFBuffer& cfb_l = *cfs2_l->getCFBuffer(paList[0], dPA, ant1List(a1), ant2List(a2));
+	  // Use the CFs for the PA nearest to the middle of the PA range
+	  // of the data [minPA, maxPA] (radians), if one is given.
+	  // These are not rotated.
+	  int paNdx=0;
+	  if ((maxPA >= minPA) && (paList.nelements() > 1))
+	    {
+	      double midPA=(minPA+maxPA)/2.0;
+	      for (unsigned i=1; i<paList.nelements(); i++)
+		if (fabs(paList[i].getValue("rad")-midPA) < fabs(paList[paNdx].getValue("rad")-midPA))
+		  paNdx=i;
+	      dPA=Quantity(1e-6,"rad");
+	    }
+
+	  casa::refim::CFBuffer& cfb_l = *cfs2_l->getCFBuffer(paList[paNdx], dPA, ant1List(a1), ant2List(a2));
 
 	  //double spwRefFreq_l =spwRefFreq;//vb_l->subtableColumns().spectralWindow().refFrequency()(vbSpw_l);
 
@@ -202,6 +217,15 @@ namespace casa{
 					     vbSpw_l,
 					     wNdxList, spwNdxList);
 
+	  // Only the W-planes up to the max. |w| of the data are used
+	  // by the gridder (the W-plane of a sample is
+	  // CFBuffer::nearestWNdx()).
+	  if ((maxW >= 0.0) && (wNdxList.nelements() > 1))
+	    {
+	      unsigned nWCF_l=cfb_l.nearestWNdx(maxW)+1;
+	      if (nWCF_l < wNdxList.nelements()) wNdxList.resize(nWCF_l, true);
+	    }
+
 	  double vbPA=360.0;
 	  int nGridPol = skyImage.shape()[2];
 	  //	  int nDataPol  = vb_l->flagCube().shape()[0];
@@ -97,7 +97,9 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 		   CountedPtr<casa::refim::CFStore2> cfs2_l,
 		   const int& vbSpw_l, const double& spwRefFreq,
 		   const int& nDataPol,
-		   Vector<Int>& wNdxList, Vector<Int>& spwNdxList);
+		   Vector<Int>& wNdxList, Vector<Int>& spwNdxList,
+		   const double& maxW=-1.0,
+		   const double& minPA=0.0, const double& maxPA=-1.0);
       //
       //--------------------------------------------------------------------------------------------
       //
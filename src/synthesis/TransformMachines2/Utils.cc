@@ -33,6 +33,7 @@
 #include <casacore/measures/Measures/MeasTable.h>
 #include <synthesis/TransformMachines2/Utils.h>
 #include <synthesis/TransformMachines2/ImageInformation.h>
+#include <synthesis/TransformMachines2/CFCPack.h>
 #include <synthesis/TransformMachines/StokesImageUtil.h>
 #include <casacore/casa/Utilities/Assert.h>
 #include <casacore/casa/Arrays/Vector.h>
@@ -47,6 +48,9 @@
 #include <casacore/lattices/LatticeMath/LatticeFFT.h>
 #include <casacore/casa/System/Aipsrc.h>
 #include <msvis/MSVis/VisibilityIterator2.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
 using namespace std;
 using namespace casacore;
@@ -825,6 +829,45 @@ namespace casa
     template 
     String SynthesisUtils::getenv(const char *name, const String defaultVal);
     
+    //
+    //---------------------------------------------------------------
+    // IEEE half-precision floats, rounded to the nearest even.
+    //
+    uShort SynthesisUtils::floatToHalf(const Float f)
+    {
+      uInt x; std::memcpy(&x, &f, sizeof(x));
+      uInt sign=(x>>16)&0x8000, fexp=(x>>23)&0xff, mant=x&0x7fffff;
+      Int exp=(Int)fexp-127+15;
+
+      if (fexp == 0xff) return sign|0x7c00|(mant ? 0x200 : 0);
+      if (exp >= 31) return sign|0x7c00;
+      if (exp <= 0)
+	{
+	  // Sub-normal, or too small for a half.
+	  if (exp < -10) return sign;
+	  mant |= 0x800000;
+	  uInt shift=14-exp, h=mant>>shift,
+	    rem=mant&((1u<<shift)-1), halfway=1u<<(shift-1);
+	  if ((rem > halfway) || ((rem == halfway) && (h&1))) h++;
+	  return sign|h;
+	}
+      uInt h=((uInt)exp<<10)|(mant>>13), rem=mant&0x1fff;
+      // A carry into the exponent is the correct rounding.
+      if ((rem > 0x1000) || ((rem == 0x1000) && (h&1))) h++;
+      return sign|h;
+    }
+
+    Float SynthesisUtils::halfToFloat(const uShort h)
+    {
+      uInt exp=(h>>10)&0x1f, mant=h&0x3ff;
+      Float f;
+      if (exp == 0) f=std::ldexp((Float)mant, -24);
+      else if (exp == 31) f=mant ? std::numeric_limits<Float>::quiet_NaN()
+			    : std::numeric_limits<Float>::infinity();
+      else f=std::ldexp((Float)(mant|0x400), (Int)exp-25);
+      return (h&0x8000) ? -f : f;
+    }
+
     Float SynthesisUtils::libreSpheroidal(Float nu) 
     {
       Double top, bot, nuend, delnusq;
@@ -1208,6 +1251,12 @@ namespace casa
     {
       try
 	{
+	  // Use the packed CFC, if there is one.
+	  std::shared_ptr<CFCPack> pack=CFCPack::open(Dir);
+	  const CFCPack::Entry* entry;
+	  if (pack && ((entry=pack->find(fileName)) != NULL))
+	    return pack->pixels(*entry);
+
 	  casacore::PagedImage<casacore::Complex> thisCF(Dir+'/'+fileName);
 	  return thisCF.get();
 	}
@@ -1240,6 +1289,11 @@ namespace casa
     {
       try
 	{
+	  std::shared_ptr<CFCPack> pack=CFCPack::open(Dir);
+	  const CFCPack::Entry* entry;
+	  if (pack && ((entry=pack->find(fileName)) != NULL))
+	    return entry->pixelShape;
+
 	  casacore::PagedImage<casacore::Complex> thisCF(Dir+'/'+fileName);
 	  return thisCF.shape();
 	}
@@ -1402,15 +1456,20 @@ namespace casa
       
       if (fabs(dPA) > fabs(rotAngleIncr))
 	{
-	  casacore::Array<TT> inData;
+	  casacore::Array<TT> inData, outData;
 	  //inData.assign(*baseCFC.getStorage());
 	  //dPA = baseCFCPA-actualPA;
 	  dPA = currentCFPA-actualPA;
-	  inData.assign(*cfc.getStorage());
+	  //
+	  // The CF storage may be shared with the CF loaded from the
+	  // disk (e.g. mapped from a packed CFC).  So rotate into a new
+	  // array rather than in-place.
+	  //
+	  inData.reference(*cfc.getStorage());
 	  try
 	    {
 	      SynthesisUtils::rotateComplexArray(log_l, inData, cfc.coordSys_p,
-						 *cfc.getStorage(),
+						 outData,
 						 dPA);//,"LINEAR");
 	      // currentCFPA-actualPA);//,"LINEAR");
 	    }
@@ -1418,6 +1477,7 @@ namespace casa
 	    {
 	      log_l << x.getMesg() << LogIO::EXCEPTION;
 	    }
+	  cfc.getStorage()->reference(outData);
 	  cfc.pa_p=Quantity(actualPA, "rad");
 	}
     };
@@ -1687,20 +1747,12 @@ namespace casa
 	}
       catch (AipsError &er)
 	{
-	  try
-	    {
-	      // Read record stored as a Table with write access
-	      Table tab(fileName, Table::Update);
-	      rr=tab.keywordSet().asRecord("record");
-	      return rr;
-	    }
-	  catch (AipsError &er2)
-	    {
-	      // Read record stored as a Table with read-only access
-	      Table tab(fileName, Table::Old);
-	      rr=tab.keywordSet().asRecord("record");
-	      return rr;
-	    }
+	  // Read record stored as a Table.  Read-only access is
+	  // sufficient, and takes only a read lock (the CFs may be read
+	  // by multiple threads, and processes, at the same time).
+	  Table tab(fileName, Table::Old);
+	  rr=tab.keywordSet().asRecord("record");
+	  return rr;
 	}
     }
     void SynthesisUtils::writeRecord(const casacore::String& fileName,
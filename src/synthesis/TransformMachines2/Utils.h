@@ -140,6 +140,10 @@ namespace casa
       
       template <class T>
       T getenv(const char *name, const T defaultVal);
+      // IEEE half-precision floats (e.g. for the packed CFs), rounded
+      // to the nearest even.
+      casacore::uShort floatToHalf(const casacore::Float f);
+      casacore::Float halfToFloat(const casacore::uShort h);
       casacore::Float libreSpheroidal(casacore::Float nu);
       casacore::Double getRefFreq(const VisBuffer2& vb);
       void makeFTCoordSys(const casacore::CoordinateSystem& coords,
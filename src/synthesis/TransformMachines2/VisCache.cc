@@ -0,0 +1,771 @@
+// -*- C++ -*-
+//# VisCache.cc: Implementation of the VisCache class
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#include <synthesis/TransformMachines2/VisCache.h>
+#include <synthesis/TransformMachines2/Utils.h>
+#include <libracore/MSMetaCache.h>
+#include <msvis/MSVis/VisibilityIterator2.h>
+#include <casacore/casa/IO/AipsIO.h>
+#include <casacore/casa/OS/File.h>
+#include <casacore/casa/OS/Directory.h>
+#include <casacore/casa/OS/Path.h>
+#include <casacore/casa/Logging/LogIO.h>
+#include <casacore/casa/Exceptions/Error.h>
+#include <casacore/measures/Measures/MFrequency.h>
+
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace casacore;
+namespace casa{
+  namespace refim{
+    namespace
+    {
+      //
+      // Write the Array a to f.  Returns false on failure.
+      //
+      template <class T>
+      bool put(FILE* f, const Array<T>& a)
+      {
+	Bool del;
+	const T* d=a.getStorage(del);
+	size_t n=std::fwrite(d, sizeof(T), a.nelements(), f);
+	a.freeStorage(d, del);
+	return n == a.nelements();
+      }
+      //
+      // Make a reference the Array a to the memory at p, with the
+      // given shape.  Returns the position after it.
+      //
+      template <class A>
+      char* share(char* p, A& a, const IPosition& shape)
+      {
+	typedef typename A::value_type T;
+	a.takeStorage(shape, (T *)p, SHARE);
+	return p + shape.product()*sizeof(T);
+      }
+      //
+      // The values of all IEEE half-precision floats.
+      //
+      const std::vector<Float>& halfTable()
+      {
+	static const std::vector<Float> table=[]()
+	  {
+	    std::vector<Float> t(65536);
+	    for (uInt i=0; i<t.size(); i++) t[i]=SynthesisUtils::halfToFloat((uShort)i);
+	    return t;
+	  }();
+	return table;
+      }
+      //
+      // The (longitude, latitude) in radians of the directions.
+      //
+      Matrix<Double> toAngles(const Vector<MDirection>& dir)
+      {
+	Matrix<Double> angles(2, dir.nelements());
+	for (uInt i=0; i<dir.nelements(); i++)
+	  angles.column(i) = dir(i).getAngle("rad").getValue();
+	return angles;
+      }
+      Vector<MDirection> toDirections(const Matrix<Double>& angles, const Int type)
+      {
+	MDirection::Ref ref((MDirection::Types)type);
+	Vector<MDirection> dir(angles.ncolumn());
+	for (uInt i=0; i<dir.nelements(); i++)
+	  dir(i) = MDirection(MVDirection(angles(0,i), angles(1,i)), ref);
+	return dir;
+      }
+      Vector<Int> toInt(const Vector<Stokes::StokesTypes>& s)
+      {
+	Vector<Int> v(s.nelements());
+	for (uInt i=0; i<s.nelements(); i++) v(i)=(Int)s(i);
+	return v;
+      }
+      Vector<Stokes::StokesTypes> toStokes(const Vector<Int>& v)
+      {
+	Vector<Stokes::StokesTypes> s(v.nelements());
+	for (uInt i=0; i<v.nelements(); i++) s(i)=(Stokes::StokesTypes)v(i);
+	return s;
+      }
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    VisCacheBuffer::VisCacheBuffer(vi::ViImplementation2 *vii)
+      : vi::VisBufferImpl2(vii, vi::VisBufferOptions(vi::VbWritable | vi::VbRekeyable)),
+	cubes_p(), hasWtSp_p(false), phaseCenter_p(), direction1_p(), direction2_p(),
+	polFrame_p(0), polId_p(0), freqs_p(), chanNumbers_p(), feedPa_p(), azel_p(), parang_p()
+    {}
+    //
+    //-----------------------------------------------------------------------
+    //
+    const Cube<Float>& VisCacheBuffer::weightSpectrum() const
+    {
+      if (weightSpectrum_p.nelements() == 0) notCached_p("WEIGHT_SPECTRUM");
+      return weightSpectrum_p;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    const Vector<Double>& VisCacheBuffer::getFrequencies(Int rowInBuffer, Int frame) const
+    {
+      checkRow_p(rowInBuffer);
+      auto f = freqs_p.find(frame);
+      if (f == freqs_p.end())
+	notCached_p("the frequencies for frame "+std::to_string(frame));
+      return f->second;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    const Vector<Float>& VisCacheBuffer::feedPa(Double time) const
+    {
+      auto pa = feedPa_p.find(time);
+      if (pa == feedPa_p.end())
+	notCached_p("the feed PA for time "+std::to_string(time));
+      return pa->second;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCacheBuffer::checkRow_p(Int row) const
+    {
+      if ((row != 0) &&
+	  ((spectralWindows()(row) != spectralWindows()(0)) || (time()(row) != time()(0))))
+	notCached_p("the frequencies for row "+std::to_string(row));
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCacheBuffer::notCached_p(const std::string& what) const
+    {
+      throw(AipsError("VisCacheBuffer: "+what+" is not in the visibility cache"));
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    const Cube<Complex>& VisCacheBuffer::cube_p(const FTMachine::Type col) const
+    {
+      auto c = cubes_p.find(col);
+      if (c == cubes_p.end())
+	notCached_p("the visibility cube for data column type "+std::to_string((Int)col));
+      return c->second;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCacheBuffer::setCube_p(const FTMachine::Type col, const Cube<Complex>& value)
+    {
+      cubes_p[col].assign(value);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCacheBuffer::setCube_p(const FTMachine::Type col, const Complex& value)
+    {
+      Cube<Complex>& c = cubes_p[col];
+      IPosition shape(3, nCorrelations(), nChannels(), nRows());
+      if (c.shape() != shape) c.resize(shape);
+      c = value;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    VisCache::VisCache(const std::string& dir, const std::string& msName,
+		       const std::string& selection,
+		       const FTMachine::Type dataCol,
+		       const bool half)
+      : dir_p(dir), msName_p(msName), key_p(), dataCol_p(dataCol), half_p(half), mode_p(WRITE),
+	failed_p(false), newChunk_p(true), lockFd_p(-1), nVB_p(0),
+	entries_p(), files_p(), offsets_p(), maps_p()
+    {
+      LogIO log_l(LogOrigin("VisCache","VisCache"));
+      key_p = Path(msName).absoluteName()+"|"+std::to_string(libracore::msStamp(msName))
+	+"|"+selection+"|"+std::to_string((int)dataCol_p)+"|"+(half_p ? "half" : "float");
+
+      if (load_p())
+	{
+	  mode_p = READ;
+	  log_l << "Reading the visibility data from the cache " << dir_p
+		<< " (" << entries_p.size() << " VisBuffers)" << LogIO::POST;
+	  return;
+	}
+
+      try
+	{
+	  Directory d(dir_p);
+	  if (!d.exists()) d.create();
+	}
+      catch (AipsError& x)
+	{
+	  fail_p(x.getMesg());
+	  return;
+	}
+      std::string err=lock_p();
+      if (err != "")
+	{
+	  fail_p(err);
+	  return;
+	}
+      // Remove the temporary files of an interrupted pass.
+      clean_p(false);
+      log_l << "Writing the visibility data to the cache " << dir_p
+	    << (half_p ? " (half precision)" : "") << LogIO::POST;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    VisCache::~VisCache()
+    {
+      if (mode_p == WRITE)
+	{
+	  // An unfinished pass.
+	  for (auto& f : files_p) std::fclose(f.second);
+	  files_p.clear();
+	  if (lockFd_p >= 0) clean_p(false);
+	  unlock_p();
+	}
+      for (auto& m : maps_p) munmap(m.second.first, m.second.second);
+    }
+    //
+    //-----------------------------------------------------------------------
+    // The no. of bytes of the VisBuffer of entry e in the data file.
+    // The arrays are in the order of the size of their elements, so
+    // that each is aligned, and the VisBuffer is padded to 8 bytes.
+    //
+    Int64 VisCache::bytes_p(const Entry& e) const
+    {
+      Int64 n=e.nRows, m=(Int64)e.nCorr*e.nChan*e.nRows;
+      Int64 b = 11*n*sizeof(Double) + n*sizeof(rownr_t)       // uvw, times, exposure, directions, row IDs
+	+ (half_p ? 0 : m*sizeof(Complex))                    // visibilities
+	+ 12*n*sizeof(Int) + 2*n*sizeof(Float)                // IDs, feed PA
+	+ (2*e.nCorr + e.nChan)*n*sizeof(Float)               // weight, sigma, imaging weight
+	+ (e.hasWtSp ? m*sizeof(Float) : 0)                   // weight spectrum
+	+ (half_p ? 2*m*sizeof(uShort) : 0)                   // visibilities
+	+ m*sizeof(Bool) + n*sizeof(Bool);                    // flags
+      return ((b + 7)/8)*8;
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Load the index, if there is one with the key of this cache, and
+    // map the data files.
+    //
+    bool VisCache::load_p()
+    {
+      std::string name=dir_p+'/'+indexFileName();
+      if (!File(name).exists()) return false;
+      try
+	{
+	  Record index;
+	  {
+	    AipsIO indexFile(name, ByteIO::Old);
+	    indexFile >> index;
+	  }
+	  Int v, nVB;
+	  String key;
+	  index.get("version", v);
+	  if (v != version) return false;
+	  index.get("key", key);
+	  if (key != key_p) return false;
+
+	  index.get("nvb", nVB);
+	  entries_p.resize(nVB);
+	  Int chunk=-1, subchunk=0;
+	  for (Int i=0; i<nVB; i++)
+	    {
+	      const Record& r=index.subRecord("vb"+std::to_string(i));
+	      Entry& e=entries_p[i];
+	      r.get("spw", e.spw);
+	      r.get("field", e.field);
+	      r.get("msid", e.msId);
+	      r.get("nrows", e.nRows);
+	      r.get("nchan", e.nChan);
+	      r.get("ncorr", e.nCorr);
+	      r.get("time", e.time);
+	      r.get("offset", e.offset);
+	      r.get("wtsp", e.hasWtSp);
+	      r.get("newchunk", e.newChunk);
+	      e.meta=r.subRecord("meta");
+	      if (e.newChunk) {chunk++; subchunk=0;}
+	      e.chunk=chunk;
+	      e.subchunk=subchunk++;
+	    }
+
+	  // Map the data files now, so that a cache written later (by
+	  // another process) does not change them.
+	  for (auto& e : entries_p)
+	    {
+	      map_p(e.spw);
+	      if ((size_t)(e.offset + bytes_p(e)) > maps_p[e.spw].second)
+		throw(AipsError("The visibility cache "+dataFileName(e.spw)+" is truncated"));
+	    }
+	}
+      catch (AipsError& x)
+	{
+	  LogIO log_l(LogOrigin("VisCache","load"));
+	  log_l << "Ignoring the unreadable visibility cache " << dir_p << ": " << x.getMesg() << LogIO::WARN;
+	  entries_p.clear();
+	  for (auto& m : maps_p) munmap(m.second.first, m.second.second);
+	  maps_p.clear();
+	  return false;
+	}
+      return true;
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Lock the cache for writing.  Returns the error, or "".
+    //
+    std::string VisCache::lock_p()
+    {
+      std::string name=dir_p+'/'+lockFileName();
+      lockFd_p = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+      if (lockFd_p < 0)
+	return "Cannot open "+name+": "+std::strerror(errno);
+      if (flock(lockFd_p, LOCK_EX | LOCK_NB) != 0)
+	{
+	  std::string err = (errno == EWOULDBLOCK)
+	    ? std::string("it is being written by another process")
+	    : "Cannot lock "+name+": "+std::strerror(errno);
+	  ::close(lockFd_p);
+	  lockFd_p = -1;
+	  return err;
+	}
+      return "";
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::unlock_p()
+    {
+      if (lockFd_p < 0) return;
+      flock(lockFd_p, LOCK_UN);
+      ::close(lockFd_p);
+      lockFd_p = -1;
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Remove the temporary data files.  With all=true, also remove
+    // the data files of the SPWs not in the cache just written.  Must
+    // be called with the lock.
+    //
+    void VisCache::clean_p(const bool all)
+    {
+      DIR* d=opendir(dir_p.c_str());
+      if (d == NULL) return;
+      std::vector<std::string> names;
+      while (struct dirent* e=readdir(d))
+	{
+	  std::string n(e->d_name);
+	  if ((n.compare(0, 3, "spw") != 0) || (n.size() < 8)) continue;
+	  std::string tmp=".dat"+tmpSuffix();
+	  if ((n.size() > tmp.size()) && (n.compare(n.size()-tmp.size(), tmp.size(), tmp) == 0))
+	    names.push_back(n);
+	  else if (all && (n.compare(n.size()-4, 4, ".dat") == 0))
+	    {
+	      bool current=false;
+	      for (auto& o : offsets_p)
+		current = current || (n == "spw"+std::to_string(o.first)+".dat");
+	      if (!current) names.push_back(n);
+	    }
+	}
+      closedir(d);
+      for (auto& n : names) ::unlink((dir_p+'/'+n).c_str());
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::close_p()
+    {
+      bool ok=true;
+      for (auto& f : files_p)
+	ok = (std::fclose(f.second) == 0) && ok;
+      files_p.clear();
+      if (!ok && !failed_p) fail_p("Cannot write the data files");
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::fail_p(const std::string& mesg)
+    {
+      LogIO log_l(LogOrigin("VisCache","write"));
+      log_l << "Could not write the visibility cache " << dir_p << ": " << mesg
+	    << ".  The data is not cached." << LogIO::WARN;
+      failed_p = true;
+      for (auto& f : files_p) std::fclose(f.second);
+      files_p.clear();
+      if (lockFd_p >= 0) clean_p(false);
+      unlock_p();
+    }
+    //
+    //-----------------------------------------------------------------------
+    // Map the data file of the SPW.  The mapping is private, so that
+    // the VisCacheBuffer arrays that reference it can be modified.
+    //
+    void VisCache::map_p(const Int spw)
+    {
+      if (maps_p.find(spw) != maps_p.end()) return;
+
+      std::string name = dataFileName(spw);
+      int fd = ::open(name.c_str(), O_RDONLY);
+      if (fd < 0) throw(AipsError("Cannot open "+name+": "+std::strerror(errno)));
+      struct stat st;
+      void* addr = MAP_FAILED;
+      if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (addr == MAP_FAILED) throw(AipsError("Cannot map "+name));
+      // The VisBuffers are read in the order in which they are in the file.
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      maps_p.emplace(spw, std::make_pair(addr, (size_t)st.st_size));
+    }
+    //
+    //-----------------------------------------------------------------------
+    // The visibilities of the data column.
+    //
+    Cube<Complex> VisCache::visCube_p(const vi::VisBuffer2& vb) const
+    {
+      if (dataCol_p==FTMachine::CORRECTED)   return vb.visCubeCorrected();
+      else if (dataCol_p==FTMachine::MODEL)  return vb.visCubeModel();
+      return vb.visCube();
+    }
+    void VisCache::setVisCube_p(vi::VisBuffer2& vb, const Cube<Complex>& vis) const
+    {
+      if (dataCol_p==FTMachine::CORRECTED)   vb.setVisCubeCorrected(vis);
+      else if (dataCol_p==FTMachine::MODEL)  vb.setVisCubeModel(vis);
+      else                                   vb.setVisCube(vis);
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::save(vi::VisBuffer2& vb)
+    {
+      if ((mode_p != WRITE) || failed_p) return;
+
+      Entry e;
+      e.spw      = vb.spectralWindows()(0);
+      e.field    = vb.fieldId()(0);
+      e.msId     = vb.msId();
+      e.time     = vb.time()(0);
+      e.nRows    = vb.nRows();
+      e.nChan    = vb.nChannels();
+      e.nCorr    = vb.nCorrelations();
+      e.hasWtSp  = vb.existsColumn(vi::VisBufferComponent2::WeightSpectrum);
+      e.newChunk = newChunk_p;
+      newChunk_p = false;
+
+      //
+      // The quantities computed by the VI2.
+      //
+      e.meta.define("freqs", vb.getFrequencies(0));
+      e.meta.define("lsrkfreqs", vb.getFrequencies(0, MFrequency::LSRK));
+      e.meta.define("channels", vb.getChannelNumbers(0));
+      e.meta.define("corrtype", vb.correlationTypes());
+      e.meta.define("correlations", vb.getCorrelationTypes());
+      e.meta.define("corrdefined", toInt(vb.getCorrelationTypesDefined()));
+      e.meta.define("corrselected", toInt(vb.getCorrelationTypesSelected()));
+      e.meta.define("polframe", vb.polarizationFrame());
+      e.meta.define("polid", vb.polarizationId());
+      e.meta.define("phasecenter", Vector<Double>(vb.phaseCenter().getAngle("rad").getValue()));
+      e.meta.define("phasecenterref", (Int)vb.phaseCenter().getRef().getType());
+      e.meta.define("dirref", (Int)vb.direction1()(0).getRef().getType());
+      //
+      // The feed PA for each time in the VisBuffer.
+      //
+      std::set<Double> times(vb.time().begin(), vb.time().end());
+      Vector<Double> paTimes(times.size());
+      Matrix<Float> pa;
+      uInt i=0;
+      for (auto t : times)
+	{
+	  const Vector<Float>& pa_l=vb.feedPa(t);
+	  if (i == 0) pa.resize(pa_l.nelements(), times.size());
+	  paTimes(i) = t;
+	  pa.column(i++) = pa_l;
+	}
+      e.meta.define("patimes", paTimes);
+      e.meta.define("pa", pa);
+
+      auto itr = files_p.find(e.spw);
+      if (itr == files_p.end())
+	{
+	  std::string name = dataFileName(e.spw)+tmpSuffix();
+	  FILE* f = std::fopen(name.c_str(), "wb");
+	  if (f == NULL)
+	    {
+	      fail_p("Cannot open "+name+": "+std::strerror(errno));
+	      return;
+	    }
+	  itr = files_p.emplace(e.spw, f).first;
+	  offsets_p[e.spw] = 0;
+	}
+      FILE* f = itr->second;
+      e.offset = offsets_p[e.spw];
+
+      //
+      // The arrays, in the order of bytes_p().
+      //
+      Cube<Complex> vis = visCube_p(vb);
+      bool ok = put(f, vb.uvw()) && put(f, vb.time()) && put(f, vb.timeCentroid())
+	&& put(f, vb.timeInterval()) && put(f, vb.exposure())
+	&& put(f, toAngles(vb.direction1())) && put(f, toAngles(vb.direction2()))
+	&& put(f, vb.rowIds());
+      if (!half_p) ok = ok && put(f, vis);
+      ok = ok && put(f, vb.antenna1()) && put(f, vb.antenna2()) && put(f, vb.arrayId())
+	&& put(f, vb.dataDescriptionIds()) && put(f, vb.feed1()) && put(f, vb.feed2())
+	&& put(f, vb.fieldId()) && put(f, vb.observationId()) && put(f, vb.processorId())
+	&& put(f, vb.scan()) && put(f, vb.spectralWindows()) && put(f, vb.stateId())
+	&& put(f, vb.feedPa1()) && put(f, vb.feedPa2())
+	&& put(f, vb.weight()) && put(f, vb.sigma()) && put(f, vb.imagingWeight());
+      if (e.hasWtSp) ok = ok && put(f, vb.weightSpectrum());
+      if (half_p)
+	{
+	  //
+	  // Give the VisBuffer the visibilities as cached.
+	  //
+	  const std::vector<Float>& table=halfTable();
+	  Cube<Complex> hvis(vis.shape());
+	  std::vector<uShort> h(2*vis.nelements());
+	  size_t j=0;
+	  for (auto v=vis.begin(), hv=hvis.begin(); v!=vis.end(); ++v, ++hv, j+=2)
+	    {
+	      h[j]   = SynthesisUtils::floatToHalf(v->real());
+	      h[j+1] = SynthesisUtils::floatToHalf(v->imag());
+	      *hv = Complex(table[h[j]], table[h[j+1]]);
+	    }
+	  ok = ok && (std::fwrite(h.data(), sizeof(uShort), h.size(), f) == h.size());
+	  setVisCube_p(vb, hvis);
+	}
+      ok = ok && put(f, vb.flagCube()) && put(f, vb.flagRow());
+
+      Int64 written = 11*(Int64)e.nRows*sizeof(Double) + e.nRows*sizeof(rownr_t)
+	+ (half_p ? 0 : vis.nelements()*sizeof(Complex))
+	+ 12*e.nRows*sizeof(Int) + 2*e.nRows*sizeof(Float)
+	+ (2*e.nCorr + e.nChan)*e.nRows*sizeof(Float)
+	+ (e.hasWtSp ? vis.nelements()*sizeof(Float) : 0)
+	+ (half_p ? 2*vis.nelements()*sizeof(uShort) : 0)
+	+ vis.nelements()*sizeof(Bool) + e.nRows*sizeof(Bool);
+      static const char zeros[8]={0,0,0,0,0,0,0,0};
+      size_t pad = bytes_p(e) - written;
+      ok = ok && (std::fwrite(zeros, 1, pad, f) == pad);
+
+      if (!ok)
+	{
+	  fail_p("Cannot write "+dataFileName(e.spw)+tmpSuffix()+": "+std::strerror(errno));
+	  return;
+	}
+      offsets_p[e.spw] += bytes_p(e);
+      entries_p.push_back(e);
+      nVB_p++;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::read(const size_t i, VisCacheBuffer& vb)
+    {
+      if (mode_p != READ)
+	throw(AipsError("VisCache::read(): the visibility cache "+dir_p+" is being written"));
+
+      const Entry& e = entries_p[i];
+      const Record& m = e.meta;
+      const Entry* prev = (i > 0) ? &entries_p[i-1] : NULL;
+
+      //
+      // The shape and the iteration attributes.  The VisBuffer is
+      // then never filled from the VI2.
+      //
+      Vector<Int> correlations, defined, selected;
+      m.get("correlations", correlations);
+      m.get("corrdefined", defined);
+      m.get("corrselected", selected);
+      vb.configureNewSubchunk(e.msId, msName_p, (prev == NULL) || (prev->msId != e.msId),
+			      (prev == NULL), (prev == NULL) || (prev->field != e.field),
+			      (prev == NULL) || (prev->spw != e.spw),
+			      vi::Subchunk(e.chunk, e.subchunk),
+			      Vector<rownr_t>(1, e.nRows), Vector<Int>(1, e.nChan), Vector<Int>(1, e.nCorr),
+			      correlations, toStokes(defined), toStokes(selected),
+			      CountedPtr<vi::WeightScaling>());
+      vb.setFillable(false);
+
+      //
+      // The arrays reference the mapped data file, in the order of
+      // bytes_p().
+      //
+      Int n=e.nRows;
+      IPosition rows(1, n), cube(3, e.nCorr, e.nChan, n);
+      char* p = (char *)maps_p[e.spw].first + e.offset;
+      Matrix<Double> dir1, dir2;
+      p = share(p, vb.uvw_p, IPosition(2, 3, n));
+      p = share(p, vb.time_p, rows);
+      p = share(p, vb.timeCentroid_p, rows);
+      p = share(p, vb.timeInterval_p, rows);
+      p = share(p, vb.exposure_p, rows);
+      p = share(p, dir1, IPosition(2, 2, n));
+      p = share(p, dir2, IPosition(2, 2, n));
+      p = share(p, vb.rowIds_p, rows);
+
+      vb.cubes_p.clear();
+      Cube<Complex>& vis = vb.cubes_p[dataCol_p];
+      if (!half_p) p = share(p, vis, cube);
+
+      p = share(p, vb.antenna1_p, rows);
+      p = share(p, vb.antenna2_p, rows);
+      p = share(p, vb.arrayId_p, rows);
+      p = share(p, vb.ddId_p, rows);
+      p = share(p, vb.feed1_p, rows);
+      p = share(p, vb.feed2_p, rows);
+      p = share(p, vb.fieldId_p, rows);
+      p = share(p, vb.obsId_p, rows);
+      p = share(p, vb.procId_p, rows);
+      p = share(p, vb.scan_p, rows);
+      p = share(p, vb.spw_p, rows);
+      p = share(p, vb.stateId_p, rows);
+      p = share(p, vb.feedPa1_p, rows);
+      p = share(p, vb.feedPa2_p, rows);
+      p = share(p, vb.weight_p, IPosition(2, e.nCorr, n));
+      p = share(p, vb.sigma_p, IPosition(2, e.nCorr, n));
+      p = share(p, vb.imagingWeight_p, IPosition(2, e.nChan, n));
+      if (e.hasWtSp) p = share(p, vb.weightSpectrum_p, cube);
+      else           vb.weightSpectrum_p.resize();
+      vb.hasWtSp_p = e.hasWtSp;
+
+      if (half_p)
+	{
+	  const std::vector<Float>& table=halfTable();
+	  vis.resize(cube);
+	  const uShort* h = (const uShort *)p;
+	  for (auto v=vis.begin(); v!=vis.end(); ++v, h+=2)
+	    *v = Complex(table[h[0]], table[h[1]]);
+	  p = (char *)h;
+	}
+      p = share(p, vb.flagCube_p, cube);
+      p = share(p, vb.flagRow_p, rows);
+
+      //
+      // The quantities computed by the VI2.
+      //
+      Vector<Double> freqs, lsrkFreqs, phaseCenter, paTimes;
+      Matrix<Float> pa;
+      Int phaseCenterRef, dirRef;
+      m.get("freqs", freqs);
+      m.get("lsrkfreqs", lsrkFreqs);
+      vb.freqs_p.clear();
+      vb.freqs_p[vi::VisBuffer2::FrameNotSpecified] = freqs;
+      vb.freqs_p[MFrequency::LSRK] = lsrkFreqs;
+      m.get("channels", vb.chanNumbers_p);
+      m.get("corrtype", vb.corrType_p);
+      m.get("polframe", vb.polFrame_p);
+      m.get("polid", vb.polId_p);
+      m.get("phasecenter", phaseCenter);
+      m.get("phasecenterref", phaseCenterRef);
+      vb.phaseCenter_p = MDirection(MVDirection(phaseCenter(0), phaseCenter(1)),
+				    MDirection::Ref((MDirection::Types)phaseCenterRef));
+      m.get("dirref", dirRef);
+      vb.direction1_p.reference(toDirections(dir1, dirRef));
+      vb.direction2_p.reference(toDirections(dir2, dirRef));
+
+      m.get("patimes", paTimes);
+      m.get("pa", pa);
+      vb.feedPa_p.clear();
+      for (uInt t=0; t<paTimes.nelements(); t++)
+	vb.feedPa_p[paTimes(t)] = pa.column(t);
+      nVB_p++;
+    }
+    //
+    //-----------------------------------------------------------------------
+    //
+    void VisCache::finish()
+    {
+      LogIO log_l(LogOrigin("VisCache","finish"));
+      if (mode_p == READ) return;
+      close_p();
+      if (failed_p) return;
+
+      Record index;
+      index.define("version", version);
+      index.define("key", String(key_p));
+      index.define("nvb", (Int)entries_p.size());
+      for (size_t i=0; i<entries_p.size(); i++)
+	{
+	  const Entry& e=entries_p[i];
+	  Record r;
+	  r.define("spw", e.spw);
+	  r.define("field", e.field);
+	  r.define("msid", e.msId);
+	  r.define("nrows", e.nRows);
+	  r.define("nchan", e.nChan);
+	  r.define("ncorr", e.nCorr);
+	  r.define("time", e.time);
+	  r.define("offset", e.offset);
+	  r.define("wtsp", e.hasWtSp);
+	  r.define("newchunk", e.newChunk);
+	  r.defineRecord("meta", e.meta);
+	  index.defineRecord("vb"+std::to_string(i), r);
+	}
+
+      //
+      // Write the index to a temporary file.  Then remove the old
+      // index (so that its data files are never read with the new
+      // index), rename the data files, and then the index.
+      //
+      std::string name = dir_p+'/'+indexFileName(), tmpName = name+tmpSuffix();
+      try
+	{
+	  {
+	    AipsIO indexFile(tmpName, ByteIO::New);
+	    indexFile << index;
+	  }
+	  ::unlink(name.c_str());
+	  for (auto& o : offsets_p)
+	    {
+	      std::string dataName=dataFileName(o.first);
+	      if (std::rename((dataName+tmpSuffix()).c_str(), dataName.c_str()) != 0)
+		throw(AipsError("Cannot rename "+dataName+tmpSuffix()+": "+std::strerror(errno)));
+	    }
+	  if (std::rename(tmpName.c_str(), name.c_str()) != 0)
+	    throw(AipsError("Cannot rename "+tmpName+": "+std::strerror(errno)));
+	}
+      catch (AipsError& x)
+	{
+	  ::unlink(tmpName.c_str());
+	  fail_p(x.getMesg());
+	  return;
+	}
+      clean_p(true);
+      unlock_p();
+
+      Int64 bytes=0;
+      for (auto& o : offsets_p) bytes += o.second;
+      log_l << "Wrote " << entries_p.size() << " VisBuffers (" << bytes/(1024*1024) << " MB) to the visibility cache "
+	    << dir_p << LogIO::POST;
+    }
+  };
+};
@@ -0,0 +1,309 @@
+// -*- C++ -*-
+//# VisCache.h: Definition of the VisCache class
+//# Copyright (C) 2026
+//# Associated Universities, Inc. Washington DC, USA.
+//#
+//# This library is free software; you can redistribute it and/or modify it
+//# under the terms of the GNU Library General Public License as published by
+//# the Free Software Foundation; either version 2 of the License, or (at your
+//# option) any later version.
+//#
+//# This library is distributed in the hope that it will be useful, but WITHOUT
+//# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+//# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+//# License for more details.
+//#
+//# You should have received a copy of the GNU Library General Public License
+//# along with this library; if not, write to the Free Software Foundation,
+//# Inc., 675 Massachusetts Ave, Cambridge, MA 02139, USA.
+//#
+//# Correspondence concerning this should be addressed as follows:
+//#        Postal address: National Radio Astronomy Observatory
+//#                        1003 Lopezville Road,
+//#                        Socorro, NM - 87801, USA
+//#
+//# $Id$
+#ifndef SYNTHESIS_TRANSFORM2_VISCACHE_H
+#define SYNTHESIS_TRANSFORM2_VISCACHE_H
+
+#include <casacore/casa/Arrays/Cube.h>
+#include <casacore/casa/Arrays/Matrix.h>
+#include <casacore/casa/Containers/Record.h>
+#include <casacore/measures/Measures/MDirection.h>
+#include <msvis/MSVis/VisBuffer2.h>
+#include <msvis/MSVis/VisBufferImpl2.h>
+#include <msvis/MSVis/VisBufferComponents2.h>
+#include <synthesis/TransformMachines2/FTMachine.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace casa { //# NAMESPACE CASA - BEGIN
+  namespace refim{
+    //
+    // The VisBuffer2 of a pass over the data from a VisCache.
+    //
+    // The components used by the gridders are set from the cache by
+    // VisCache::read(), and the VI2 is not used.  The bulk arrays
+    // (the visibilities, flags and weights) and the per-row columns
+    // reference the memory-mapped data files of the cache, and are
+    // not copied.  The quantities computed by the VI2 for the
+    // gridders (the frequencies of row 0, the feed PA of the times of
+    // the rows, the pointing and phase center directions) are from
+    // the cache too.  A component or a quantity that is not cached
+    // raises an exception, as the VisBuffer2 is never filled from the
+    // VI2.
+    //
+    // The cached components are read-only, except the visibility
+    // cubes, the flags and the weights, which can be set (e.g. by the
+    // data consumer or the model prediction).  The mapping is
+    // private, so the data files are not modified.
+    //
+    class VisCacheBuffer : public vi::VisBufferImpl2
+    {
+    public:
+      VisCacheBuffer(vi::ViImplementation2 *vii);
+      ~VisCacheBuffer() {};
+
+      using vi::VisBufferImpl2::setVisCube;
+      using vi::VisBufferImpl2::setVisCubeModel;
+
+      virtual const casacore::Vector<casacore::Int>& antenna1() const {return antenna1_p;};
+      virtual const casacore::Vector<casacore::Int>& antenna2() const {return antenna2_p;};
+      virtual const casacore::Vector<casacore::Int>& arrayId() const {return arrayId_p;};
+      virtual const casacore::Vector<casacore::Int>& correlationTypes() const {return corrType_p;};
+      virtual const casacore::Vector<casacore::Int>& dataDescriptionIds() const {return ddId_p;};
+      virtual const casacore::Vector<casacore::MDirection>& direction1() const {return direction1_p;};
+      virtual const casacore::Vector<casacore::MDirection>& direction2() const {return direction2_p;};
+      virtual const casacore::Vector<casacore::Double>& exposure() const {return exposure_p;};
+      virtual const casacore::Vector<casacore::Int>& feed1() const {return feed1_p;};
+      virtual const casacore::Vector<casacore::Int>& feed2() const {return feed2_p;};
+      virtual const casacore::Vector<casacore::Float>& feedPa1() const {return feedPa1_p;};
+      virtual const casacore::Vector<casacore::Float>& feedPa2() const {return feedPa2_p;};
+      virtual const casacore::Vector<casacore::Int>& fieldId() const {return fieldId_p;};
+      virtual const casacore::Vector<casacore::Bool>& flagRow() const {return flagRow_p;};
+      virtual const casacore::Matrix<casacore::Float>& imagingWeight() const {return imagingWeight_p;};
+      virtual const casacore::Vector<casacore::Int>& observationId() const {return obsId_p;};
+      virtual const casacore::MDirection& phaseCenter() const {return phaseCenter_p;};
+      virtual casacore::Int polarizationFrame() const {return polFrame_p;};
+      virtual casacore::Int polarizationId() const {return polId_p;};
+      virtual const casacore::Vector<casacore::Int>& processorId() const {return procId_p;};
+      virtual const casacore::Vector<casacore::rownr_t>& rowIds() const {return rowIds_p;};
+      virtual const casacore::Vector<casacore::Int>& scan() const {return scan_p;};
+      virtual const casacore::Matrix<casacore::Float>& sigma() const {return sigma_p;};
+      virtual const casacore::Vector<casacore::Int>& spectralWindows() const {return spw_p;};
+      virtual const casacore::Vector<casacore::Int>& stateId() const {return stateId_p;};
+      virtual const casacore::Vector<casacore::Double>& time() const {return time_p;};
+      virtual const casacore::Vector<casacore::Double>& timeCentroid() const {return timeCentroid_p;};
+      virtual const casacore::Vector<casacore::Double>& timeInterval() const {return timeInterval_p;};
+      virtual const casacore::Matrix<casacore::Double>& uvw() const {return uvw_p;};
+
+      virtual const casacore::Cube<casacore::Bool>& flagCube() const {return flagCube_p;};
+      virtual void setFlagCube(const casacore::Cube<casacore::Bool>& value) {flagCube_p.assign(value);};
+      virtual const casacore::Matrix<casacore::Float>& weight() const {return weight_p;};
+      virtual void setWeight(const casacore::Matrix<casacore::Float>& value) {weight_p.assign(value);};
+      virtual const casacore::Cube<casacore::Float>& weightSpectrum() const;
+      virtual void setWeightSpectrum(const casacore::Cube<casacore::Float>& value) {weightSpectrum_p.assign(value);};
+
+      virtual const casacore::Cube<casacore::Complex>& visCube() const {return cube_p(FTMachine::OBSERVED);};
+      virtual void setVisCube(const casacore::Cube<casacore::Complex>& value) {setCube_p(FTMachine::OBSERVED, value);};
+      virtual void setVisCube(const casacore::Complex& value) {setCube_p(FTMachine::OBSERVED, value);};
+      virtual const casacore::Cube<casacore::Complex>& visCubeCorrected() const {return cube_p(FTMachine::CORRECTED);};
+      virtual void setVisCubeCorrected(const casacore::Cube<casacore::Complex>& value) {setCube_p(FTMachine::CORRECTED, value);};
+      virtual const casacore::Cube<casacore::Complex>& visCubeModel() const {return cube_p(FTMachine::MODEL);};
+      virtual void setVisCubeModel(const casacore::Cube<casacore::Complex>& value) {setCube_p(FTMachine::MODEL, value);};
+      virtual void setVisCubeModel(const casacore::Complex& value) {setCube_p(FTMachine::MODEL, value);};
+
+      virtual const casacore::Vector<casacore::Double>& getFrequencies(casacore::Int rowInBuffer,
+								       casacore::Int frame = vi::VisBuffer2::FrameNotSpecified) const;
+      virtual casacore::Double getFrequency(casacore::Int rowInBuffer, casacore::Int frequencyIndex,
+					    casacore::Int frame = vi::VisBuffer2::FrameNotSpecified) const
+      {return getFrequencies(rowInBuffer, frame)(frequencyIndex);};
+      virtual const casacore::Vector<casacore::Int>& getChannelNumbers(casacore::Int rowInBuffer) const
+      {checkRow_p(rowInBuffer); return chanNumbers_p;};
+      virtual casacore::Int getChannelNumber(casacore::Int rowInBuffer, casacore::Int frequencyIndex) const
+      {return getChannelNumbers(rowInBuffer)(frequencyIndex);};
+
+      virtual const casacore::Vector<casacore::Float>& feedPa(casacore::Double time) const;
+
+      // The other quantities computed by the VI2.
+      virtual casacore::MDirection azel0(casacore::Double) const {notCached_p("azel0"); return casacore::MDirection();};
+      virtual const casacore::Vector<casacore::MDirection>& azel(casacore::Double) const {notCached_p("azel"); return azel_p;};
+      virtual casacore::Double hourang(casacore::Double) const {notCached_p("hourang"); return 0.0;};
+      virtual casacore::Float parang0(casacore::Double) const {notCached_p("parang0"); return 0.0;};
+      virtual const casacore::Vector<casacore::Float>& parang(casacore::Double) const {notCached_p("parang"); return parang_p;};
+
+    private:
+      friend class VisCache;
+
+      // The frequencies are a function of (SPW, time).  Rows other
+      // than row 0 are served only if they share these with row 0.
+      void checkRow_p(casacore::Int row) const;
+      void notCached_p(const std::string& what) const;
+      const casacore::Cube<casacore::Complex>& cube_p(const FTMachine::Type col) const;
+      void setCube_p(const FTMachine::Type col, const casacore::Cube<casacore::Complex>& value);
+      void setCube_p(const FTMachine::Type col, const casacore::Complex& value);
+
+      casacore::Vector<casacore::Int> antenna1_p, antenna2_p, arrayId_p, corrType_p, ddId_p,
+	feed1_p, feed2_p, fieldId_p, obsId_p, procId_p, scan_p, spw_p, stateId_p;
+      casacore::Vector<casacore::Double> exposure_p, time_p, timeCentroid_p, timeInterval_p;
+      casacore::Vector<casacore::Float> feedPa1_p, feedPa2_p;
+      casacore::Vector<casacore::Bool> flagRow_p;
+      casacore::Vector<casacore::rownr_t> rowIds_p;
+      casacore::Matrix<casacore::Double> uvw_p;
+      casacore::Matrix<casacore::Float> imagingWeight_p, sigma_p, weight_p;
+      casacore::Cube<casacore::Bool> flagCube_p;
+      casacore::Cube<casacore::Float> weightSpectrum_p;
+      // The visibility cubes, by FTMachine::Type (OBSERVED, MODEL or CORRECTED).
+      std::map<FTMachine::Type, casacore::Cube<casacore::Complex> > cubes_p;
+      casacore::Bool hasWtSp_p;
+
+      casacore::MDirection phaseCenter_p;
+      casacore::Vector<casacore::MDirection> direction1_p, direction2_p;
+      casacore::Int polFrame_p, polId_p;
+      std::map<casacore::Int, casacore::Vector<casacore::Double> > freqs_p;
+      casacore::Vector<casacore::Int> chanNumbers_p;
+      std::map<casacore::Double, casacore::Vector<casacore::Float> > feedPa_p;
+      casacore::Vector<casacore::MDirection> azel_p;
+      casacore::Vector<casacore::Float> parang_p;
+    };
+    //
+    // A cache of the visibility data used by the gridders, re-used in
+    // the later major cycles.
+    //
+    // On the first pass over the data, save() saves the components of
+    // each VisBuffer2 of the data iterations used by the gridders: the
+    // UVW, the weights, the flags, the visibilities of the data
+    // column, WEIGHT_SPECTRUM (if it is in the MS), the other
+    // per-row columns, and the quantities computed by the VI2 (the
+    // frequencies, the feed PA, the imaging weights and the
+    // directions).  The later passes over the same MS with the same
+    // data selection do not iterate the VI2.  They call read() for
+    // each cached VisBuffer, which sets a VisCacheBuffer from the
+    // cache.
+    //
+    // The cache is a directory with a data file per SPW
+    // (spw<ID>.dat), with the VisBuffers in the order of the data
+    // iterations, and an index (VisCache.idx, an AipsIO Record).
+    // The index has the key of the data (the MS, its modification
+    // time, the data selection and the imaging weights), and the
+    // metadata of each VisBuffer.  The data files are memory-mapped
+    // (privately) for reading, and the arrays of the VisCacheBuffer
+    // reference the mapping.  The visibilities are saved in single
+    // precision or, optionally, in IEEE half precision (which are
+    // then converted on reading).  The VisBuffers of the first pass
+    // then get the visibilities as cached, so that all passes grid
+    // the same data.
+    //
+    // A cache is written by one process at a time, which holds a
+    // lock on VisCache.lock for the pass.  The data files are written
+    // to temporary files, which finish() renames, and the index is
+    // then written to a temporary file and renamed.  A cache is
+    // therefore never read while it is being written, and the data
+    // files of a cache are mapped when its index is read (so that a
+    // cache written later by another process does not change them).
+    // A cache without an index (e.g. from an interrupted pass), or
+    // with a different key, is written again.  A failure to write the
+    // cache (or to get the lock) is reported, and the data is then
+    // not cached.
+    //
+    // save() must be called for each VisBuffer2 in the order of the
+    // data iterations, from the thread that iterates the VI2, and
+    // newChunk() before the first VisBuffer2 of each chunk.
+    //
+    class VisCache
+    {
+    public:
+      enum Mode {WRITE=0, READ};
+
+      static std::string indexFileName() {return "VisCache.idx";};
+      static std::string lockFileName() {return "VisCache.lock";};
+      //
+      // Open the cache in the directory dir, or prepare it for
+      // writing (the directory is made if it does not exist).
+      // selection describes the data selection (with any other
+      // setting that changes the data iterations or the imaging
+      // weights).  With half=true the visibilities are saved in half
+      // precision.
+      //
+      VisCache(const std::string& dir, const std::string& msName,
+	       const std::string& selection,
+	       const FTMachine::Type dataCol,
+	       const bool half=false);
+      ~VisCache();
+
+      Mode mode() const {return mode_p;};
+      //
+      // WRITE: The next VisBuffer2 is the first of a chunk of the data
+      // iterations.
+      //
+      void newChunk() {newChunk_p=true;};
+      //
+      // WRITE: Save the cached components of vb.  With half
+      // precision, vb then gets the visibilities as cached.
+      //
+      void save(vi::VisBuffer2& vb);
+      //
+      // READ: The no. of cached VisBuffers, and if VisBuffer i is the
+      // first of a chunk.
+      //
+      size_t nVB() const {return entries_p.size();};
+      bool startsChunk(const size_t i) const {return entries_p[i].newChunk;};
+      //
+      // READ: Set vb to the cached VisBuffer i.
+      //
+      void read(const size_t i, VisCacheBuffer& vb);
+      //
+      // End the pass over the data.  Writes the index of a new cache.
+      //
+      void finish();
+
+    private:
+      static constexpr casacore::Int version=2;
+
+      struct Entry
+      {
+	casacore::Int spw, field, msId, nRows, nChan, nCorr;
+	casacore::Double time;
+	casacore::Int64 offset;
+	casacore::Bool hasWtSp, newChunk;
+	// The no. of the chunk and of the VisBuffer in the chunk.
+	casacore::Int chunk, subchunk;
+	// The metadata of the VisBuffer (frequencies, correlations,
+	// PA and directions).
+	casacore::Record meta;
+      };
+
+      std::string dataFileName(const casacore::Int spw) const
+      {return dir_p+"/spw"+std::to_string(spw)+".dat";};
+      std::string tmpSuffix() const {return ".tmp";};
+      casacore::Int64 bytes_p(const Entry& e) const;
+      bool load_p();
+      std::string lock_p();
+      void unlock_p();
+      void clean_p(const bool all);
+      void close_p();
+      void fail_p(const std::string& mesg);
+      void map_p(const casacore::Int spw);
+      casacore::Cube<casacore::Complex> visCube_p(const vi::VisBuffer2& vb) const;
+      void setVisCube_p(vi::VisBuffer2& vb, const casacore::Cube<casacore::Complex>& vis) const;
+
+      std::string dir_p, msName_p, key_p;
+      FTMachine::Type dataCol_p;
+      bool half_p;
+      Mode mode_p;
+      bool failed_p, newChunk_p;
+      int lockFd_p;
+      size_t nVB_p;
+      std::vector<Entry> entries_p;
+      // The data files being written, and their sizes, by SPW ID.
+      std::map<casacore::Int, FILE*> files_p;
+      std::map<casacore::Int, casacore::Int64> offsets_p;
+      // The memory-mapped data files (address, size), by SPW ID.
+      std::map<casacore::Int, std::pair<void*, size_t> > maps_p;
+    };
+  };
+};
+#endif
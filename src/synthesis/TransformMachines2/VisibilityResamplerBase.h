@@ -96,6 +96,17 @@ namespace casa { //# NAMESPACE CASA - BEGIN
 
     virtual void setConvFunc(const CFStore& cfs) = 0;
     virtual void setPATolerance(const double& dPA) = 0;
+    // No. of threads used by the resampler.  NoOp for resamplers
+    // that do not use threads.
+    virtual void setNumThreads(const casacore::Int& /*n*/) {};
+    // Process the samples of a VisBuffer in the order of the CFs
+    // they use, rather than in the order of the data.  NoOp for
+    // resamplers that do not support it.
+    virtual void setSortByCF(const casacore::Bool& /*sort*/) {};
+    // Grid in tiles of the grid of (at least) this size, with
+    // per-thread tile buffers.  NoOp for resamplers that do not
+    // support it.
+    virtual void setGridTileSize(const casacore::Int& /*n*/) {};
     //
     //------------------------------------------------------------------------------
     //